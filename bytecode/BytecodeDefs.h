@@ -23,6 +23,16 @@
 #define bytecodeMaxInt ( INT64_C(0x007fffffffffffff))
 #define bytecodeMinInt (-INT64_C(0x0080000000000000))
 
+//------------------------------------------------------------------------
+// Double
+//------------------------------------------------------------------------
+
+// A Double is a blob holding an 8-byte IEEE double, with this type
+// tag in its header. Computed Doubles are allocated on the heap;
+// Double literals are stored in the data segment, with the same
+// header layout.
+#define bytecodeDoubleTypeTag ((uint8_t)2)
+
 //------------------------------------------------------------------------
 // opcodes
 //------------------------------------------------------------------------
@@ -550,6 +550,9 @@ void BytecodeEngine::run() {
       } else if (cellIsFloat(op1) && cellIsFloat(op2)) {
 	float result = cellFloat(op1) + cellFloat(op2);
 	push(cellMakeFloat(result));
+      } else if (cellIsDouble(op1) && cellIsDouble(op2)) {
+	// NB: this may trigger GC -- op1 and op2 are no longer needed
+	push(heapAllocDouble(cellDouble(op1) + cellDouble(op2)));
       } else {
 	fatalError("Invalid operand");
       }
@@ -567,6 +570,9 @@ void BytecodeEngine::run() {
       } else if (cellIsFloat(op1) && cellIsFloat(op2)) {
 	float result = cellFloat(op1) - cellFloat(op2);
 	push(cellMakeFloat(result));
+      } else if (cellIsDouble(op1) && cellIsDouble(op2)) {
+	// NB: this may trigger GC -- op1 and op2 are no longer needed
+	push(heapAllocDouble(cellDouble(op1) - cellDouble(op2)));
       } else {
 	fatalError("Invalid operand");
       }
@@ -585,6 +591,9 @@ void BytecodeEngine::run() {
       } else if (cellIsFloat(op1) && cellIsFloat(op2)) {
 	float result = cellFloat(op1) * cellFloat(op2);
 	push(cellMakeFloat(result));
+      } else if (cellIsDouble(op1) && cellIsDouble(op2)) {
+	// NB: this may trigger GC -- op1 and op2 are no longer needed
+	push(heapAllocDouble(cellDouble(op1) * cellDouble(op2)));
       } else {
 	fatalError("Invalid operand");
       }
@@ -607,6 +616,9 @@ void BytecodeEngine::run() {
       } else if (cellIsFloat(op1) && cellIsFloat(op2)) {
 	float result = cellFloat(op1) / cellFloat(op2);
 	push(cellMakeFloat(result));
+      } else if (cellIsDouble(op1) && cellIsDouble(op2)) {
+	// NB: this may trigger GC -- op1 and op2 are no longer needed
+	push(heapAllocDouble(cellDouble(op1) / cellDouble(op2)));
       } else {
 	fatalError("Invalid operand");
       }
@@ -714,6 +726,9 @@ void BytecodeEngine::run() {
       } else if (cellIsFloat(op)) {
 	float result = -cellFloat(op);
 	push(cellMakeFloat(result));
+      } else if (cellIsDouble(op)) {
+	// NB: this may trigger GC
+	push(heapAllocDouble(-cellDouble(op)));
       } else {
 	fatalError("Invalid operand");
       }
@@ -739,7 +754,11 @@ void BytecodeEngine::run() {
 	  !(cellIsPtr(op1) && cellIsPtr(op2))) {
 	fatalError("Invalid operand");
       }
-      push(cellMakeBool(op1 == op2));
+      if (cellIsDouble(op1) && cellIsDouble(op2)) {
+	push(cellMakeBool(cellDouble(op1) == cellDouble(op2)));
+      } else {
+	push(cellMakeBool(op1 == op2));
+      }
       break;
     }
     case bcOpcodeCmpne: {
@@ -749,7 +768,11 @@ void BytecodeEngine::run() {
 	  !(cellIsPtr(op1) && cellIsPtr(op2))) {
 	fatalError("Invalid operand");
       }
-      push(cellMakeBool(op1 != op2));
+      if (cellIsDouble(op1) && cellIsDouble(op2)) {
+	push(cellMakeBool(cellDouble(op1) != cellDouble(op2)));
+      } else {
+	push(cellMakeBool(op1 != op2));
+      }
       break;
     }
     case bcOpcodeCmplt: {
@@ -760,6 +783,8 @@ void BytecodeEngine::run() {
 	result = cellInt(op1) < cellInt(op2);
       } else if (cellIsFloat(op1) && cellIsFloat(op2)) {
 	result = cellFloat(op1) < cellFloat(op2);
+      } else if (cellIsDouble(op1) && cellIsDouble(op2)) {
+	result = cellDouble(op1) < cellDouble(op2);
       } else {
 	fatalError("Invalid operand");
       }
@@ -774,6 +799,8 @@ void BytecodeEngine::run() {
 	result = cellInt(op1) > cellInt(op2);
       } else if (cellIsFloat(op1) && cellIsFloat(op2)) {
 	result = cellFloat(op1) > cellFloat(op2);
+      } else if (cellIsDouble(op1) && cellIsDouble(op2)) {
+	result = cellDouble(op1) > cellDouble(op2);
       } else {
 	fatalError("Invalid operand");
       }
@@ -788,6 +815,8 @@ void BytecodeEngine::run() {
 	result = cellInt(op1) <= cellInt(op2);
       } else if (cellIsFloat(op1) && cellIsFloat(op2)) {
 	result = cellFloat(op1) <= cellFloat(op2);
+      } else if (cellIsDouble(op1) && cellIsDouble(op2)) {
+	result = cellDouble(op1) <= cellDouble(op2);
       } else {
 	fatalError("Invalid operand");
       }
@@ -802,6 +831,8 @@ void BytecodeEngine::run() {
 	result = cellInt(op1) >= cellInt(op2);
       } else if (cellIsFloat(op1) && cellIsFloat(op2)) {
 	result = cellFloat(op1) >= cellFloat(op2);
+      } else if (cellIsDouble(op1) && cellIsDouble(op2)) {
+	result = cellDouble(op1) >= cellDouble(op2);
       } else {
 	fatalError("Invalid operand");
       }
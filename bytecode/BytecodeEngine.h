@@ -14,10 +14,12 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
+#include "BytecodeDefs.h"
 #include "ConfigFile.h"
 
 //------------------------------------------------------------------------
@@ -126,6 +128,30 @@ static inline void *heapObjRelocatedPtr(void *p) { return (void *)(*(uint64_t *)
 #define gcTagTuple      ((uint8_t)2)
 #define gcTagHandle     ((uint8_t)3)
 
+// Type tags for heap objects that get special treatment from the
+// GC. Everything else uses type tag 0.
+// - A string slice is a tuple of four cells: a pointer to a flat
+//   string (the parent), the offset (Int), the length (Int), and
+//   the owner (a resource pointer that keeps a non-heap parent
+//   alive, or nil).
+// - A Double is a blob containing a double (see BytecodeDefs.h).
+//   The arithmetic and comparison instructions use the tag to tell
+//   Doubles apart from other pointers.
+#define heapTypeTagStringSlice ((uint8_t)1)
+#define heapTypeTagDouble      bytecodeDoubleTypeTag
+
+// Double access. A Double Cell is a heap ptr, or a non-heap ptr for
+// a literal in the data segment.
+static inline bool cellIsDouble(Cell cell) {
+  return (cell & 0x06) == 0x00 && !cellIsNilPtr(cell) &&
+         *(uint8_t *)cellPtr(cell) == (uint8_t)((heapTypeTagDouble << 2) | gcTagBlob);
+}
+static inline double cellDouble(Cell cell) {
+  double x;
+  memcpy(&x, (uint64_t *)cellPtr(cell) + 1, sizeof(double));
+  return x;
+}
+
 //------------------------------------------------------------------------
 
 struct ResourceObject {
@@ -213,7 +239,14 @@ public:
   // pushed or otherwise made visible to the GC.
   void *heapAllocHandle(uint64_t size, uint8_t typeTag);
 
-  // Push a Cell reference onto the stack of GC roots.
+  // Allocate a Double containing [x], and return a Cell pointing to
+  // it. The returned Cell should immediately be pushed or otherwise
+  // made visible to the GC.
+  Cell heapAllocDouble(double x);
+
+  // Push a Cell reference onto the stack of GC roots. A Cell must be
+  // registered only once: it must not already be a GC root or a
+  // stack slot (e.g., a reference returned by arg()).
   void pushGCRoot(Cell &cell);
 
   // Pop a Cell reference off the stack of GC roots. popGCRoot() must
@@ -276,6 +309,8 @@ private:
   void gc(uint64_t nWords);
   void fullGC(size_t newHeapSize);
   void quickGC(size_t newHeapSize);
+  void relocateStringSliceParents(std::vector<Cell*> &slices,
+				  uint64_t *newHeap, size_t &newHeapNext);
   void scanResourceObjects();
 
   ConfigFile cfg;
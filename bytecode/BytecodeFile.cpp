@@ -9,6 +9,7 @@
 
 #include "BytecodeFile.h"
 #include <string.h>
+#include <algorithm>
 #include "BytecodeDefs.h"
 
 //------------------------------------------------------------------------
@@ -351,6 +352,7 @@ void BytecodeFile::clear() {
   bytecodeRelocs.clear();
   nativeRelocs.clear();
   dataLabels.clear();
+  dataObjs.clear();
 }
 
 //------------------------------------------------------------------------
@@ -372,13 +374,39 @@ bool BytecodeFile::appendBytecodeFile(BytecodeFile &file) {
 			 file.bytecodeSection.begin(), file.bytecodeSection.end());
 
   //--- data section
-  alignData();
-  uint32_t dataAddr = (uint32_t)dataSection.size();
+  // Each data label marks the start of an object, which extends to
+  // the next label (or the end of the section). Objects that are
+  // identical to one already in this file (e.g., the same string
+  // literal used in multiple functions or modules) are not copied --
+  // their labels point to the existing copy. Data that isn't covered
+  // by any label is unreachable, and is dropped.
   if (dataSection.size() > 0xffffffffU - file.dataSection.size()) {
     (*errorFunc)("Data section too large");
     return false;
   }
-  dataSection.insert(dataSection.end(), file.dataSection.begin(), file.dataSection.end());
+  std::vector<uint32_t> objAddrs;
+  for (DataLabel &dataLabel : file.dataLabels) {
+    objAddrs.push_back(dataLabel.dataAddr);
+  }
+  std::sort(objAddrs.begin(), objAddrs.end());
+  objAddrs.erase(std::unique(objAddrs.begin(), objAddrs.end()), objAddrs.end());
+  std::unordered_map<uint32_t, uint32_t> newObjAddrs;
+  for (size_t i = 0; i < objAddrs.size(); ++i) {
+    uint32_t start = objAddrs[i];
+    uint32_t end = (i + 1 < objAddrs.size()) ? objAddrs[i+1]
+                                              : (uint32_t)file.dataSection.size();
+    std::string obj((char *)file.dataSection.data() + start, end - start);
+    auto iter = dataObjs.find(obj);
+    if (iter != dataObjs.end()) {
+      newObjAddrs[start] = iter->second;
+    } else {
+      alignData();
+      uint32_t newAddr = (uint32_t)dataSection.size();
+      dataSection.insert(dataSection.end(), obj.begin(), obj.end());
+      dataObjs[obj] = newAddr;
+      newObjAddrs[start] = newAddr;
+    }
+  }
 
   //--- function definitions
   for (auto &pair : file.funcDefns) {
@@ -406,7 +434,7 @@ bool BytecodeFile::appendBytecodeFile(BytecodeFile &file) {
 
   //--- data labels
   for (DataLabel &dataLabel : file.dataLabels) {
-    dataLabels.emplace_back(dataAddr + dataLabel.dataAddr);
+    dataLabels.emplace_back(newObjAddrs[dataLabel.dataAddr]);
     for (uint32_t instrAddr : dataLabel.instrAddrs) {
       dataLabels.back().instrAddrs.push_back(bytecodeAddr + instrAddr);
     }
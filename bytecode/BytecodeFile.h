@@ -184,6 +184,11 @@ private:
 
   // data labels are written to the bytecode file
   std::vector<DataLabel> dataLabels;
+
+  // map from data object contents to data address, for objects added
+  // by appendBytecodeFile() -- this is used to merge identical
+  // objects (mainly string literals)
+  std::unordered_map<std::string, uint32_t> dataObjs;
 };
 
 #endif // BytecodeFile_h
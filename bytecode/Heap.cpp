@@ -36,6 +36,12 @@ void *BytecodeEngine::heapAllocHandle(uint64_t size, uint8_t typeTag) {
   return heapAlloc(2, size, typeTag, gcTagHandle);
 }
 
+Cell BytecodeEngine::heapAllocDouble(double x) {
+  void *p = heapAllocBlob(sizeof(double), heapTypeTagDouble);
+  memcpy((uint64_t *)p + 1, &x, sizeof(double));
+  return cellMakeHeapPtr(p);
+}
+
 // Allocate [nWords] 64-bit words. [nWords] must be at least one, to
 // allow for the header word. The header word is filled in with
 // [size], [gcTag], and [typeTag].
@@ -139,6 +145,9 @@ void BytecodeEngine::fullGC(size_t newHeapSize) {
   // i.e., pointers to objects in the old heap
   std::vector<Cell*> ptrAddrStack;
 
+  // string slices whose parent pointers haven't been scanned yet
+  std::vector<Cell*> slices;
+
   // this processes entries in gcRoots first, and then entries in stack
   bool processingGCRoots = true;
   size_t idx = 0;
@@ -196,8 +205,15 @@ void BytecodeEngine::fullGC(size_t newHeapSize) {
 	// copy the object
 	memcpy(newPtr, ptr, objSize * 8);
 
-	// enqueue pointers in the relocated object
-	if (gcTag != gcTagBlob) {
+	// enqueue pointers in the relocated object -- string slice
+	// parents are handled after everything else has been scanned
+	if (gcTag == gcTagTuple && heapObjTypeTag(ptr) == heapTypeTagStringSlice) {
+	  slices.push_back((Cell *)newPtr);
+	  Cell owner = ((Cell *)newPtr)[4];
+	  if (cellIsResourcePtr(owner) && !cellIsNilPtr(owner)) {
+	    ((ResourceObject *)cellResourcePtr(owner))->marked = true;
+	  }
+	} else if (gcTag != gcTagBlob) {
 	  for (uint64_t i = 1; i < objSize; ++i) {
 	    Cell *newPtrAddr = (Cell *)newPtr + i;
 	    if (cellIsHeapPtr(*newPtrAddr) && !cellIsNilHeapPtr(*newPtrAddr)) {
@@ -217,6 +233,8 @@ void BytecodeEngine::fullGC(size_t newHeapSize) {
     }
   }
 
+  relocateStringSliceParents(slices, newHeap.get(), newHeapNext);
+
   // zero the unallocated part of the new heap
   // (zero words are nil heap pointers)
   memset(newHeap.get() + newHeapNext, 0, (newHeapSize - newHeapNext) * 8);
@@ -226,6 +244,63 @@ void BytecodeEngine::fullGC(size_t newHeapSize) {
   heapNext = newHeapNext;
 }
 
+// Update the parent pointers in the (already relocated) string
+// [slices]. This is called by fullGC after all other live objects
+// have been relocated. If a parent string was relocated, i.e., it's
+// reachable from something other than slices, the slice just points
+// to it. Otherwise, if the slices of that parent cover less than
+// half of it, each slice gets its own flat copy of its bytes, and
+// the parent is dropped -- this avoids keeping a huge string alive
+// because of a few small slices. Otherwise, the parent is relocated.
+void BytecodeEngine::relocateStringSliceParents(std::vector<Cell*> &slices,
+						 uint64_t *newHeap, size_t &newHeapNext) {
+  // compute the number of bytes used by slices of each
+  // (unrelocated) parent
+  std::unordered_map<uint64_t*, int64_t> sliceBytes;
+  for (Cell *slice : slices) {
+    if (cellIsHeapPtr(slice[1]) && !cellIsNilHeapPtr(slice[1])) {
+      uint64_t *parent = (uint64_t *)cellHeapPtr(slice[1]);
+      if (heapObjGCTag(parent) != gcTagRelocated) {
+	sliceBytes[parent] += cellInt(slice[3]);
+      }
+    }
+  }
+
+  for (Cell *slice : slices) {
+    if (!cellIsHeapPtr(slice[1]) || cellIsNilHeapPtr(slice[1])) {
+      continue;
+    }
+    uint64_t *parent = (uint64_t *)cellHeapPtr(slice[1]);
+    void *newParent;
+
+    // parent has already been relocated
+    if (heapObjGCTag(parent) == gcTagRelocated) {
+      newParent = heapObjRelocatedPtr(parent);
+
+    // make a flat copy of the slice
+    } else if (sliceBytes[parent] < heapObjSize(parent) / 2) {
+      int64_t length = cellInt(slice[3]);
+      uint64_t objSize = 1 + (length + 7) / 8;
+      newParent = &newHeap[newHeapNext];
+      newHeapNext += objSize;
+      *(uint64_t *)newParent = ((uint64_t)length << 8) | gcTagBlob;
+      memcpy((uint8_t *)newParent + 8, (uint8_t *)parent + 8 + cellInt(slice[2]), length);
+      slice[2] = cellMakeInt(0);
+
+    // relocate the parent (which is a flat string, i.e., a blob with
+    // no pointers)
+    } else {
+      uint64_t objSize = 1 + (heapObjSize(parent) + 7) / 8;
+      newParent = &newHeap[newHeapNext];
+      newHeapNext += objSize;
+      memcpy(newParent, parent, objSize * 8);
+      *parent = (uint64_t)newParent | gcTagRelocated;
+    }
+
+    slice[1] = cellMakeHeapPtr(newParent);
+  }
+}
+
 // Allocate a new heap of [newHeapSize] words, copy over all objects,
 // and update all pointers. This is run immediately after a full GC,
 // so the heap contains only live objects.
@@ -418,7 +418,11 @@ std::string ParenExpr::toString(int indent) {
 //------------------------------------------------------------------------
 
 std::string NewExpr::toString(int indent) {
-  return "new " + type->toString();
+  std::string s = "new " + type->toString();
+  if (capacity) {
+    s += "(" + capacity->toString() + ")";
+  }
+  return s;
 }
 
 //------------------------------------------------------------------------
@@ -559,6 +563,12 @@ std::string LitFloatExpr::toString(int indent) {
 
 //------------------------------------------------------------------------
 
+std::string LitDoubleExpr::toString(int indent) {
+  return val + "d";
+}
+
+//------------------------------------------------------------------------
+
 std::string LitBoolExpr::toString(int indent) {
   return val ? "true" : "false";
 }
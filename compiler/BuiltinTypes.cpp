@@ -20,6 +20,9 @@ void addBuiltinTypes(Context &ctx) {
   ctx.floatType = new CAtomicType(Location(), true, "Float", haxModule, CTypeKind::floatType);
   ctx.addType(std::unique_ptr<CType>(ctx.floatType));
 
+  ctx.doubleType = new CAtomicType(Location(), true, "Double", haxModule, CTypeKind::doubleType);
+  ctx.addType(std::unique_ptr<CType>(ctx.doubleType));
+
   ctx.boolType = new CAtomicType(Location(), true, "Bool", haxModule, CTypeKind::boolType);
   ctx.addType(std::unique_ptr<CType>(ctx.boolType));
 
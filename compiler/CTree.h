@@ -130,6 +130,7 @@ enum class CTypeKind {
   //--- CAtomicType
   intType,
   floatType,
+  doubleType,
   boolType,
   otherAtomicType,
 
@@ -384,6 +385,7 @@ public:
   virtual std::unique_ptr<CConstValue> copy() = 0;
   virtual bool isInt() { return false; }
   virtual bool isFloat() { return false; }
+  virtual bool isDouble() { return false; }
   virtual bool isBool() { return false; }
   virtual bool isString() { return false; }
 };
@@ -414,6 +416,18 @@ public:
 
 //------------------------------------------------------------------------
 
+class CConstDoubleValue: public CConstValue {
+public:
+
+  CConstDoubleValue(double aVal): val(aVal) {}
+  virtual std::unique_ptr<CConstValue> copy() { return std::make_unique<CConstDoubleValue>(val); }
+  virtual bool isDouble() { return true; }
+
+  double val;
+};
+
+//------------------------------------------------------------------------
+
 class CConstBoolValue: public CConstValue {
 public:
 
@@ -330,10 +330,10 @@ static BlockResult codeGenForContainerStmt(ForStmt *stmt, Context &ctx, Bytecode
   switch (res.type->type->kind()) {
   case CTypeKind::vectorType:
     elemType = std::unique_ptr<CTypeRef>(((CParamTypeRef *)res.type.get())->params[0]->copy());
-    ifirstFuncName = mangleVectorIfirstFuncName();
-    imoreFuncName = mangleVectorImoreFuncName();
-    inextFuncName = mangleVectorInextFuncName();
-    igetFuncName = mangleVectorIgetFuncName();
+    ifirstFuncName = mangleVectorIfirstFuncName(elemType.get());
+    imoreFuncName = mangleVectorImoreFuncName(elemType.get());
+    inextFuncName = mangleVectorInextFuncName(elemType.get());
+    igetFuncName = mangleVectorIgetFuncName(elemType.get());
     break;
   case CTypeKind::setType:
     elemType = std::unique_ptr<CTypeRef>(((CParamTypeRef *)res.type.get())->params[0]->copy());
@@ -31,10 +31,17 @@ static ExprResult codeGenFindSubstructFunc(const std::string &name,
 					   std::vector<ExprResult> &argResults,
 					   size_t substructArgIdx,
 					   Location loc, Context &ctx, BytecodeFile &bcFunc);
+static CTypeRef *genericSerDeserType(const std::string &name,
+				     std::vector<ExprResult> &argResults, Context &ctx);
+static ExprResult codeGenGenericSerDeser(const std::string &name, CTypeRef *typeRef,
+					 Location loc, Context &ctx, BytecodeFile &bcFunc);
+static bool makeSerSchema(CTypeRef *typeRef, std::vector<CType*> &structTypes,
+			  std::string &schema);
 static ExprResult codeGenMemberExpr(MemberExpr *expr, Context &ctx, BytecodeFile &bcFunc);
 static ExprResult codeGenIndexExpr(IndexExpr *expr, Context &ctx, BytecodeFile &bcFunc);
 static ExprResult codeGenParenExpr(ParenExpr *expr, Context &ctx, BytecodeFile &bcFunc);
 static ExprResult codeGenNewExpr(NewExpr *expr, Context &ctx, BytecodeFile &bcFunc);
+static bool codeGenNewCapacity(NewExpr *expr, Context &ctx, BytecodeFile &bcFunc);
 static ExprResult codeGenNewStringBufExpr(NewExpr *expr, std::unique_ptr<CTypeRef> typeRef,
 					  Context &ctx, BytecodeFile &bcFunc);
 static ExprResult codeGenNewContainerExpr(NewExpr *expr, std::unique_ptr<CTypeRef> typeRef,
@@ -64,6 +71,7 @@ static ExprResult codeGenLitIntExpr(LitIntExpr *expr, Context &ctx, BytecodeFile
 static ExprResult codeGenLitInt(const std::string &val, int radix, Location loc,
 				Context &ctx, BytecodeFile &bcFunc);
 static ExprResult codeGenLitFloatExpr(LitFloatExpr *expr, Context &ctx, BytecodeFile &bcFunc);
+static ExprResult codeGenLitDoubleExpr(LitDoubleExpr *expr, Context &ctx, BytecodeFile &bcFunc);
 static ExprResult codeGenLitBoolExpr(LitBoolExpr *expr, Context &ctx, BytecodeFile &bcFunc);
 static ExprResult codeGenLitCharExpr(LitCharExpr *expr, Context &ctx, BytecodeFile &bcFunc);
 static ExprResult codeGenLitStringExpr(LitStringExpr *expr, Context &ctx, BytecodeFile &bcFunc);
@@ -72,6 +80,7 @@ static ExprResult codeGenInterpStringExpr(InterpStringExpr *expr, Context &ctx,
 static bool codeGenInterpStringChars(InterpStringChars *chars, BytecodeFile &bcFunc);
 static bool codeGenInterpStringArg(InterpStringArg *arg, Context &ctx, BytecodeFile &bcFunc);
 static bool codeGenString(const std::string &s, Location loc, BytecodeFile &bcFunc);
+static void codeGenDouble(double x, BytecodeFile &bcFunc);
 
 //------------------------------------------------------------------------
 
@@ -83,43 +92,53 @@ struct BinaryOpInfo {
 };
 
 static std::vector<BinaryOpInfo> binaryOpInfo {
-  { BinaryOp::orOp,    TypeCheckKind::tInt,   bcOpcodeOr,    TypeCheckKind::tInt   },
-  { BinaryOp::orOp,    TypeCheckKind::tBool,  bcOpcodeOr,    TypeCheckKind::tBool  },
-  { BinaryOp::xorOp,   TypeCheckKind::tInt,   bcOpcodeXor,   TypeCheckKind::tInt   },
-  { BinaryOp::xorOp,   TypeCheckKind::tBool,  bcOpcodeXor,   TypeCheckKind::tBool  },
-  { BinaryOp::andOp,   TypeCheckKind::tInt,   bcOpcodeAnd,   TypeCheckKind::tInt   },
-  { BinaryOp::andOp,   TypeCheckKind::tBool,  bcOpcodeAnd,   TypeCheckKind::tBool  },
-  { BinaryOp::eq,      TypeCheckKind::tInt,   bcOpcodeCmpeq, TypeCheckKind::tBool  },
-  { BinaryOp::eq,      TypeCheckKind::tFloat, bcOpcodeCmpeq, TypeCheckKind::tBool  },
-  { BinaryOp::eq,      TypeCheckKind::tBool,  bcOpcodeCmpeq, TypeCheckKind::tBool  },
-  { BinaryOp::eq,      TypeCheckKind::tEnum,  bcOpcodeCmpeq, TypeCheckKind::tBool  },
-  { BinaryOp::ne,      TypeCheckKind::tInt,   bcOpcodeCmpne, TypeCheckKind::tBool  },
-  { BinaryOp::ne,      TypeCheckKind::tFloat, bcOpcodeCmpne, TypeCheckKind::tBool  },
-  { BinaryOp::ne,      TypeCheckKind::tBool,  bcOpcodeCmpne, TypeCheckKind::tBool  },
-  { BinaryOp::ne,      TypeCheckKind::tEnum,  bcOpcodeCmpne, TypeCheckKind::tBool  },
-  { BinaryOp::lt,      TypeCheckKind::tInt,   bcOpcodeCmplt, TypeCheckKind::tBool  },
-  { BinaryOp::lt,      TypeCheckKind::tFloat, bcOpcodeCmplt, TypeCheckKind::tBool  },
-  { BinaryOp::lt,      TypeCheckKind::tEnum,  bcOpcodeCmplt, TypeCheckKind::tBool  },
-  { BinaryOp::gt,      TypeCheckKind::tInt,   bcOpcodeCmpgt, TypeCheckKind::tBool  },
-  { BinaryOp::gt,      TypeCheckKind::tFloat, bcOpcodeCmpgt, TypeCheckKind::tBool  },
-  { BinaryOp::gt,      TypeCheckKind::tEnum,  bcOpcodeCmpgt, TypeCheckKind::tBool  },
-  { BinaryOp::le,      TypeCheckKind::tInt,   bcOpcodeCmple, TypeCheckKind::tBool  },
-  { BinaryOp::le,      TypeCheckKind::tFloat, bcOpcodeCmple, TypeCheckKind::tBool  },
-  { BinaryOp::le,      TypeCheckKind::tEnum,  bcOpcodeCmple, TypeCheckKind::tBool  },
-  { BinaryOp::ge,      TypeCheckKind::tInt,   bcOpcodeCmpge, TypeCheckKind::tBool  },
-  { BinaryOp::ge,      TypeCheckKind::tFloat, bcOpcodeCmpge, TypeCheckKind::tBool  },
-  { BinaryOp::ge,      TypeCheckKind::tEnum,  bcOpcodeCmpge, TypeCheckKind::tBool  },
-  { BinaryOp::shl,     TypeCheckKind::tInt,   bcOpcodeSll,   TypeCheckKind::tInt   },
-  { BinaryOp::shr,     TypeCheckKind::tInt,   bcOpcodeSra,   TypeCheckKind::tInt   },
-  { BinaryOp::add,     TypeCheckKind::tInt,   bcOpcodeAdd,   TypeCheckKind::tInt   },
-  { BinaryOp::add,     TypeCheckKind::tFloat, bcOpcodeAdd,   TypeCheckKind::tFloat },
-  { BinaryOp::sub,     TypeCheckKind::tInt,   bcOpcodeSub,   TypeCheckKind::tInt   },
-  { BinaryOp::sub,     TypeCheckKind::tFloat, bcOpcodeSub,   TypeCheckKind::tFloat },
-  { BinaryOp::mul,     TypeCheckKind::tInt,   bcOpcodeMul,   TypeCheckKind::tInt   },
-  { BinaryOp::mul,     TypeCheckKind::tFloat, bcOpcodeMul,   TypeCheckKind::tFloat },
-  { BinaryOp::div,     TypeCheckKind::tInt,   bcOpcodeDiv,   TypeCheckKind::tInt   },
-  { BinaryOp::div,     TypeCheckKind::tFloat, bcOpcodeDiv,   TypeCheckKind::tFloat },
-  { BinaryOp::mod,     TypeCheckKind::tInt,   bcOpcodeMod,   TypeCheckKind::tInt   }
+  { BinaryOp::orOp,    TypeCheckKind::tInt,    bcOpcodeOr,    TypeCheckKind::tInt    },
+  { BinaryOp::orOp,    TypeCheckKind::tBool,   bcOpcodeOr,    TypeCheckKind::tBool   },
+  { BinaryOp::xorOp,   TypeCheckKind::tInt,    bcOpcodeXor,   TypeCheckKind::tInt    },
+  { BinaryOp::xorOp,   TypeCheckKind::tBool,   bcOpcodeXor,   TypeCheckKind::tBool   },
+  { BinaryOp::andOp,   TypeCheckKind::tInt,    bcOpcodeAnd,   TypeCheckKind::tInt    },
+  { BinaryOp::andOp,   TypeCheckKind::tBool,   bcOpcodeAnd,   TypeCheckKind::tBool   },
+  { BinaryOp::eq,      TypeCheckKind::tInt,    bcOpcodeCmpeq, TypeCheckKind::tBool   },
+  { BinaryOp::eq,      TypeCheckKind::tFloat,  bcOpcodeCmpeq, TypeCheckKind::tBool   },
+  { BinaryOp::eq,      TypeCheckKind::tDouble, bcOpcodeCmpeq, TypeCheckKind::tBool   },
+  { BinaryOp::eq,      TypeCheckKind::tBool,   bcOpcodeCmpeq, TypeCheckKind::tBool   },
+  { BinaryOp::eq,      TypeCheckKind::tEnum,   bcOpcodeCmpeq, TypeCheckKind::tBool   },
+  { BinaryOp::ne,      TypeCheckKind::tInt,    bcOpcodeCmpne, TypeCheckKind::tBool   },
+  { BinaryOp::ne,      TypeCheckKind::tFloat,  bcOpcodeCmpne, TypeCheckKind::tBool   },
+  { BinaryOp::ne,      TypeCheckKind::tDouble, bcOpcodeCmpne, TypeCheckKind::tBool   },
+  { BinaryOp::ne,      TypeCheckKind::tBool,   bcOpcodeCmpne, TypeCheckKind::tBool   },
+  { BinaryOp::ne,      TypeCheckKind::tEnum,   bcOpcodeCmpne, TypeCheckKind::tBool   },
+  { BinaryOp::lt,      TypeCheckKind::tInt,    bcOpcodeCmplt, TypeCheckKind::tBool   },
+  { BinaryOp::lt,      TypeCheckKind::tFloat,  bcOpcodeCmplt, TypeCheckKind::tBool   },
+  { BinaryOp::lt,      TypeCheckKind::tDouble, bcOpcodeCmplt, TypeCheckKind::tBool   },
+  { BinaryOp::lt,      TypeCheckKind::tEnum,   bcOpcodeCmplt, TypeCheckKind::tBool   },
+  { BinaryOp::gt,      TypeCheckKind::tInt,    bcOpcodeCmpgt, TypeCheckKind::tBool   },
+  { BinaryOp::gt,      TypeCheckKind::tFloat,  bcOpcodeCmpgt, TypeCheckKind::tBool   },
+  { BinaryOp::gt,      TypeCheckKind::tDouble, bcOpcodeCmpgt, TypeCheckKind::tBool   },
+  { BinaryOp::gt,      TypeCheckKind::tEnum,   bcOpcodeCmpgt, TypeCheckKind::tBool   },
+  { BinaryOp::le,      TypeCheckKind::tInt,    bcOpcodeCmple, TypeCheckKind::tBool   },
+  { BinaryOp::le,      TypeCheckKind::tFloat,  bcOpcodeCmple, TypeCheckKind::tBool   },
+  { BinaryOp::le,      TypeCheckKind::tDouble, bcOpcodeCmple, TypeCheckKind::tBool   },
+  { BinaryOp::le,      TypeCheckKind::tEnum,   bcOpcodeCmple, TypeCheckKind::tBool   },
+  { BinaryOp::ge,      TypeCheckKind::tInt,    bcOpcodeCmpge, TypeCheckKind::tBool   },
+  { BinaryOp::ge,      TypeCheckKind::tFloat,  bcOpcodeCmpge, TypeCheckKind::tBool   },
+  { BinaryOp::ge,      TypeCheckKind::tDouble, bcOpcodeCmpge, TypeCheckKind::tBool   },
+  { BinaryOp::ge,      TypeCheckKind::tEnum,   bcOpcodeCmpge, TypeCheckKind::tBool   },
+  { BinaryOp::shl,     TypeCheckKind::tInt,    bcOpcodeSll,   TypeCheckKind::tInt    },
+  { BinaryOp::shr,     TypeCheckKind::tInt,    bcOpcodeSra,   TypeCheckKind::tInt    },
+  { BinaryOp::add,     TypeCheckKind::tInt,    bcOpcodeAdd,   TypeCheckKind::tInt    },
+  { BinaryOp::add,     TypeCheckKind::tFloat,  bcOpcodeAdd,   TypeCheckKind::tFloat  },
+  { BinaryOp::add,     TypeCheckKind::tDouble, bcOpcodeAdd,   TypeCheckKind::tDouble },
+  { BinaryOp::sub,     TypeCheckKind::tInt,    bcOpcodeSub,   TypeCheckKind::tInt    },
+  { BinaryOp::sub,     TypeCheckKind::tFloat,  bcOpcodeSub,   TypeCheckKind::tFloat  },
+  { BinaryOp::sub,     TypeCheckKind::tDouble, bcOpcodeSub,   TypeCheckKind::tDouble },
+  { BinaryOp::mul,     TypeCheckKind::tInt,    bcOpcodeMul,   TypeCheckKind::tInt    },
+  { BinaryOp::mul,     TypeCheckKind::tFloat,  bcOpcodeMul,   TypeCheckKind::tFloat  },
+  { BinaryOp::mul,     TypeCheckKind::tDouble, bcOpcodeMul,   TypeCheckKind::tDouble },
+  { BinaryOp::div,     TypeCheckKind::tInt,    bcOpcodeDiv,   TypeCheckKind::tInt    },
+  { BinaryOp::div,     TypeCheckKind::tFloat,  bcOpcodeDiv,   TypeCheckKind::tFloat  },
+  { BinaryOp::div,     TypeCheckKind::tDouble, bcOpcodeDiv,   TypeCheckKind::tDouble },
+  { BinaryOp::mod,     TypeCheckKind::tInt,    bcOpcodeMod,   TypeCheckKind::tInt    }
 };
 
 struct UnaryOpInfo {
@@ -130,10 +149,11 @@ struct UnaryOpInfo {
 };
 
 static std::vector<UnaryOpInfo> unaryOpInfo {
-  { UnaryOp::neg,   TypeCheckKind::tInt,   bcOpcodeNeg, TypeCheckKind::tInt   },
-  { UnaryOp::neg,   TypeCheckKind::tFloat, bcOpcodeNeg, TypeCheckKind::tFloat },
-  { UnaryOp::notOp, TypeCheckKind::tInt,   bcOpcodeNot, TypeCheckKind::tInt   },
-  { UnaryOp::notOp, TypeCheckKind::tBool,  bcOpcodeNot, TypeCheckKind::tBool  }
+  { UnaryOp::neg,   TypeCheckKind::tInt,    bcOpcodeNeg, TypeCheckKind::tInt    },
+  { UnaryOp::neg,   TypeCheckKind::tFloat,  bcOpcodeNeg, TypeCheckKind::tFloat  },
+  { UnaryOp::neg,   TypeCheckKind::tDouble, bcOpcodeNeg, TypeCheckKind::tDouble },
+  { UnaryOp::notOp, TypeCheckKind::tInt,    bcOpcodeNot, TypeCheckKind::tInt    },
+  { UnaryOp::notOp, TypeCheckKind::tBool,   bcOpcodeNot, TypeCheckKind::tBool   }
 };
 
 //------------------------------------------------------------------------
@@ -184,6 +204,8 @@ ExprResult codeGenExpr(Expr *expr, Context &ctx, BytecodeFile &bcFunc) {
     return codeGenLitIntExpr((LitIntExpr *)expr, ctx, bcFunc);
   case Expr::Kind::litFloatExpr:
     return codeGenLitFloatExpr((LitFloatExpr *)expr, ctx, bcFunc);
+  case Expr::Kind::litDoubleExpr:
+    return codeGenLitDoubleExpr((LitDoubleExpr *)expr, ctx, bcFunc);
   case Expr::Kind::litBoolExpr:
     return codeGenLitBoolExpr((LitBoolExpr *)expr, ctx, bcFunc);
   case Expr::Kind::litCharExpr:
@@ -408,10 +430,11 @@ static ExprResult codeGenUnaryOpExpr(UnaryOpExpr *expr, Context &ctx, BytecodeFi
 
 static std::unique_ptr<CTypeRef> makeResultType(TypeCheckKind kind, Location loc, Context &ctx) {
   switch (kind) {
-  case TypeCheckKind::tInt:   return std::make_unique<CSimpleTypeRef>(loc, ctx.intType);
-  case TypeCheckKind::tFloat: return std::make_unique<CSimpleTypeRef>(loc, ctx.floatType);
-  case TypeCheckKind::tBool:  return std::make_unique<CSimpleTypeRef>(loc, ctx.boolType);
-  default:                    return nullptr;
+  case TypeCheckKind::tInt:    return std::make_unique<CSimpleTypeRef>(loc, ctx.intType);
+  case TypeCheckKind::tFloat:  return std::make_unique<CSimpleTypeRef>(loc, ctx.floatType);
+  case TypeCheckKind::tDouble: return std::make_unique<CSimpleTypeRef>(loc, ctx.doubleType);
+  case TypeCheckKind::tBool:   return std::make_unique<CSimpleTypeRef>(loc, ctx.boolType);
+  default:                     return nullptr;
   }
 }
 
@@ -505,6 +528,15 @@ static ExprResult codeGenCallExpr(CallExpr *expr, Context &ctx, BytecodeFile &bc
     argResults.push_back(std::move(res));
   }
 
+  //--- compiler-generated ser/deser
+  if (expr->func->kind() == Expr::Kind::identExpr && substructArgIdx == expr->args.size()) {
+    std::string name = ((IdentExpr *)expr->func.get())->name;
+    CTypeRef *serType = genericSerDeserType(name, argResults, ctx);
+    if (serType) {
+      return codeGenGenericSerDeser(name, serType, expr->loc, ctx, bcFunc);
+    }
+  }
+
   //--- push the arg count
   bcFunc.addPushIInstr((int64_t)argResults.size());
 
@@ -678,6 +710,144 @@ static ExprResult codeGenFindSubstructFunc(const std::string &name,
   return ExprResult(std::move(returnType));
 }
 
+// Calls to ser(val: T, out: StringBuf) and deser(in: DeserBuf,
+// nil[T]) -> Result[T], where T is a struct, varstruct, or container
+// type, and there is no matching user-defined function, are handled
+// by the runtime's generic serializer. Returns T if [name] and
+// [argResults] are one of those calls.
+static CTypeRef *genericSerDeserType(const std::string &name,
+				     std::vector<ExprResult> &argResults, Context &ctx) {
+  if (argResults.size() != 2) {
+    return nullptr;
+  }
+  CTypeRef *typeRef;
+  if (name == "ser") {
+    if (!typeCheckStringBuf(argResults[1].type.get())) {
+      return nullptr;
+    }
+    typeRef = argResults[0].type.get();
+  } else if (name == "deser") {
+    if (!typeCheckStruct(argResults[0].type.get()) ||
+	argResults[0].type->type->name != "DeserBuf") {
+      return nullptr;
+    }
+    typeRef = argResults[1].type.get();
+  } else {
+    return nullptr;
+  }
+  if (!typeCheckStruct(typeRef) && !typeCheckVarStruct(typeRef) &&
+      !typeCheckContainer(typeRef)) {
+    return nullptr;
+  }
+  if (ctx.findFunction(name, argResults)) {
+    return nullptr;
+  }
+  return typeRef;
+}
+
+// The args have already been pushed. This adds the schema string
+// (see runtime_serdeser.cpp) as a third arg, and calls _ser or
+// _deser.
+static ExprResult codeGenGenericSerDeser(const std::string &name, CTypeRef *typeRef,
+					 Location loc, Context &ctx, BytecodeFile &bcFunc) {
+  std::vector<CType*> structTypes;
+  std::string schema;
+  if (!makeSerSchema(typeRef, structTypes, schema)) {
+    error(loc, "Type '%s' can't be serialized", typeRef->toString().c_str());
+    return ExprResult();
+  }
+  if (!codeGenString(schema, loc, bcFunc)) {
+    return ExprResult();
+  }
+  bcFunc.addPushIInstr(3);
+  if (name == "ser") {
+    bcFunc.addPushNativeInstr("_ser");
+    bcFunc.addInstr(bcOpcodeCall);
+    bcFunc.addInstr(bcOpcodePop);
+    return ExprResult(nullptr);
+  }
+  bcFunc.addPushNativeInstr("_deser");
+  bcFunc.addInstr(bcOpcodeCall);
+  std::vector<std::unique_ptr<CTypeRef>> params;
+  params.push_back(std::unique_ptr<CTypeRef>(typeRef->copy()));
+  return ExprResult(std::make_unique<CParamTypeRef>(loc, ctx.resultType,
+						    false, std::move(params)));
+}
+
+// Append the schema string for [typeRef] to [schema]. [structTypes]
+// lists the struct/varstruct types already in the schema, which are
+// written as back-references. Returns false if the type can't be
+// serialized.
+static bool makeSerSchema(CTypeRef *typeRef, std::vector<CType*> &structTypes,
+			  std::string &schema) {
+  if (typeCheckInt(typeRef)) {
+    schema += 'i';
+  } else if (typeCheckEnum(typeRef)) {
+    schema += 'e';
+  } else if (typeCheckFloat(typeRef)) {
+    schema += 'f';
+  } else if (typeCheckDouble(typeRef)) {
+    schema += 'd';
+  } else if (typeCheckBool(typeRef)) {
+    schema += 'b';
+  } else if (typeCheckString(typeRef)) {
+    schema += 's';
+  } else if (typeCheckVector(typeRef) || typeCheckSet(typeRef) || typeCheckMap(typeRef)) {
+    CParamTypeRef *paramTypeRef = (CParamTypeRef *)typeRef;
+    schema += typeCheckVector(typeRef) ? 'v' : typeCheckSet(typeRef) ? 'z' : 'm';
+    for (std::unique_ptr<CTypeRef> &param : paramTypeRef->params) {
+      if (!makeSerSchema(param.get(), structTypes, schema)) {
+	return false;
+      }
+    }
+  } else if (typeCheckStruct(typeRef) || typeCheckVarStruct(typeRef)) {
+    for (size_t i = 0; i < structTypes.size(); ++i) {
+      if (structTypes[i] == typeRef->type) {
+	schema += "@" + std::to_string(i) + ":";
+	return true;
+      }
+    }
+    structTypes.push_back(typeRef->type);
+
+    // collect the fields (for a varstruct: one list per substruct),
+    // in field index order
+    std::vector<std::vector<CField*>> fieldLists;
+    if (typeCheckStruct(typeRef)) {
+      CStructType *type = (CStructType *)typeRef->type;
+      std::vector<CField*> fields(type->fields.size());
+      for (auto &pair : type->fields) {
+	fields[pair.second->fieldIdx] = pair.second.get();
+      }
+      fieldLists.push_back(fields);
+      schema += "r";
+    } else {
+      CVarStructType *type = (CVarStructType *)typeRef->type;
+      for (CSubStructType *subType : type->subStructs) {
+	std::vector<CField*> fields(type->fields.size() + subType->fields.size());
+	for (auto &pair : type->fields) {
+	  fields[pair.second->fieldIdx - 1] = pair.second.get();
+	}
+	for (auto &pair : subType->fields) {
+	  fields[pair.second->fieldIdx - 1] = pair.second.get();
+	}
+	fieldLists.push_back(fields);
+      }
+      schema += "u" + std::to_string(fieldLists.size()) + ":";
+    }
+    for (std::vector<CField*> &fields : fieldLists) {
+      schema += std::to_string(fields.size()) + ":";
+      for (CField *field : fields) {
+	if (!makeSerSchema(field->type.get(), structTypes, schema)) {
+	  return false;
+	}
+      }
+    }
+  } else {
+    return false;
+  }
+  return true;
+}
+
 static ExprResult codeGenMemberExpr(MemberExpr *expr, Context &ctx, BytecodeFile &bcFunc) {
   //--- enum member
 
@@ -829,9 +999,30 @@ static ExprResult codeGenNewExpr(NewExpr *expr, Context &ctx, BytecodeFile &bcFu
   }
 }
 
+// Generate code for the optional capacity arg in a 'new' expression,
+// and push the arg count. Returns false on error.
+static bool codeGenNewCapacity(NewExpr *expr, Context &ctx, BytecodeFile &bcFunc) {
+  if (!expr->capacity) {
+    bcFunc.addPushIInstr(0);
+    return true;
+  }
+  ExprResult res = codeGenExpr(expr->capacity.get(), ctx, bcFunc);
+  if (!res.ok) {
+    return false;
+  }
+  if (!res.type || !typeCheckInt(res.type.get())) {
+    error(expr->capacity->loc, "Capacity in 'new' must be Int");
+    return false;
+  }
+  bcFunc.addPushIInstr(1);
+  return true;
+}
+
 static ExprResult codeGenNewStringBufExpr(NewExpr *expr, std::unique_ptr<CTypeRef> typeRef,
 					  Context &ctx, BytecodeFile &bcFunc) {
-  bcFunc.addPushIInstr(0);
+  if (!codeGenNewCapacity(expr, ctx, bcFunc)) {
+    return ExprResult();
+  }
   bcFunc.addPushNativeInstr("_allocStringBuf");
   bcFunc.addInstr(bcOpcodeCall);
   return ExprResult(std::move(typeRef));
@@ -840,10 +1031,13 @@ static ExprResult codeGenNewStringBufExpr(NewExpr *expr, std::unique_ptr<CTypeRe
 static ExprResult codeGenNewContainerExpr(NewExpr *expr, std::unique_ptr<CTypeRef> typeRef,
 					  CContainerType *type,
 					  Context &ctx, BytecodeFile &bcFunc) {
-  bcFunc.addPushIInstr(0);
+  if (!codeGenNewCapacity(expr, ctx, bcFunc)) {
+    return ExprResult();
+  }
   switch (type->kind()) {
   case CTypeKind::vectorType:
-    bcFunc.addPushNativeInstr("_allocVector");
+    bcFunc.addPushNativeInstr(mangleVectorAllocFuncName(
+				  ((CParamTypeRef *)typeRef.get())->params[0].get()));
     break;
   case CTypeKind::setType:
     bcFunc.addPushNativeInstr("_allocSet");
@@ -1168,6 +1362,9 @@ static ExprResult codeGenConstValue(CConstValue *val, Location loc,
   } else if (val->isFloat()) {
     bcFunc.addPushFInstr(((CConstFloatValue *)val)->val);
     return ExprResult(std::make_unique<CSimpleTypeRef>(loc, ctx.floatType));
+  } else if (val->isDouble()) {
+    codeGenDouble(((CConstDoubleValue *)val)->val, bcFunc);
+    return ExprResult(std::make_unique<CSimpleTypeRef>(loc, ctx.doubleType));
   } else if (val->isBool()) {
     bcFunc.addInstr(((CConstBoolValue *)val)->val ? bcOpcodePushTrue : bcOpcodePushFalse);
     return ExprResult(std::make_unique<CSimpleTypeRef>(loc, ctx.boolType));
@@ -1183,9 +1380,15 @@ static ExprResult codeGenConstValue(CConstValue *val, Location loc,
 }
 
 static ExprResult codeGenLitVectorExpr(LitVectorExpr *expr, Context &ctx, BytecodeFile &bcFunc) {
-  bcFunc.addPushIInstr(0);
-  bcFunc.addPushNativeInstr("_allocVector");
-  bcFunc.addInstr(bcOpcodeCall);
+  // the element type (and therefore the alloc function) isn't known
+  // until after generating code for the first element, so the
+  // allocation is placed after the element code, and branches back
+  // to it
+  uint32_t allocLabel = bcFunc.allocCodeLabel();
+  uint32_t elemsLabel = bcFunc.allocCodeLabel();
+  uint32_t endLabel = bcFunc.allocCodeLabel();
+  bcFunc.addBranchInstr(bcOpcodeBranch, allocLabel);
+  bcFunc.setCodeLabel(elemsLabel);
 
   std::unique_ptr<CTypeRef> elemType;
   for (size_t i = 0; i < expr->vals.size(); ++i) {
@@ -1207,10 +1410,20 @@ static ExprResult codeGenLitVectorExpr(LitVectorExpr *expr, Context &ctx, Byteco
       }
     }
     bcFunc.addPushIInstr(2);
-    bcFunc.addPushNativeInstr(mangleVectorAppendFuncName());
+    bcFunc.addPushNativeInstr(mangleVectorAppendFuncName(elemType.get()));
     bcFunc.addInstr(bcOpcodeCall);
     bcFunc.addInstr(bcOpcodePop);
   }
+  bcFunc.addBranchInstr(bcOpcodeBranch, endLabel);
+
+  // allocate the vector, with enough capacity for the elements
+  bcFunc.setCodeLabel(allocLabel);
+  bcFunc.addPushIInstr((int64_t)expr->vals.size());
+  bcFunc.addPushIInstr(1);
+  bcFunc.addPushNativeInstr(mangleVectorAllocFuncName(elemType.get()));
+  bcFunc.addInstr(bcOpcodeCall);
+  bcFunc.addBranchInstr(bcOpcodeBranch, elemsLabel);
+  bcFunc.setCodeLabel(endLabel);
 
   std::vector<std::unique_ptr<CTypeRef>> params;
   params.push_back(std::move(elemType));
@@ -1221,7 +1434,8 @@ static ExprResult codeGenLitVectorExpr(LitVectorExpr *expr, Context &ctx, Byteco
 }
 
 static ExprResult codeGenLitSetExpr(LitSetExpr *expr, Context &ctx, BytecodeFile &bcFunc) {
-  bcFunc.addPushIInstr(0);
+  bcFunc.addPushIInstr((int64_t)expr->vals.size());
+  bcFunc.addPushIInstr(1);
   bcFunc.addPushNativeInstr("_allocSet");
   bcFunc.addInstr(bcOpcodeCall);
 
@@ -1267,7 +1481,8 @@ static ExprResult codeGenLitSetExpr(LitSetExpr *expr, Context &ctx, BytecodeFile
 }
 
 static ExprResult codeGenLitMapExpr(LitMapExpr *expr, Context &ctx, BytecodeFile &bcFunc) {
-  bcFunc.addPushIInstr(0);
+  bcFunc.addPushIInstr((int64_t)expr->pairs.size());
+  bcFunc.addPushIInstr(1);
   bcFunc.addPushNativeInstr("_allocMap");
   bcFunc.addInstr(bcOpcodeCall);
 
@@ -1350,6 +1565,13 @@ static ExprResult codeGenLitFloatExpr(LitFloatExpr *expr, Context &ctx, Bytecode
   return ExprResult(std::make_unique<CSimpleTypeRef>(expr->loc, ctx.floatType));
 }
 
+static ExprResult codeGenLitDoubleExpr(LitDoubleExpr *expr, Context &ctx, BytecodeFile &bcFunc) {
+  double x;
+  stringToDouble(expr->val, x);
+  codeGenDouble(x, bcFunc);
+  return ExprResult(std::make_unique<CSimpleTypeRef>(expr->loc, ctx.doubleType));
+}
+
 static ExprResult codeGenLitBoolExpr(LitBoolExpr *expr, Context &ctx, BytecodeFile &bcFunc) {
   bcFunc.addInstr(expr->val ? bcOpcodePushTrue : bcOpcodePushFalse);
   return ExprResult(std::make_unique<CSimpleTypeRef>(expr->loc, ctx.boolType));
@@ -1367,8 +1589,21 @@ static ExprResult codeGenLitStringExpr(LitStringExpr *expr, Context &ctx, Byteco
   return ExprResult(std::make_unique<CSimpleTypeRef>(expr->loc, ctx.stringType));
 }
 
+// Each part of an interpolated string is pushed as four values
+// (value, width, precision, format), and the _interp function
+// formats all of them into a single string.
 static ExprResult codeGenInterpStringExpr(InterpStringExpr *expr, Context &ctx,
 					  BytecodeFile &bcFunc) {
+  // a string with no args is just a literal
+  if (expr->parts.size() == 1 &&
+      expr->parts[0]->kind() == InterpStringPart::Kind::interpStringChars) {
+    if (!codeGenString(((InterpStringChars *)expr->parts[0].get())->chars,
+		       expr->parts[0]->loc, bcFunc)) {
+      return ExprResult();
+    }
+    return ExprResult(std::make_unique<CSimpleTypeRef>(expr->loc, ctx.stringType));
+  }
+
   for (size_t i = 0; i < expr->parts.size(); ++i) {
     InterpStringPart *part = expr->parts[i].get();
     if (part->kind() == InterpStringPart::Kind::interpStringChars) {
@@ -1383,17 +1618,21 @@ static ExprResult codeGenInterpStringExpr(InterpStringExpr *expr, Context &ctx,
       error(part->loc, "Internal: codeGenInterpStringExpr");
       return ExprResult();
     }
-    if (i > 0) {
-      bcFunc.addPushIInstr(2);
-      bcFunc.addPushNativeInstr(mangleStringConcatFuncName());
-      bcFunc.addInstr(bcOpcodeCall);
-    }
   }
+  bcFunc.addPushIInstr(4 * (int64_t)expr->parts.size());
+  bcFunc.addPushNativeInstr(mangleInterpStringFuncName());
+  bcFunc.addInstr(bcOpcodeCall);
   return ExprResult(std::make_unique<CSimpleTypeRef>(expr->loc, ctx.stringType));
 }
 
 static bool codeGenInterpStringChars(InterpStringChars *chars, BytecodeFile &bcFunc) {
-  return codeGenString(chars->chars, chars->loc, bcFunc);
+  if (!codeGenString(chars->chars, chars->loc, bcFunc)) {
+    return false;
+  }
+  bcFunc.addPushIInstr(0);
+  bcFunc.addPushIInstr(-1);
+  bcFunc.addPushIInstr(0);
+  return true;
 }
 
 static bool codeGenInterpStringArg(InterpStringArg *arg, Context &ctx, BytecodeFile &bcFunc) {
@@ -1405,25 +1644,17 @@ static bool codeGenInterpStringArg(InterpStringArg *arg, Context &ctx, BytecodeF
     error(arg->loc, "Non-value used in interpolated string");
     return false;
   }
-  std::string formatFunc;
-  if (typeCheckInt(res.type.get())) {
-    formatFunc = mangleIntFormatFuncName();
-  } else if (typeCheckFloat(res.type.get())) {
-    formatFunc = mangleFloatFormatFuncName();
-  } else if (typeCheckBool(res.type.get())) {
-    formatFunc = mangleBoolFormatFuncName();
-  } else if (typeCheckString(res.type.get())) {
-    formatFunc = mangleStringFormatFuncName();
-  } else {
+  if (!typeCheckInt(res.type.get()) &&
+      !typeCheckFloat(res.type.get()) &&
+      !typeCheckDouble(res.type.get()) &&
+      !typeCheckBool(res.type.get()) &&
+      !typeCheckString(res.type.get())) {
     error(arg->loc, "Unsupported type for argument in interpolated string");
     return false;
   }
   bcFunc.addPushIInstr(arg->width);
   bcFunc.addPushIInstr(arg->precision);
   bcFunc.addPushIInstr(arg->format & 0xff);
-  bcFunc.addPushIInstr(4);
-  bcFunc.addPushNativeInstr(formatFunc);
-  bcFunc.addInstr(bcOpcodeCall);
   return true;
  }
 
@@ -1442,3 +1673,17 @@ static bool codeGenString(const std::string &s, Location loc, BytecodeFile &bcFu
   bcFunc.addPushDataInstr(label);
   return true;
 }
+
+// Doubles don't fit in a Cell, so a Double literal is stored in the
+// data segment, with the same layout as a heap Double (see
+// BytecodeDefs.h), and pushed as a pointer.
+static void codeGenDouble(double x, BytecodeFile &bcFunc) {
+  uint32_t label = bcFunc.allocAndSetDataLabel();
+  int64_t length = (int64_t)sizeof(double);
+  uint8_t tag = (uint8_t)(bytecodeDoubleTypeTag << 2);
+  bcFunc.addData(&tag, 1);
+  bcFunc.addData((uint8_t *)&length, 7);
+  bcFunc.addData((uint8_t *)&x, sizeof(double));
+  bcFunc.alignData();
+  bcFunc.addPushDataInstr(label);
+}
@@ -20,6 +20,7 @@ static std::unique_ptr<CConstValue> evalParenExpr(ParenExpr *expr, Context &ctx)
 static std::unique_ptr<CConstValue> evalIdentExpr(IdentExpr *expr, Context &ctx);
 static std::unique_ptr<CConstValue> evalLitIntExpr(LitIntExpr *expr, Context &ctx);
 static std::unique_ptr<CConstValue> evalLitFloatExpr(LitFloatExpr *expr, Context &ctx);
+static std::unique_ptr<CConstValue> evalLitDoubleExpr(LitDoubleExpr *expr, Context &ctx);
 static std::unique_ptr<CConstValue> evalLitBoolExpr(LitBoolExpr *expr, Context &ctx);
 static std::unique_ptr<CConstValue> evalLitStringExpr(LitStringExpr *expr, Context &ctx);
 
@@ -39,6 +40,8 @@ std::unique_ptr<CConstValue> evalConstExpr(Expr *expr, Context &ctx) {
     return evalLitIntExpr((LitIntExpr *)expr, ctx);
   case Expr::Kind::litFloatExpr:
     return evalLitFloatExpr((LitFloatExpr *)expr, ctx);
+  case Expr::Kind::litDoubleExpr:
+    return evalLitDoubleExpr((LitDoubleExpr *)expr, ctx);
   case Expr::Kind::litBoolExpr:
     return evalLitBoolExpr((LitBoolExpr *)expr, ctx);
   case Expr::Kind::litStringExpr:
@@ -99,6 +102,9 @@ static std::unique_ptr<CConstValue> evalBinaryOpExpr(BinaryOpExpr *expr, Context
     } else if (lhs->isFloat() && rhs->isFloat()) {
       return std::make_unique<CConstBoolValue>(((CConstFloatValue *)lhsPtr)->val ==
 					       ((CConstFloatValue *)rhsPtr)->val);
+    } else if (lhs->isDouble() && rhs->isDouble()) {
+      return std::make_unique<CConstBoolValue>(((CConstDoubleValue *)lhsPtr)->val ==
+					       ((CConstDoubleValue *)rhsPtr)->val);
     } else if (lhs->isBool() && rhs->isBool()) {
       return std::make_unique<CConstBoolValue>(((CConstBoolValue *)lhsPtr)->val ==
 					       ((CConstBoolValue *)rhsPtr)->val);
@@ -116,6 +122,9 @@ static std::unique_ptr<CConstValue> evalBinaryOpExpr(BinaryOpExpr *expr, Context
     } else if (lhs->isFloat() && rhs->isFloat()) {
       return std::make_unique<CConstBoolValue>(((CConstFloatValue *)lhsPtr)->val !=
 					       ((CConstFloatValue *)rhsPtr)->val);
+    } else if (lhs->isDouble() && rhs->isDouble()) {
+      return std::make_unique<CConstBoolValue>(((CConstDoubleValue *)lhsPtr)->val !=
+					       ((CConstDoubleValue *)rhsPtr)->val);
     } else if (lhs->isBool() && rhs->isBool()) {
       return std::make_unique<CConstBoolValue>(((CConstBoolValue *)lhsPtr)->val !=
 					       ((CConstBoolValue *)rhsPtr)->val);
@@ -139,6 +148,9 @@ static std::unique_ptr<CConstValue> evalBinaryOpExpr(BinaryOpExpr *expr, Context
     } else if (lhs->isFloat() && rhs->isFloat()) {
       return std::make_unique<CConstBoolValue>(((CConstFloatValue *)lhsPtr)->val <
 					       ((CConstFloatValue *)rhsPtr)->val);
+    } else if (lhs->isDouble() && rhs->isDouble()) {
+      return std::make_unique<CConstBoolValue>(((CConstDoubleValue *)lhsPtr)->val <
+					       ((CConstDoubleValue *)rhsPtr)->val);
     } else if (lhs->isString() && rhs->isString()) {
       return std::make_unique<CConstBoolValue>(((CConstStringValue *)lhsPtr)->val <
 					       ((CConstStringValue *)rhsPtr)->val);
@@ -153,6 +165,9 @@ static std::unique_ptr<CConstValue> evalBinaryOpExpr(BinaryOpExpr *expr, Context
     } else if (lhs->isFloat() && rhs->isFloat()) {
       return std::make_unique<CConstBoolValue>(((CConstFloatValue *)lhsPtr)->val >
 					       ((CConstFloatValue *)rhsPtr)->val);
+    } else if (lhs->isDouble() && rhs->isDouble()) {
+      return std::make_unique<CConstBoolValue>(((CConstDoubleValue *)lhsPtr)->val >
+					       ((CConstDoubleValue *)rhsPtr)->val);
     } else if (lhs->isString() && rhs->isString()) {
       return std::make_unique<CConstBoolValue>(((CConstStringValue *)lhsPtr)->val >
 					       ((CConstStringValue *)rhsPtr)->val);
@@ -167,6 +182,9 @@ static std::unique_ptr<CConstValue> evalBinaryOpExpr(BinaryOpExpr *expr, Context
     } else if (lhs->isFloat() && rhs->isFloat()) {
       return std::make_unique<CConstBoolValue>(((CConstFloatValue *)lhsPtr)->val <=
 					       ((CConstFloatValue *)rhsPtr)->val);
+    } else if (lhs->isDouble() && rhs->isDouble()) {
+      return std::make_unique<CConstBoolValue>(((CConstDoubleValue *)lhsPtr)->val <=
+					       ((CConstDoubleValue *)rhsPtr)->val);
     } else if (lhs->isString() && rhs->isString()) {
       return std::make_unique<CConstBoolValue>(((CConstStringValue *)lhsPtr)->val <=
 					       ((CConstStringValue *)rhsPtr)->val);
@@ -181,6 +199,9 @@ static std::unique_ptr<CConstValue> evalBinaryOpExpr(BinaryOpExpr *expr, Context
     } else if (lhs->isFloat() && rhs->isFloat()) {
       return std::make_unique<CConstBoolValue>(((CConstFloatValue *)lhsPtr)->val >=
 					       ((CConstFloatValue *)rhsPtr)->val);
+    } else if (lhs->isDouble() && rhs->isDouble()) {
+      return std::make_unique<CConstBoolValue>(((CConstDoubleValue *)lhsPtr)->val >=
+					       ((CConstDoubleValue *)rhsPtr)->val);
     } else if (lhs->isString() && rhs->isString()) {
       return std::make_unique<CConstBoolValue>(((CConstStringValue *)lhsPtr)->val >=
 					       ((CConstStringValue *)rhsPtr)->val);
@@ -215,6 +236,9 @@ static std::unique_ptr<CConstValue> evalBinaryOpExpr(BinaryOpExpr *expr, Context
     } else if (lhs->isFloat() && rhs->isFloat()) {
       return std::make_unique<CConstFloatValue>(((CConstFloatValue *)lhsPtr)->val +
 						((CConstFloatValue *)rhsPtr)->val);
+    } else if (lhs->isDouble() && rhs->isDouble()) {
+      return std::make_unique<CConstDoubleValue>(((CConstDoubleValue *)lhsPtr)->val +
+						 ((CConstDoubleValue *)rhsPtr)->val);
     } else if (lhs->isString() && rhs->isString()) {
       return std::make_unique<CConstStringValue>(((CConstStringValue *)lhsPtr)->val +
 						 ((CConstStringValue *)rhsPtr)->val);
@@ -233,6 +257,9 @@ static std::unique_ptr<CConstValue> evalBinaryOpExpr(BinaryOpExpr *expr, Context
     } else if (lhs->isFloat() && rhs->isFloat()) {
       return std::make_unique<CConstFloatValue>(((CConstFloatValue *)lhsPtr)->val -
 						((CConstFloatValue *)rhsPtr)->val);
+    } else if (lhs->isDouble() && rhs->isDouble()) {
+      return std::make_unique<CConstDoubleValue>(((CConstDoubleValue *)lhsPtr)->val -
+						 ((CConstDoubleValue *)rhsPtr)->val);
     } else {
       error(expr->loc, "Invalid types for '-' operator in constant expression");
       return nullptr;
@@ -251,6 +278,9 @@ static std::unique_ptr<CConstValue> evalBinaryOpExpr(BinaryOpExpr *expr, Context
     } else if (lhs->isFloat() && rhs->isFloat()) {
       return std::make_unique<CConstFloatValue>(((CConstFloatValue *)lhsPtr)->val *
 						((CConstFloatValue *)rhsPtr)->val);
+    } else if (lhs->isDouble() && rhs->isDouble()) {
+      return std::make_unique<CConstDoubleValue>(((CConstDoubleValue *)lhsPtr)->val *
+						 ((CConstDoubleValue *)rhsPtr)->val);
     } else {
       error(expr->loc, "Invalid types for '*' operator in constant expression");
       return nullptr;
@@ -272,6 +302,9 @@ static std::unique_ptr<CConstValue> evalBinaryOpExpr(BinaryOpExpr *expr, Context
     } else if (lhs->isFloat() && rhs->isFloat()) {
       return std::make_unique<CConstFloatValue>(((CConstFloatValue *)lhsPtr)->val /
 						((CConstFloatValue *)rhsPtr)->val);
+    } else if (lhs->isDouble() && rhs->isDouble()) {
+      return std::make_unique<CConstDoubleValue>(((CConstDoubleValue *)lhsPtr)->val /
+						 ((CConstDoubleValue *)rhsPtr)->val);
     } else {
       error(expr->loc, "Invalid types for '/' operator in constant expression");
       return nullptr;
@@ -314,6 +347,8 @@ static std::unique_ptr<CConstValue> evalUnaryOpExpr(UnaryOpExpr *expr, Context &
       return std::make_unique<CConstIntValue>(x);
     } else if (val->isFloat()) {
       return std::make_unique<CConstFloatValue>(-((CConstFloatValue *)valPtr)->val);
+    } else if (val->isDouble()) {
+      return std::make_unique<CConstDoubleValue>(-((CConstDoubleValue *)valPtr)->val);
     } else {
       error(expr->loc, "Invalid type for unary '-' operator in constant expression");
       return nullptr;
@@ -373,6 +408,12 @@ static std::unique_ptr<CConstValue> evalLitFloatExpr(LitFloatExpr *expr, Context
   return std::make_unique<CConstFloatValue>(val);
 }
 
+static std::unique_ptr<CConstValue> evalLitDoubleExpr(LitDoubleExpr *expr, Context &ctx) {
+  double val;
+  stringToDouble(expr->val, val);
+  return std::make_unique<CConstDoubleValue>(val);
+}
+
 static std::unique_ptr<CConstValue> evalLitBoolExpr(LitBoolExpr *expr, Context &ctx) {
   return std::make_unique<CConstBoolValue>(expr->val);
 }
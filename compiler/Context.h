@@ -50,7 +50,7 @@ public:
   Context()
     : topModule(nullptr)
     , vectorHeader(nullptr), setHeader(nullptr), mapHeader(nullptr)
-    , intType(nullptr), floatType(nullptr), boolType(nullptr)
+    , intType(nullptr), floatType(nullptr), doubleType(nullptr), boolType(nullptr)
     , stringType(nullptr), stringBufType(nullptr)
     , vectorType(nullptr), setType(nullptr), mapType(nullptr)
     , moduleBeingCompiled(nullptr), returnType(nullptr)
@@ -110,6 +110,7 @@ public:
   // convenience pointers to the builtin types
   CType *intType;
   CType *floatType;
+  CType *doubleType;
   CType *boolType;
   CType *stringType;
   CType *stringBufType;
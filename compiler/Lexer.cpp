@@ -97,6 +97,7 @@ static const char *tokenKindNames[] = {
   "octal integer literal",
   "hex integer literal",
   "floating point literal",
+  "double literal",
   "character literal",
   "string literal",
   "interpolated string",
@@ -349,7 +350,8 @@ Token Lexer::lexNumLiteral(char c0, char c1) {
   //--- check for floating point
   if (radix == 10 && mPos < mInput.size() && (mInput[mPos] == '.' ||
 					      mInput[mPos] == 'e' ||
-					      mInput[mPos] == 'E')) {
+					      mInput[mPos] == 'E' ||
+					      mInput[mPos] == 'd')) {
     if (mInput[mPos] == '.') {
       ++mPos;
       if (!(mPos < mInput.size() && mInput[mPos] >= '0' && mInput[mPos] <= '9')) {
@@ -379,6 +381,12 @@ Token Lexer::lexNumLiteral(char c0, char c1) {
 	c = mInput[mPos];
       } while (c >= '0' && c <= '9');
     }
+    // a 'd' suffix makes it a Double literal (the suffix isn't
+    // included in the token string)
+    if (mPos < mInput.size() && mInput[mPos] == 'd') {
+      ++mPos;
+      return Token(Token::Kind::doubleLiteral, mInput.substr(i0, mPos - 1 - i0), loc);
+    }
     return Token(Token::Kind::floatLiteral, mInput.substr(i0, mPos - i0), loc);
 
   //--- create an integer literal token
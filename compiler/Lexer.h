@@ -105,6 +105,7 @@ public:
     octalIntLiteral,
     hexIntLiteral,
     floatLiteral,
+    doubleLiteral,
     charLiteral,
     stringLiteral,
     interpString,
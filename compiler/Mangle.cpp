@@ -14,6 +14,7 @@
 //------------------------------------------------------------------------
 
 static std::string mangleTypeRef(CTypeRef *typeRef);
+static std::string mangleVectorElemCode(CTypeRef *elemType);
 
 //------------------------------------------------------------------------
 
@@ -25,7 +26,8 @@ std::string mangleFunctionName(CFuncDecl *func) {
       CParamTypeRef *arg0Type = (CParamTypeRef *)func->args[0]->type.get();
       switch (arg0Type->type->kind()) {
       case CTypeKind::vectorType:
-	s += "V" + std::to_string(func->args.size());
+	s += "V" + mangleVectorElemCode(arg0Type->params[0].get()) +
+	     std::to_string(func->args.size());
 	break;
       case CTypeKind::setType: {
 	CTypeRef *keyType = arg0Type->params[0].get();
@@ -81,6 +83,10 @@ static std::string mangleTypeRef(CTypeRef *typeRef) {
       return s;
     }
     case CTypeKind::resultType:
+      // Result[] (no value) only shows up inside a Func type
+      if (paramTypeRef->params.empty()) {
+	return "RN";
+      }
       return "R" + mangleTypeRef(paramTypeRef->params[0].get());
     default:
       error(paramTypeRef->loc, "Internal error: mangleTypeRef");
@@ -93,6 +99,8 @@ static std::string mangleTypeRef(CTypeRef *typeRef) {
       return "I";
     case CTypeKind::floatType:
       return "F";
+    case CTypeKind::doubleType:
+      return "D";
     case CTypeKind::boolType:
       return "B";
     case CTypeKind::stringType:
@@ -113,6 +121,21 @@ static std::string mangleTypeRef(CTypeRef *typeRef) {
   }
 }
 
+// Vectors of Int, Float, and Bool use specialized runtime functions
+// (which store raw values), so the builtin Vector function names
+// include the element type for those.
+static std::string mangleVectorElemCode(CTypeRef *elemType) {
+  if (typeCheckInt(elemType)) {
+    return "I";
+  } else if (typeCheckFloat(elemType)) {
+    return "F";
+  } else if (typeCheckBool(elemType)) {
+    return "B";
+  } else {
+    return "";
+  }
+}
+
 std::string mangleIntFormatFuncName() {
   return "format_IIII";
 }
@@ -137,24 +160,32 @@ std::string mangleStringFormatFuncName() {
   return "format_SIII";
 }
 
-std::string mangleVectorAppendFuncName() {
-  return "append_V2";
+std::string mangleInterpStringFuncName() {
+  return "_interp";
+}
+
+std::string mangleVectorAllocFuncName(CTypeRef *elemType) {
+  return "_allocVector" + mangleVectorElemCode(elemType);
+}
+
+std::string mangleVectorAppendFuncName(CTypeRef *elemType) {
+  return "append_V" + mangleVectorElemCode(elemType) + "2";
 }
 
-std::string mangleVectorIfirstFuncName() {
-  return "ifirst_V1";
+std::string mangleVectorIfirstFuncName(CTypeRef *elemType) {
+  return "ifirst_V" + mangleVectorElemCode(elemType) + "1";
 }
 
-std::string mangleVectorImoreFuncName() {
-  return "imore_V2";
+std::string mangleVectorImoreFuncName(CTypeRef *elemType) {
+  return "imore_V" + mangleVectorElemCode(elemType) + "2";
 }
 
-std::string mangleVectorInextFuncName() {
-  return "inext_V2";
+std::string mangleVectorInextFuncName(CTypeRef *elemType) {
+  return "inext_V" + mangleVectorElemCode(elemType) + "2";
 }
 
-std::string mangleVectorIgetFuncName() {
-  return "iget_V2";
+std::string mangleVectorIgetFuncName(CTypeRef *elemType) {
+  return "iget_V" + mangleVectorElemCode(elemType) + "2";
 }
 
 std::string mangleSetInsertFuncName(CTypeRef *elemType) {
@@ -26,12 +26,14 @@ extern std::string mangleBoolFormatFuncName();
 extern std::string mangleStringConcatFuncName();
 extern std::string mangleStringCompareFuncName();
 extern std::string mangleStringFormatFuncName();
-
-extern std::string mangleVectorAppendFuncName();
-extern std::string mangleVectorIfirstFuncName();
-extern std::string mangleVectorImoreFuncName();
-extern std::string mangleVectorInextFuncName();
-extern std::string mangleVectorIgetFuncName();
+extern std::string mangleInterpStringFuncName();
+
+extern std::string mangleVectorAllocFuncName(CTypeRef *elemType);
+extern std::string mangleVectorAppendFuncName(CTypeRef *elemType);
+extern std::string mangleVectorIfirstFuncName(CTypeRef *elemType);
+extern std::string mangleVectorImoreFuncName(CTypeRef *elemType);
+extern std::string mangleVectorInextFuncName(CTypeRef *elemType);
+extern std::string mangleVectorIgetFuncName(CTypeRef *elemType);
 
 extern std::string mangleSetInsertFuncName(CTypeRef *elemType);
 extern std::string mangleSetIfirstFuncName(CTypeRef *elemType);
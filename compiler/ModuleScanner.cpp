@@ -408,6 +408,8 @@ static bool scanConstDefn(ConstDefn *constDefn, CModule *cmod, Context &ctx) {
     type = std::make_unique<CSimpleTypeRef>(constDefn->loc, "Int");
   } else if (value->isFloat()) {
     type = std::make_unique<CSimpleTypeRef>(constDefn->loc, "Float");
+  } else if (value->isDouble()) {
+    type = std::make_unique<CSimpleTypeRef>(constDefn->loc, "Double");
   } else if (value->isBool()) {
     type = std::make_unique<CSimpleTypeRef>(constDefn->loc, "Bool");
   } else if (value->isString()) {
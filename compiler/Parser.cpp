@@ -1028,6 +1028,9 @@ std::unique_ptr<Expr> Parser::parseFactorExpr() {
   } else if (tok.is(Token::Kind::floatLiteral)) {
     lexer.shift();
     return std::make_unique<LitFloatExpr>(tok.loc(), tok.str());
+  } else if (tok.is(Token::Kind::doubleLiteral)) {
+    lexer.shift();
+    return std::make_unique<LitDoubleExpr>(tok.loc(), tok.str());
   } else if (tok.is(Token::Kind::keywordTrue)) {
     lexer.shift();
     return std::make_unique<LitBoolExpr>(tok.loc(), true);
@@ -1070,7 +1073,19 @@ std::unique_ptr<Expr> Parser::parseNewExpr() {
   if (!type) {
     return nullptr;
   }
-  return std::make_unique<NewExpr>(loc, std::move(type));
+  std::unique_ptr<Expr> capacity;
+  if (lexer.get(0).is(Token::Kind::puncParenL)) {
+    lexer.shift(); // left paren
+    capacity = parseExpr();
+    if (!capacity) {
+      return nullptr;
+    }
+    if (!expect(Token::Kind::puncParenR)) {
+      error(lexer.get(0).loc(), "Expected right paren after 'new' capacity");
+      return nullptr;
+    }
+  }
+  return std::make_unique<NewExpr>(loc, std::move(type), std::move(capacity));
 }
 
 std::unique_ptr<Expr> Parser::parseMakeExpr() {
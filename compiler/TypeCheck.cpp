@@ -80,6 +80,10 @@ bool typeCheckFloat(CTypeRef *typeRef) {
   return typeRef->type->kind() == CTypeKind::floatType;
 }
 
+bool typeCheckDouble(CTypeRef *typeRef) {
+  return typeRef->type->kind() == CTypeKind::doubleType;
+}
+
 bool typeCheckString(CTypeRef *typeRef) {
   return typeRef->type->kind() == CTypeKind::stringType;
 }
@@ -134,10 +138,11 @@ bool typeCheckPointer(CTypeRef *typeRef) {
 
 bool typeCheckOperand(CTypeRef *typeRef, TypeCheckKind kind) {
   switch (kind) {
-  case TypeCheckKind::tInt:   return typeCheckInt(typeRef);
-  case TypeCheckKind::tFloat: return typeCheckFloat(typeRef);
-  case TypeCheckKind::tBool:  return typeCheckBool(typeRef);
-  case TypeCheckKind::tEnum:  return typeCheckEnum(typeRef);
-  default:                    return false;
+  case TypeCheckKind::tInt:    return typeCheckInt(typeRef);
+  case TypeCheckKind::tFloat:  return typeCheckFloat(typeRef);
+  case TypeCheckKind::tDouble: return typeCheckDouble(typeRef);
+  case TypeCheckKind::tBool:   return typeCheckBool(typeRef);
+  case TypeCheckKind::tEnum:   return typeCheckEnum(typeRef);
+  default:                     return false;
   }
 }
@@ -22,6 +22,7 @@
 enum class TypeCheckKind {
   tInt,		// Int
   tFloat,	// Float
+  tDouble,	// Double
   tBool,	// Bool
   tEnum		// enum type
 };
@@ -49,6 +50,9 @@ extern bool typeCheckBool(CTypeRef *typeRef);
 // Return true if [typeRef] is Float.
 extern bool typeCheckFloat(CTypeRef *typeRef);
 
+// Return true if [typeRef] is Double.
+extern bool typeCheckDouble(CTypeRef *typeRef);
+
 // Return true if [typeRef] is String.
 extern bool typeCheckString(CTypeRef *typeRef);
 
@@ -0,0 +1,246 @@
+//========================================================================
+//
+// AsyncIO.cpp
+//
+// Part of the Haxonite project, under the MIT License.
+// Copyright 2025 Derek Noonburg
+//
+//========================================================================
+
+#include "AsyncIO.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+//------------------------------------------------------------------------
+
+// Number of I/O worker threads. These spend nearly all of their time
+// blocked in the kernel, so this doesn't depend on the number of
+// cores -- it's just the number of requests that can be in flight at
+// once.
+#define asyncIONThreads 4
+
+//------------------------------------------------------------------------
+
+// The shared state is allocated on first use, and never freed: the
+// worker threads are still blocked on the condition variables when
+// the process exits, and destroying a condition variable with
+// waiters blocks.
+struct AsyncIOState {
+  std::mutex mutex;
+  std::condition_variable pendingCV;
+  std::condition_variable doneCV;
+  int64_t nextID;
+
+  // requests waiting for a worker
+  std::deque<std::shared_ptr<AsyncIORequest>> pending;
+
+  // finished requests whose completions haven't been consumed yet
+  std::deque<std::shared_ptr<AsyncIORequest>> completed;
+
+  // wakeup pipe for the completion queue: the workers write a byte
+  // for each completion, and asyncIOTakeCompletion() drains it
+  int wakeupFDs[2];
+};
+
+// this is only set by the engine's thread, in asyncIOSubmit(), so it
+// doesn't need to be locked
+static AsyncIOState *asyncIO = nullptr;
+
+//------------------------------------------------------------------------
+
+static void asyncIOStart();
+static void asyncIOWorkerLoop();
+static void asyncIORun(AsyncIORequest *req);
+static void asyncIOConsume(AsyncIORequest *req);
+
+//------------------------------------------------------------------------
+
+void asyncIOSubmit(const std::shared_ptr<AsyncIORequest> &req) {
+  if (!asyncIO) {
+    asyncIOStart();
+  }
+  std::unique_lock<std::mutex> lock(asyncIO->mutex);
+  req->id = asyncIO->nextID++;
+  req->result = -1;
+  req->started = false;
+  req->done = false;
+  req->queued = false;
+  req->released = false;
+  asyncIO->pending.push_back(req);
+  lock.unlock();
+  asyncIO->pendingCV.notify_one();
+}
+
+// Set up the shared state and the wakeup pipe, and start the worker
+// threads.
+static void asyncIOStart() {
+  AsyncIOState *state = new AsyncIOState();
+  state->nextID = 1;
+  if (pipe(state->wakeupFDs) == 0) {
+    for (int i = 0; i < 2; ++i) {
+      fcntl(state->wakeupFDs[i], F_SETFL, fcntl(state->wakeupFDs[i], F_GETFL) | O_NONBLOCK);
+      fcntl(state->wakeupFDs[i], F_SETFD, FD_CLOEXEC);
+    }
+  } else {
+    state->wakeupFDs[0] = state->wakeupFDs[1] = -1;
+  }
+  asyncIO = state;
+  for (int i = 0; i < asyncIONThreads; ++i) {
+    // the workers are never joined -- they're blocked in
+    // asyncIOWorkerLoop() when the process exits
+    std::thread(&asyncIOWorkerLoop).detach();
+  }
+}
+
+static void asyncIOWorkerLoop() {
+  while (true) {
+    std::unique_lock<std::mutex> lock(asyncIO->mutex);
+    asyncIO->pendingCV.wait(lock, [] { return !asyncIO->pending.empty(); });
+    std::shared_ptr<AsyncIORequest> req = asyncIO->pending.front();
+    asyncIO->pending.pop_front();
+    req->started = true;
+    lock.unlock();
+
+    asyncIORun(req.get());
+
+    lock.lock();
+    req->done = true;
+    if (!req->released) {
+      asyncIO->completed.push_back(req);
+      req->queued = true;
+      if (asyncIO->wakeupFDs[1] >= 0) {
+	// if the pipe is full, it's already readable, so a failed write
+	// doesn't matter
+	char c = 0;
+	ssize_t n = write(asyncIO->wakeupFDs[1], &c, 1);
+	(void)n;
+      }
+    }
+    lock.unlock();
+    asyncIO->doneCV.notify_all();
+  }
+}
+
+// Do the I/O for [req], and close its fd. Reads stop early only at
+// end of file.
+static void asyncIORun(AsyncIORequest *req) {
+  int64_t n = 0;
+  while (n < req->length) {
+    size_t chunk = (size_t)std::min(req->length - n, (int64_t)1 << 30);
+    ssize_t k;
+    if (req->op == asyncIORead) {
+      k = pread(req->fd, req->buf.get() + n, chunk, (off_t)(req->offset + n));
+    } else {
+      k = pwrite(req->fd, req->buf.get() + n, chunk, (off_t)(req->offset + n));
+    }
+    if (k < 0) {
+      if (errno == EINTR) {
+	continue;
+      }
+      n = -1;
+      break;
+    }
+    if (k == 0) {
+      if (req->op == asyncIOWrite) {
+	n = -1;
+      }
+      break;
+    }
+    n += k;
+  }
+  close(req->fd);
+  req->fd = -1;
+  req->result = n;
+}
+
+bool asyncIOIsDone(AsyncIORequest *req) {
+  std::lock_guard<std::mutex> lock(asyncIO->mutex);
+  if (!req->done) {
+    return false;
+  }
+  asyncIOConsume(req);
+  return true;
+}
+
+void asyncIOWait(AsyncIORequest *req) {
+  std::unique_lock<std::mutex> lock(asyncIO->mutex);
+  asyncIO->doneCV.wait(lock, [req] { return req->done; });
+  asyncIOConsume(req);
+}
+
+size_t asyncIOWaitAny(const std::vector<AsyncIORequest*> &reqs) {
+  std::unique_lock<std::mutex> lock(asyncIO->mutex);
+  size_t idx = 0;
+  asyncIO->doneCV.wait(lock, [&reqs, &idx] {
+    for (idx = 0; idx < reqs.size(); ++idx) {
+      if (reqs[idx]->done) {
+	return true;
+      }
+    }
+    return false;
+  });
+  asyncIOConsume(reqs[idx]);
+  return idx;
+}
+
+void asyncIORelease(AsyncIORequest *req) {
+  std::lock_guard<std::mutex> lock(asyncIO->mutex);
+  req->released = true;
+  if (!req->started) {
+    for (auto iter = asyncIO->pending.begin(); iter != asyncIO->pending.end(); ++iter) {
+      if (iter->get() == req) {
+	close(req->fd);
+	req->fd = -1;
+	asyncIO->pending.erase(iter);
+	break;
+      }
+    }
+  }
+  asyncIOConsume(req);
+}
+
+// Remove [req] from the completion queue, if it's there. Called with
+// the mutex held.
+static void asyncIOConsume(AsyncIORequest *req) {
+  if (!req->queued) {
+    return;
+  }
+  for (auto iter = asyncIO->completed.begin(); iter != asyncIO->completed.end(); ++iter) {
+    if (iter->get() == req) {
+      asyncIO->completed.erase(iter);
+      break;
+    }
+  }
+  req->queued = false;
+}
+
+int64_t asyncIOTakeCompletion() {
+  if (!asyncIO) {
+    return -1;
+  }
+  std::lock_guard<std::mutex> lock(asyncIO->mutex);
+  if (asyncIO->wakeupFDs[0] >= 0) {
+    char buf[256];
+    while (read(asyncIO->wakeupFDs[0], buf, sizeof(buf)) > 0) ;
+  }
+  if (asyncIO->completed.empty()) {
+    return -1;
+  }
+  std::shared_ptr<AsyncIORequest> req = asyncIO->completed.front();
+  asyncIO->completed.pop_front();
+  req->queued = false;
+  return req->id;
+}
+
+int asyncIOCompletionFD() {
+  if (!asyncIO) {
+    return -1;
+  }
+  return asyncIO->wakeupFDs[0];
+}
@@ -0,0 +1,87 @@
+//========================================================================
+//
+// AsyncIO.h
+//
+// Asynchronous file I/O for the runtime library.
+//
+// Reads and writes are handed to a small set of I/O worker threads,
+// so the engine's thread can keep running -- or wait on several
+// requests at once, or on GUI events -- while the I/O is in
+// progress. As with the thread pool (ThreadPool.h), the workers
+// never call into the engine: each request owns its fd (a dup of the
+// caller's fd) and its data buffer, and the results are picked up by
+// the engine's thread.
+//
+// Each completed request is also added to a completion queue, in
+// completion order, which the event loop uses to deliver completions
+// as events. A completion is delivered once: taking it from the
+// queue, or waiting on (or polling) the request itself, consumes it.
+//
+// Part of the Haxonite project, under the MIT License.
+// Copyright 2025 Derek Noonburg
+//
+//========================================================================
+
+#ifndef AsyncIO_h
+#define AsyncIO_h
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+enum AsyncIOOp {
+  asyncIORead,
+  asyncIOWrite
+};
+
+struct AsyncIORequest {
+  // set by the caller before asyncIOSubmit()
+  AsyncIOOp op;
+  int fd;                           // owned (and closed) by the request
+  int64_t offset;
+  std::unique_ptr<uint8_t[]> buf;   // data to write, or space for data read
+  int64_t length;
+
+  // set by asyncIOSubmit()
+  int64_t id;
+
+  // set by the worker; valid once asyncIOIsDone() returns true (or
+  // after asyncIOWait())
+  int64_t result;                   // bytes read/written, or -1 on error
+
+  // internal state -- protected by the AsyncIO mutex
+  bool started;
+  bool done;
+  bool queued;
+  bool released;
+};
+
+// Submit [req]. Assigns a unique (positive) id to the request. The
+// worker threads are started on first use.
+extern void asyncIOSubmit(const std::shared_ptr<AsyncIORequest> &req);
+
+// Return true if [req] is finished. A finished request's completion
+// is consumed.
+extern bool asyncIOIsDone(AsyncIORequest *req);
+
+// Wait until [req] is finished, and consume its completion.
+extern void asyncIOWait(AsyncIORequest *req);
+
+// Wait until at least one of [reqs] is finished, and consume its
+// completion. Returns the index of the first finished request.
+extern size_t asyncIOWaitAny(const std::vector<AsyncIORequest*> &reqs);
+
+// Called when the owner of [req] goes away. A request that hasn't
+// started yet is cancelled; otherwise its completion is dropped.
+extern void asyncIORelease(AsyncIORequest *req);
+
+// Remove the next request from the completion queue, and return its
+// id, or -1 if the queue is empty.
+extern int64_t asyncIOTakeCompletion();
+
+// Return an fd that is readable when the completion queue is
+// non-empty (it may also wake up spuriously), or -1 if async I/O has
+// never been used.
+extern int asyncIOCompletionFD();
+
+#endif // AsyncIO_h
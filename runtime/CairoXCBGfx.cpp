@@ -36,6 +36,7 @@
 #include <algorithm>
 #include <deque>
 #include <vector>
+#include "AsyncIO.h"
 #include "NumConversion.h"
 #include "runtime_String.h"
 #include "runtime_Vector.h"
@@ -291,6 +292,7 @@ static xcb_atom_t atom(xcb_connection_t *connection, const char *name, bool crea
 static void enqueueEvents(GfxApplication *gfxApp);
 static void doPoll(GfxApplication *gfxApp, int64_t timeout);
 static Cell processEvent(GfxApplication *gfxApp, BytecodeEngine &engine);
+static Cell takeIOCompleteEvent(BytecodeEngine &engine);
 static Cell makeResizeEvent(Cell &winCell, int64_t w, int64_t h, BytecodeEngine &engine);
 static Cell makeCloseEvent(Cell &winCell, BytecodeEngine &engine);
 static Cell makeMouseButtonPressEvent(Cell &winCell, int64_t x, int64_t y,
@@ -306,6 +308,7 @@ static Cell makeKeyPressEvent(Cell &winCell, int64_t key, int64_t unicode, int64
 			      BytecodeEngine &engine);
 static Cell makeKeyReleaseEvent(Cell &winCell, int64_t key, int64_t unicode, int64_t modifiers,
 				BytecodeEngine &engine);
+static Cell makeIOCompleteEvent(int64_t id, BytecodeEngine &engine);
 static bool initXkb(GfxApplication *gfxApp);
 static bool initXkbKeymap(GfxApplication *gfxApp);
 static void closeXkb(GfxApplication *gfxApp);
@@ -2119,6 +2122,10 @@ Cell gfxWaitEvent(BytecodeEngine &engine) {
 	return eventCell;
       }
     }
+    Cell eventCell = takeIOCompleteEvent(engine);
+    if (!cellIsNilHeapPtr(eventCell)) {
+      return eventCell;
+    }
     doPoll(gfxApp, -1);
   }
 }
@@ -2135,6 +2142,10 @@ Cell gfxWaitEvent(int64_t timeLimit, BytecodeEngine &engine) {
 	return eventCell;
       }
     }
+    Cell eventCell = takeIOCompleteEvent(engine);
+    if (!cellIsNilHeapPtr(eventCell)) {
+      return eventCell;
+    }
     int64_t delta = timeLimit - gfxMonoclock();
     if (delta <= 0) {
       return cellMakeError();
@@ -2154,6 +2165,10 @@ Cell gfxPollEvent(BytecodeEngine &engine) {
       return eventCell;
     }
   }
+  Cell eventCell = takeIOCompleteEvent(engine);
+  if (!cellIsNilHeapPtr(eventCell)) {
+    return eventCell;
+  }
   return cellMakeError();
 }
 
@@ -2164,18 +2179,38 @@ static void enqueueEvents(GfxApplication *gfxApp) {
   }
 }
 
+// Wait for X events or async I/O completions.
 static void doPoll(GfxApplication *gfxApp, int64_t timeout) {
-  struct pollfd fd;
-  fd.fd = xcb_get_file_descriptor(gfxApp->connection);
-  fd.events = POLLIN;
-  fd.revents = 0;
+  struct pollfd fds[2];
+  fds[0].fd = xcb_get_file_descriptor(gfxApp->connection);
+  fds[0].events = POLLIN;
+  fds[0].revents = 0;
+  int nFDs = 1;
+  int ioFD = asyncIOCompletionFD();
+  if (ioFD >= 0) {
+    fds[1].fd = ioFD;
+    fds[1].events = POLLIN;
+    fds[1].revents = 0;
+    nFDs = 2;
+  }
   int t;
   if (timeout < 0) {
     t = -1;
   } else {
     t = std::max(1, (int)std::min((int64_t)INT_MAX, timeout / 1000));
   }
-  poll(&fd, 1, t);
+  poll(fds, nFDs, t);
+}
+
+// Return an IOCompleteEvent for the next async I/O completion, or a
+// nil pointer if there isn't one.
+static Cell takeIOCompleteEvent(BytecodeEngine &engine) {
+  int64_t id = asyncIOTakeCompletion();
+  if (id < 0) {
+    return cellMakeNilHeapPtr();
+  }
+  // NB: this may trigger GC
+  return makeIOCompleteEvent(id, engine);
 }
 
 static Cell processEvent(GfxApplication *gfxApp, BytecodeEngine &engine) {
@@ -2531,6 +2566,15 @@ static Cell makeKeyReleaseEvent(Cell &winCell, int64_t key, int64_t unicode, int
   return cellMakeHeapPtr(event);
 }
 
+static Cell makeIOCompleteEvent(int64_t id, BytecodeEngine &engine) {
+  IOCompleteEvent *event = (IOCompleteEvent *)engine.heapAllocTuple(ioCompleteEventNCells, 0);
+  event->typeID = cellMakeInt(eventIOComplete);
+  // not tied to a window (see Event in gfx.haxh)
+  event->win = cellMakeNilHeapPtr();
+  event->id = cellMakeInt(id);
+  return cellMakeHeapPtr(event);
+}
+
 //------------------------------------------------------------------------
 // xkb
 //------------------------------------------------------------------------
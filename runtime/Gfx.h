@@ -213,6 +213,15 @@ struct KeyReleaseEvent {
 
 #define keyReleaseEventNCells (sizeof(KeyReleaseEvent) / sizeof(Cell) - 1)
 
+struct IOCompleteEvent {
+  uint64_t hdr;
+  Cell typeID;        // Int = eventIOComplete
+  Cell win;           // nil heap pointer
+  Cell id;            // Int
+};
+
+#define ioCompleteEventNCells (sizeof(IOCompleteEvent) / sizeof(Cell) - 1)
+
 // for Event.typeID
 #define eventResize             0
 #define eventClose              1
@@ -222,6 +231,7 @@ struct KeyReleaseEvent {
 #define eventMouseMove          5
 #define eventKeyPress           6
 #define eventKeyRelease         7
+#define eventIOComplete         8
 
 // for ***Event.modifiers
 #define modShift 0x01
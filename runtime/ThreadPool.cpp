@@ -0,0 +1,177 @@
+//========================================================================
+//
+// ThreadPool.cpp
+//
+// Part of the Haxonite project, under the MIT License.
+// Copyright 2025 Derek Noonburg
+//
+//========================================================================
+
+#include "ThreadPool.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "NumConversion.h"
+
+//------------------------------------------------------------------------
+
+#define maxThreads 256
+
+// A fixed set of worker threads that run one parallelFor job at a
+// time. The chunks of a job are handed out through a shared atomic
+// counter, so threads that finish early keep taking chunks until
+// none are left. The engine's thread also works on the chunks, and
+// then waits for the workers to finish.
+class ThreadPool {
+public:
+
+  ThreadPool(int aNWorkers);
+  void run(int64_t n, int64_t chunkSize,
+	   const std::function<void(int64_t first, int64_t last)> &func);
+
+private:
+
+  void workerLoop();
+  int64_t runChunks();
+
+  int nWorkers;
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable jobCV;
+  std::condition_variable doneCV;
+
+  // current job -- these are protected by [mutex], except for
+  // [nextChunk], which is atomic
+  const std::function<void(int64_t first, int64_t last)> *jobFunc;
+  uint64_t jobSeq;
+  int64_t jobN;
+  int64_t jobChunkSize;
+  int64_t nChunks;
+  std::atomic<int64_t> nextChunk;
+  int64_t nChunksDone;
+  int nActive;
+};
+
+ThreadPool::ThreadPool(int aNWorkers) {
+  nWorkers = aNWorkers;
+  jobFunc = nullptr;
+  jobSeq = 0;
+  jobN = 0;
+  jobChunkSize = 1;
+  nChunks = 0;
+  nextChunk = 0;
+  nChunksDone = 0;
+  nActive = 0;
+}
+
+void ThreadPool::run(int64_t n, int64_t chunkSize,
+		     const std::function<void(int64_t first, int64_t last)> &func) {
+  // the worker threads are started on first use, so programs that
+  // never use a parallel kernel don't pay for them
+  if (workers.empty()) {
+    for (int i = 0; i < nWorkers; ++i) {
+      // the workers are never joined -- they're blocked in
+      // workerLoop() when the process exits
+      workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+      workers.back().detach();
+    }
+  }
+
+  std::unique_lock<std::mutex> lock(mutex);
+  jobFunc = &func;
+  jobN = n;
+  jobChunkSize = chunkSize;
+  nChunks = (n + chunkSize - 1) / chunkSize;
+  nextChunk = 0;
+  nChunksDone = 0;
+  ++jobSeq;
+  lock.unlock();
+  jobCV.notify_all();
+
+  int64_t nDone = runChunks();
+
+  lock.lock();
+  nChunksDone += nDone;
+  doneCV.wait(lock, [this] { return nChunksDone == nChunks && nActive == 0; });
+  jobFunc = nullptr;
+}
+
+void ThreadPool::workerLoop() {
+  uint64_t lastSeq = 0;
+  while (true) {
+    std::unique_lock<std::mutex> lock(mutex);
+    jobCV.wait(lock, [this, lastSeq] { return jobFunc && jobSeq != lastSeq; });
+    lastSeq = jobSeq;
+    ++nActive;
+    lock.unlock();
+
+    int64_t nDone = runChunks();
+
+    lock.lock();
+    nChunksDone += nDone;
+    --nActive;
+    lock.unlock();
+    doneCV.notify_all();
+  }
+}
+
+// Run chunks of the current job until there are none left. Returns
+// the number of chunks run.
+int64_t ThreadPool::runChunks() {
+  int64_t nDone = 0;
+  int64_t chunk;
+  while ((chunk = nextChunk.fetch_add(1)) < nChunks) {
+    int64_t first = chunk * jobChunkSize;
+    int64_t last = std::min(first + jobChunkSize, jobN);
+    (*jobFunc)(first, last);
+    ++nDone;
+  }
+  return nDone;
+}
+
+//------------------------------------------------------------------------
+
+static int nThreads = 1;
+static ThreadPool *threadPool = nullptr;
+
+void threadPoolInit(BytecodeEngine &engine) {
+  nThreads = (int)std::thread::hardware_concurrency();
+  ConfigFile::Item *cfgItem;
+  if ((cfgItem = engine.configItem("runtime", "threads")) &&
+      cfgItem->args.size() == 1) {
+    int64_t n;
+    if (stringToInt56Checked(cfgItem->args[0], 10, n) && n >= 1) {
+      nThreads = (int)std::min(n, (int64_t)maxThreads);
+    }
+  }
+  if (nThreads < 1) {
+    nThreads = 1;
+  } else if (nThreads > maxThreads) {
+    nThreads = maxThreads;
+  }
+  if (nThreads > 1) {
+    threadPool = new ThreadPool(nThreads - 1);
+  }
+}
+
+int threadPoolNThreads() {
+  return nThreads;
+}
+
+void parallelFor(int64_t n, int64_t chunkSize,
+		 const std::function<void(int64_t first, int64_t last)> &func) {
+  if (n <= 0) {
+    return;
+  }
+  if (chunkSize < 1) {
+    chunkSize = 1;
+  }
+  if (!threadPool || n <= chunkSize) {
+    for (int64_t first = 0; first < n; first += chunkSize) {
+      func(first, std::min(first + chunkSize, n));
+    }
+    return;
+  }
+  threadPool->run(n, chunkSize, func);
+}
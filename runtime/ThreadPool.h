@@ -0,0 +1,99 @@
+//========================================================================
+//
+// ThreadPool.h
+//
+// Thread pool for parallel kernels in the runtime library.
+//
+// The bytecode engine is single-threaded, so code running in the
+// pool must never call into the engine: no bytecode callbacks, no
+// heap allocation, and no fatal errors. Kernels only read/write raw
+// data that is already allocated (and which can't move, because GC
+// can't happen while the kernel is running).
+//
+// The number of threads is set with the 'threads' item in the
+// 'runtime' section of the config file, e.g.:
+//
+//     -runtime
+//     threads 16
+//
+// The default is the number of hardware threads. A value of 1
+// disables the thread pool, and everything runs in the engine's
+// thread.
+//
+// Part of the Haxonite project, under the MIT License.
+// Copyright 2025 Derek Noonburg
+//
+//========================================================================
+
+#ifndef ThreadPool_h
+#define ThreadPool_h
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include "BytecodeEngine.h"
+
+// Minimum number of elements for parallelSort to use the thread
+// pool. Smaller arrays are sorted in the engine's thread.
+#define parallelSortMinLength 65536
+
+// Read the config file and set up the thread pool. The worker
+// threads are started on first use.
+extern void threadPoolInit(BytecodeEngine &engine);
+
+// Return the number of threads available for parallel kernels,
+// including the engine's thread.
+extern int threadPoolNThreads();
+
+// Split [0, n) into chunks of [chunkSize] elements (the last chunk
+// may be shorter), and call [func](first, last) on each chunk, in
+// parallel. The chunking depends only on [n] and [chunkSize], not on
+// the number of threads, so kernels that combine per-chunk results
+// in chunk order are deterministic. Returns after all chunks are
+// finished.
+extern void parallelFor(int64_t n, int64_t chunkSize,
+			const std::function<void(int64_t first, int64_t last)> &func);
+
+// Sort [elems][0 .. n-1] using [cmp], in parallel if [n] is large
+// enough. This is a chunked merge sort: each chunk is sorted with
+// std::sort, and then pairs of runs are merged in parallel. The sort
+// is not stable.
+template<class T, class Cmp>
+void parallelSort(T *elems, int64_t n, Cmp cmp) {
+  int nThreads = threadPoolNThreads();
+  if (n < parallelSortMinLength || nThreads <= 1) {
+    std::sort(elems, elems + n, cmp);
+    return;
+  }
+
+  // use a power-of-2 number of runs, so merging is balanced
+  int64_t nRuns = 1;
+  while (nRuns < nThreads) {
+    nRuns *= 2;
+  }
+  int64_t runLength = (n + nRuns - 1) / nRuns;
+  parallelFor(n, runLength, [elems, cmp](int64_t first, int64_t last) {
+    std::sort(elems + first, elems + last, cmp);
+  });
+
+  std::vector<T> tmp(n);
+  T *src = elems;
+  T *dest = tmp.data();
+  for (int64_t width = runLength; width < n; width *= 2) {
+    int64_t nPairs = (n + 2 * width - 1) / (2 * width);
+    parallelFor(nPairs, 1, [src, dest, n, width, cmp](int64_t first, int64_t last) {
+      for (int64_t pair = first; pair < last; ++pair) {
+	int64_t start = pair * 2 * width;
+	int64_t mid = std::min(start + width, n);
+	int64_t end = std::min(start + 2 * width, n);
+	std::merge(src + start, src + mid, src + mid, src + end, dest + start, cmp);
+      }
+    });
+    std::swap(src, dest);
+  }
+  if (src != elems) {
+    std::copy(src, src + n, elems);
+  }
+}
+
+#endif // ThreadPool_h
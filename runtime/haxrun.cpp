@@ -16,13 +16,17 @@
 #include <vector>
 #include "BytecodeEngine.h"
 #include "SysIO.h"
+#include "ThreadPool.h"
 #include "runtime_alloc.h"
+#include "runtime_datafile.h"
 #include "runtime_datetime.h"
+#include "runtime_drawlist.h"
 #include "runtime_File.h"
 #include "runtime_format.h"
 #include "runtime_gfx.h"
 #include "runtime_Map.h"
 #include "runtime_math.h"
+#include "runtime_process.h"
 #include "runtime_random.h"
 #include "runtime_regex.h"
 #include "runtime_serdeser.h"
@@ -100,13 +104,18 @@ int main(int argc, char *argv[]) {
 }
 
 static void setupNativeFuncs(BytecodeEngine &engine) {
+  // the thread pool is shared by several runtime modules
+  threadPoolInit(engine);
   runtime_alloc_init(engine);
+  runtime_datafile_init(engine);
   runtime_datetime_init(engine);
+  runtime_drawlist_init(engine);
   runtime_File_init(engine);
   runtime_format_init(engine);
   runtime_gfx_init(engine);
   runtime_Map_init(engine);
   runtime_math_init(engine);
+  runtime_process_init(engine);
   runtime_random_init(engine);
   runtime_regex_init(engine);
   runtime_serdeser_init(engine);
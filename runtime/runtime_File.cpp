@@ -8,11 +8,21 @@
 //========================================================================
 
 #include "runtime_File.h"
+#include <errno.h>
+#include <fcntl.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <vector>
+#include "AsyncIO.h"
+#include "SysIO.h"
 #include "runtime_String.h"
 #include "runtime_StringBuf.h"
+#include "runtime_Vector.h"
 
 //------------------------------------------------------------------------
 
@@ -20,13 +30,52 @@
 #define fileModeWrite  1
 #define fileModeAppend 2
 
+// Initial size of a read buffer. Buffers grow (by doubling) to fit
+// the longest line read so far.
+#define fileReadBufSize 65536
+
+// Default size of the stdout buffer.
+#define stdoutBufSize 65536
+
 //------------------------------------------------------------------------
 
+// Read buffer for a file (or stdin). All reads go through this buffer
+// (with read(2) on the underlying fd, bypassing the stdio buffer), so
+// readLine can use memchr to find the end of a line, and construct
+// the String at its final size with a single copy. Bytes pos .. end-1
+// of the buffer have been read from the file but not yet returned.
+struct FileReadBuf {
+  std::unique_ptr<uint8_t[]> buf;
+  size_t size;
+  size_t pos;
+  size_t end;
+};
+
 struct FileResource {
   ResourceObject resObj;
   FILE *f;
+  FileReadBuf readBuf;
+};
+
+static FileReadBuf stdinReadBuf;
+
+// Output buffer for stdout or stderr. write/ewrite/writeAll copy into
+// the buffer, and it's written to the fd with write(2) when it fills
+// up, at a newline (in line mode), on flush(), before reading stdin
+// or starting a child process, and at exit. This avoids a stdio call
+// (which takes the stream lock) and a system call for every write. A
+// size of zero means unbuffered.
+struct StdOutputBuf {
+  int fd;
+  std::unique_ptr<uint8_t[]> buf;
+  size_t size;
+  size_t len;
+  bool lineMode;
 };
 
+static StdOutputBuf stdoutBuf;
+static StdOutputBuf stderrBuf;
+
 struct File {
   uint64_t hdr;
   Cell fileResource;    // resource pointer -> FileResource
@@ -42,11 +91,72 @@ struct TempFile {
 
 #define tempFileNCells (sizeof(TempFile) / sizeof(Cell) - 1)
 
+// A mapped file is laid out in memory as a flat string, so its
+// contents can be passed around as a String (a slice of the mapped
+// flat string) with no copying:
+//
+// +-------------//---------+------+------------//------------+
+// | unused                 | hdr  | file contents             |
+// +-------------//---------+------+------------//------------+
+// base                            base + pageSize
+// <------ header page ------>
+//
+// The header page is anonymous memory; the file itself is mapped
+// read-only at base + pageSize. The contents slice (and every slice
+// of it) has the MappedFileResource as its owner, so the GC keeps
+// the mapping alive as long as any of those Strings is reachable --
+// they can outlive the MappedFile. The mapping is released (with
+// munmap) when the resource is finalized. Closing a MappedFile just
+// drops its reference to the contents.
+struct MappedFileResource {
+  ResourceObject resObj;
+  uint8_t *base;
+  size_t pageSize;
+  size_t fileMapSize;
+};
+
+struct MappedFile {
+  uint64_t hdr;
+  Cell contents;              // heap pointer -> String, or nil if closed
+};
+
+#define mappedFileNCells (sizeof(MappedFile) / sizeof(Cell) - 1)
+
+// A Future is an async read or write (see AsyncIO.h). The request is
+// shared with the I/O worker, so finalizing a Future while its I/O
+// is in progress is safe.
+struct FutureResource {
+  ResourceObject resObj;
+  std::shared_ptr<AsyncIORequest> req;
+};
+
+struct Future {
+  uint64_t hdr;
+  Cell futureResource;        // resource pointer -> FutureResource
+};
+
+#define futureNCells (sizeof(Future) / sizeof(Cell) - 1)
+
 //------------------------------------------------------------------------
 
 static Cell makeFileObject(FILE *f, BytecodeEngine &engine);
 static void finalizeFile(ResourceObject *resObj);
 static void closeFile(FileResource *fileResource);
+static int64_t readBufRead(FILE *f, FileReadBuf &rb, uint8_t *out, int64_t n);
+static int64_t readBufFindLine(FILE *f, FileReadBuf &rb);
+static void readLine(FILE *f, FileReadBuf &rb, BytecodeEngine &engine);
+static void readLines(FILE *f, FileReadBuf &rb, int64_t maxLines, BytecodeEngine &engine);
+static void finalizeMappedFile(ResourceObject *resObj);
+static void unmapFile(MappedFileResource *mappedFileResource);
+static void submitAsync(FileResource *fileResource, std::shared_ptr<AsyncIORequest> &req,
+			BytecodeEngine &engine);
+static void finalizeFuture(ResourceObject *resObj);
+static AsyncIORequest *futureRequest(Cell &futCell, BytecodeEngine &engine);
+static void stdOutputInit(StdOutputBuf &ob, int fd, size_t size, bool lineMode);
+static bool stdOutputWrite(StdOutputBuf &ob, const uint8_t *s, size_t n);
+static int64_t stdOutputWriteAll(StdOutputBuf &ob, Cell &vCell);
+static bool stdOutputFlush(StdOutputBuf &ob);
+static void flushStdOutputAtExit();
 
 //------------------------------------------------------------------------
 
@@ -202,18 +312,20 @@ static NativeFuncDefn(runtime_read_4FileTI) {
   engine.failOnNilPtr(file);
   FileResource *fileResource = (FileResource *)cellResourcePtr(file->fileResource);
 
-  size_t n = (size_t)cellInt(nCell);
+  int64_t n = cellInt(nCell);
+  if (n < 0) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
   std::unique_ptr<uint8_t[]> buf = std::unique_ptr<uint8_t[]>(new uint8_t[n]);
-  clearerr(fileResource->f);
-  size_t nBytesRead = fread(buf.get(), 1, n, fileResource->f);
-  if (nBytesRead < n && ferror(fileResource->f)) {
+  int64_t nBytesRead = readBufRead(fileResource->f, fileResource->readBuf, buf.get(), n);
+  if (nBytesRead < 0) {
     engine.push(cellMakeError());
   } else {
     if (nBytesRead > 0) {
       // NB: this may trigger GC
-      stringBufAppend(sbCell, buf.get(), (int64_t)nBytesRead, engine);
+      stringBufAppend(sbCell, buf.get(), nBytesRead, engine);
     }
-    engine.push(cellMakeInt((int64_t)nBytesRead));
+    engine.push(cellMakeInt(nBytesRead));
   }
 }
 
@@ -231,17 +343,28 @@ static NativeFuncDefn(runtime_readLine_4File) {
   engine.failOnNilPtr(file);
   FileResource *fileResource = (FileResource *)cellResourcePtr(file->fileResource);
 
-  std::string s;
-  int c;
-  do {
-    c = fgetc(fileResource->f);
-    if (c < 0) {
-      break;
-    }
-    s.push_back((char)c);
-  } while (c != '\n');
   // NB: this may trigger GC
-  engine.push(stringMake((uint8_t *)s.c_str(), (int64_t)s.size(), engine));
+  readLine(fileResource->f, fileResource->readBuf, engine);
+}
+
+// readLines(f: File, maxLines: Int) -> Result[Vector[String]]
+static NativeFuncDefn(runtime_readLines_4FileI) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsInt(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &fCell = engine.arg(0);
+  Cell &maxLinesCell = engine.arg(1);
+
+  File *file = (File *)cellHeapPtr(fCell);
+  engine.failOnNilPtr(file);
+  FileResource *fileResource = (FileResource *)cellResourcePtr(file->fileResource);
+
+  // NB: this may trigger GC
+  readLines(fileResource->f, fileResource->readBuf, cellInt(maxLinesCell), engine);
 }
 
 // write(f: File, s: String) -> Result[Int]
@@ -296,6 +419,46 @@ static NativeFuncDefn(runtime_write_4FileT) {
   }
 }
 
+// writeAll(f: File, v: Vector[String]) -> Result[Int]
+// Writes all of the strings in [v] to [f], with a single writev call
+// (or as few as possible). Returns the total number of bytes written.
+static NativeFuncDefn(runtime_writeAll_4FileVS) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsHeapPtr(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &fCell = engine.arg(0);
+  Cell &vCell = engine.arg(1);
+
+  File *file = (File *)cellHeapPtr(fCell);
+  engine.failOnNilPtr(file);
+  FileResource *fileResource = (FileResource *)cellResourcePtr(file->fileResource);
+
+  // nothing here can trigger GC, so the string data pointers stay
+  // valid until the write is done
+  int64_t n = vectorLength(vCell);
+  std::vector<struct iovec> iov(n);
+  int64_t total = 0;
+  for (int64_t i = 0; i < n; ++i) {
+    Cell sCell = vectorGet(vCell, i);
+    iov[i].iov_base = stringData(sCell);
+    iov[i].iov_len = (size_t)stringByteLength(sCell);
+    total += (int64_t)iov[i].iov_len;
+  }
+
+  // flush anything written earlier through stdio, to keep the output
+  // in order
+  if (fflush(fileResource->f) != 0 ||
+      !writevFD(fileno(fileResource->f), iov.data(), (int)n)) {
+    engine.push(cellMakeError());
+    return;
+  }
+  engine.push(cellMakeInt(total));
+}
+
 // read(sb: StringBuf, n: Int) -> Result[Int]
 static NativeFuncDefn(runtime_read_TI) {
 #if CHECK_RUNTIME_FUNC_ARGS
@@ -308,18 +471,20 @@ static NativeFuncDefn(runtime_read_TI) {
   Cell &sbCell = engine.arg(0);
   Cell &nCell = engine.arg(1);
 
-  size_t n = (size_t)cellInt(nCell);
+  int64_t n = cellInt(nCell);
+  if (n < 0) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
   std::unique_ptr<uint8_t[]> buf = std::unique_ptr<uint8_t[]>(new uint8_t[n]);
-  clearerr(stdin);
-  size_t nBytesRead = fread((char *)buf.get(), 1, n, stdin);
-  if (nBytesRead < n && ferror(stdin)) {
+  int64_t nBytesRead = readBufRead(stdin, stdinReadBuf, buf.get(), n);
+  if (nBytesRead < 0) {
     engine.push(cellMakeError());
   } else {
     if (nBytesRead > 0) {
       // NB: this may trigger GC
       stringBufAppend(sbCell, buf.get(), nBytesRead, engine);
     }
-    engine.push(cellMakeInt((int64_t)nBytesRead));
+    engine.push(cellMakeInt(nBytesRead));
   }
 }
 
@@ -331,17 +496,22 @@ static NativeFuncDefn(runtime_readLine) {
   }
 #endif
 
-  std::string s;
-  int c;
-  do {
-    c = fgetc(stdin);
-    if (c < 0) {
-      break;
-    }
-    s.push_back((char)c);
-  } while (c != '\n');
   // NB: this may trigger GC
-  engine.push(stringMake((uint8_t *)s.c_str(), (int64_t)s.size(), engine));
+  readLine(stdin, stdinReadBuf, engine);
+}
+
+// readLines(maxLines: Int) -> Result[Vector[String]]
+static NativeFuncDefn(runtime_readLines_I) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsInt(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &maxLinesCell = engine.arg(0);
+
+  // NB: this may trigger GC
+  readLines(stdin, stdinReadBuf, cellInt(maxLinesCell), engine);
 }
 
 // write(s: String) -> Result[Int]
@@ -354,11 +524,9 @@ static NativeFuncDefn(runtime_write_S) {
 #endif
   Cell &sCell = engine.arg(0);
 
-  uint8_t *s = stringData(sCell);
   int64_t n = stringByteLength(sCell);
-  size_t nBytesWritten = fwrite(s, 1, n, stdout);
-  if (nBytesWritten == (size_t)n) {
-    engine.push(cellMakeInt((int64_t)nBytesWritten));
+  if (stdOutputWrite(stdoutBuf, stringData(sCell), (size_t)n)) {
+    engine.push(cellMakeInt(n));
   } else {
     engine.push(cellMakeError());
   }
@@ -374,26 +542,729 @@ static NativeFuncDefn(runtime_ewrite_S) {
 #endif
   Cell &sCell = engine.arg(0);
 
-  uint8_t *s = stringData(sCell);
   int64_t n = stringByteLength(sCell);
-  size_t nBytesWritten = fwrite(s, 1, n, stderr);
-  if (nBytesWritten == (size_t)n) {
-    engine.push(cellMakeInt((int64_t)nBytesWritten));
+  if (stdOutputWrite(stderrBuf, stringData(sCell), (size_t)n)) {
+    engine.push(cellMakeInt(n));
+  } else {
+    engine.push(cellMakeError());
+  }
+}
+
+// writeAll(v: Vector[String]) -> Result[Int]
+// Writes all of the strings in [v] to stdout. Returns the total
+// number of bytes written.
+static NativeFuncDefn(runtime_writeAll_VS) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsHeapPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &vCell = engine.arg(0);
+
+  int64_t total = stdOutputWriteAll(stdoutBuf, vCell);
+  if (total >= 0) {
+    engine.push(cellMakeInt(total));
   } else {
     engine.push(cellMakeError());
   }
 }
 
+// flush() -> Result[]
+// Writes any buffered stdout data.
+static NativeFuncDefn(runtime_flush) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 0) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+
+  if (stdOutputFlush(stdoutBuf)) {
+    engine.push(cellMakeInt(0));
+  } else {
+    engine.push(cellMakeError());
+  }
+}
+
+// setOutputBuffering(size: Int, lineMode: Bool)
+// Flushes stdout, and then sets the size of its buffer (0 means
+// unbuffered), and whether it's flushed at each newline.
+static NativeFuncDefn(runtime_setOutputBuffering_IB) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsInt(engine.arg(0)) ||
+      !cellIsBool(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &sizeCell = engine.arg(0);
+  Cell &lineModeCell = engine.arg(1);
+
+  int64_t size = cellInt(sizeCell);
+  if (size < 0) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+  stdOutputFlush(stdoutBuf);
+  stdOutputInit(stdoutBuf, stdoutBuf.fd, (size_t)size, cellBool(lineModeCell));
+
+  engine.push(cellMakeInt(0));
+}
+
+// mapFile(path: String) -> Result[MappedFile]
+static NativeFuncDefn(runtime_mapFile_S) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &pathCell = engine.arg(0);
+
+  std::string path = stringToStdString(pathCell);
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    engine.push(cellMakeError());
+    return;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size > bytecodeMaxInt) {
+    close(fd);
+    engine.push(cellMakeError());
+    return;
+  }
+  size_t fileSize = (size_t)st.st_size;
+  size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+  size_t fileMapSize = (fileSize + pageSize - 1) / pageSize * pageSize;
+
+  // reserve the whole range with an anonymous mapping, then map the
+  // file over everything after the header page
+  uint8_t *base = (uint8_t *)mmap(nullptr, pageSize + fileMapSize, PROT_READ | PROT_WRITE,
+				  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (base == MAP_FAILED) {
+    close(fd);
+    engine.push(cellMakeError());
+    return;
+  }
+  if (fileSize > 0 &&
+      mmap(base + pageSize, fileSize, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+    munmap(base, pageSize + fileMapSize);
+    close(fd);
+    engine.push(cellMakeError());
+    return;
+  }
+  close(fd);
+  uint8_t *hdr = base + pageSize - 8;
+  *(uint64_t *)hdr = ((uint64_t)fileSize << 8) | gcTagBlob;
+  mprotect(base, pageSize, PROT_READ);
+
+  MappedFileResource *mappedFileResource;
+  try {
+    mappedFileResource = new MappedFileResource();
+  } catch (std::bad_alloc) {
+    BytecodeEngine::fatalError("Out of memory");
+  }
+  mappedFileResource->resObj.finalizer = &finalizeMappedFile;
+  mappedFileResource->base = base;
+  mappedFileResource->pageSize = pageSize;
+  mappedFileResource->fileMapSize = fileMapSize;
+
+  // the resource is registered after the allocations, so a GC here
+  // can't finalize it
+  // NB: this may trigger GC
+  Cell contentsCell = stringMakeOwnedSlice(hdr, &mappedFileResource->resObj, engine);
+  engine.pushGCRoot(contentsCell);
+  // NB: this may trigger GC
+  MappedFile *mappedFile = (MappedFile *)engine.heapAllocTuple(mappedFileNCells, 0);
+  engine.popGCRoot(contentsCell);
+  mappedFile->contents = contentsCell;
+  engine.addResourceObject(&mappedFileResource->resObj);
+  engine.push(cellMakeHeapPtr(mappedFile));
+}
+
+// contents(mf: MappedFile) -> String
+static NativeFuncDefn(runtime_contents_10MappedFile) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &mfCell = engine.arg(0);
+
+  MappedFile *mappedFile = (MappedFile *)cellHeapPtr(mfCell);
+  engine.failOnNilPtr(mappedFile);
+  if (cellIsNilPtr(mappedFile->contents)) {
+    // NB: this may trigger GC
+    engine.push(stringAlloc(0, engine));
+    return;
+  }
+  engine.push(mappedFile->contents);
+}
+
+// close(mf: MappedFile)
+// Strings from contents() stay valid after closing -- the file is
+// unmapped once they're all unreachable.
+static NativeFuncDefn(runtime_close_10MappedFile) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &mfCell = engine.arg(0);
+
+  MappedFile *mappedFile = (MappedFile *)cellHeapPtr(mfCell);
+  engine.failOnNilPtr(mappedFile);
+  mappedFile->contents = cellMakeNilHeapPtr();
+
+  engine.push(cellMakeInt(0));
+}
+
+static void finalizeMappedFile(ResourceObject *resObj) {
+  MappedFileResource *mappedFileResource = (MappedFileResource *)resObj;
+  unmapFile(mappedFileResource);
+}
+
+// Release a mapped file (see MappedFile).
+static void unmapFile(MappedFileResource *mappedFileResource) {
+  munmap(mappedFileResource->base,
+	 mappedFileResource->pageSize + mappedFileResource->fileMapSize);
+  delete mappedFileResource;
+}
+
+//------------------------------------------------------------------------
+
+// readAsync(f: File, offset: Int, n: Int) -> Result[Future]
+// Starts reading up to [n] bytes at [offset] in [f]. Async reads
+// bypass the File's read buffer, and don't change its position.
+static NativeFuncDefn(runtime_readAsync_4FileII) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 3 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsInt(engine.arg(1)) ||
+      !cellIsInt(engine.arg(2))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &fCell = engine.arg(0);
+  Cell &offsetCell = engine.arg(1);
+  Cell &nCell = engine.arg(2);
+
+  File *file = (File *)cellHeapPtr(fCell);
+  engine.failOnNilPtr(file);
+  FileResource *fileResource = (FileResource *)cellResourcePtr(file->fileResource);
+
+  int64_t offset = cellInt(offsetCell);
+  int64_t n = cellInt(nCell);
+  if (offset < 0 || n < 0) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+  std::shared_ptr<AsyncIORequest> req;
+  try {
+    req = std::make_shared<AsyncIORequest>();
+    req->buf = std::unique_ptr<uint8_t[]>(new uint8_t[n]);
+  } catch (std::bad_alloc) {
+    BytecodeEngine::fatalError("Out of memory");
+  }
+  req->op = asyncIORead;
+  req->offset = offset;
+  req->length = n;
+
+  // NB: this may trigger GC
+  submitAsync(fileResource, req, engine);
+}
+
+// writeAsync(f: File, offset: Int, s: String) -> Result[Future]
+// Starts writing [s] at [offset] in [f]. The data is copied, so [s]
+// can be reused immediately.
+static NativeFuncDefn(runtime_writeAsync_4FileIS) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 3 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsInt(engine.arg(1)) ||
+      !cellIsPtr(engine.arg(2))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &fCell = engine.arg(0);
+  Cell &offsetCell = engine.arg(1);
+  Cell &sCell = engine.arg(2);
+
+  File *file = (File *)cellHeapPtr(fCell);
+  engine.failOnNilPtr(file);
+  FileResource *fileResource = (FileResource *)cellResourcePtr(file->fileResource);
+
+  int64_t offset = cellInt(offsetCell);
+  if (offset < 0) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+  int64_t n = stringByteLength(sCell);
+  std::shared_ptr<AsyncIORequest> req;
+  try {
+    req = std::make_shared<AsyncIORequest>();
+    req->buf = std::unique_ptr<uint8_t[]>(new uint8_t[n]);
+  } catch (std::bad_alloc) {
+    BytecodeEngine::fatalError("Out of memory");
+  }
+  memcpy(req->buf.get(), stringData(sCell), n);
+  req->op = asyncIOWrite;
+  req->offset = offset;
+  req->length = n;
+
+  // flush anything written earlier through stdio, so it lands before
+  // the async write
+  if (fflush(fileResource->f) != 0) {
+    engine.push(cellMakeError());
+    return;
+  }
+
+  // NB: this may trigger GC
+  submitAsync(fileResource, req, engine);
+}
+
+// Give [req] its own copy of the fd underlying [fileResource] (so
+// closing the File doesn't affect the I/O), submit it, and push a
+// Future (or an error) onto the stack.
+static void submitAsync(FileResource *fileResource, std::shared_ptr<AsyncIORequest> &req,
+			BytecodeEngine &engine) {
+  req->fd = fcntl(fileno(fileResource->f), F_DUPFD_CLOEXEC, 0);
+  if (req->fd < 0) {
+    engine.push(cellMakeError());
+    return;
+  }
+
+  FutureResource *futureResource;
+  try {
+    futureResource = new FutureResource();
+  } catch (std::bad_alloc) {
+    BytecodeEngine::fatalError("Out of memory");
+  }
+  futureResource->resObj.finalizer = &finalizeFuture;
+  futureResource->req = req;
+
+  // NB: this may trigger GC
+  Future *future = (Future *)engine.heapAllocTuple(futureNCells, 0);
+  future->futureResource = cellMakeResourcePtr(futureResource);
+  engine.addResourceObject(&futureResource->resObj);
+  asyncIOSubmit(req);
+  engine.push(cellMakeHeapPtr(future));
+}
+
+static void finalizeFuture(ResourceObject *resObj) {
+  FutureResource *futureResource = (FutureResource *)resObj;
+  asyncIORelease(futureResource->req.get());
+  delete futureResource;
+}
+
+static AsyncIORequest *futureRequest(Cell &futCell, BytecodeEngine &engine) {
+  Future *future = (Future *)cellHeapPtr(futCell);
+  engine.failOnNilPtr(future);
+  FutureResource *futureResource = (FutureResource *)cellResourcePtr(future->futureResource);
+  return futureResource->req.get();
+}
+
+// futureID(fut: Future) -> Int
+// Returns the id used in the IOCompleteEvent for [fut].
+static NativeFuncDefn(runtime_futureID_6Future) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &futCell = engine.arg(0);
+
+  AsyncIORequest *req = futureRequest(futCell, engine);
+  engine.push(cellMakeInt(req->id));
+}
+
+// isDone(fut: Future) -> Bool
+static NativeFuncDefn(runtime_isDone_6Future) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &futCell = engine.arg(0);
+
+  AsyncIORequest *req = futureRequest(futCell, engine);
+  engine.push(cellMakeBool(asyncIOIsDone(req)));
+}
+
+// wait(fut: Future) -> Result[Int]
+// Waits for [fut] to finish, and returns the number of bytes read or
+// written.
+static NativeFuncDefn(runtime_wait_6Future) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &futCell = engine.arg(0);
+
+  AsyncIORequest *req = futureRequest(futCell, engine);
+  asyncIOWait(req);
+  if (req->result < 0) {
+    engine.push(cellMakeError());
+  } else {
+    engine.push(cellMakeInt(req->result));
+  }
+}
+
+// contents(fut: Future) -> String
+// Waits for [fut] to finish, and returns the data read. Returns an
+// empty string for a write or a failed read.
+static NativeFuncDefn(runtime_contents_6Future) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &futCell = engine.arg(0);
+
+  AsyncIORequest *req = futureRequest(futCell, engine);
+  asyncIOWait(req);
+  int64_t n = (req->op == asyncIORead && req->result > 0) ? req->result : 0;
+
+  // NB: this may trigger GC
+  Cell sCell = stringAlloc(n, engine);
+  if (n > 0) {
+    memcpy(stringData(sCell), req->buf.get(), n);
+  }
+  engine.push(sCell);
+}
+
+// waitAny(futs: Vector[Future]) -> Int
+// Waits for at least one of [futs] to finish, and returns the index
+// of the first finished one.
+static NativeFuncDefn(runtime_waitAny_V6Future) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsHeapPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &vCell = engine.arg(0);
+
+  int64_t n = vectorLength(vCell);
+  if (n == 0) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+  std::vector<AsyncIORequest*> reqs(n);
+  for (int64_t i = 0; i < n; ++i) {
+    Cell futCell = vectorGet(vCell, i);
+    reqs[i] = futureRequest(futCell, engine);
+  }
+  size_t idx = asyncIOWaitAny(reqs);
+  engine.push(cellMakeInt((int64_t)idx));
+}
+
+//------------------------------------------------------------------------
+
+static void stdOutputInit(StdOutputBuf &ob, int fd, size_t size, bool lineMode) {
+  ob.fd = fd;
+  if (size > 0) {
+    try {
+      ob.buf.reset(new uint8_t[size]);
+    } catch (std::bad_alloc) {
+      BytecodeEngine::fatalError("Out of memory");
+    }
+  } else {
+    ob.buf.reset();
+  }
+  ob.size = size;
+  ob.len = 0;
+  ob.lineMode = lineMode;
+}
+
+// Write [n] bytes at [s] to [ob]. Data that doesn't fit in the
+// buffer is written directly. Returns true on success, false on
+// error.
+static bool stdOutputWrite(StdOutputBuf &ob, const uint8_t *s, size_t n) {
+  if (n > ob.size - ob.len) {
+    if (!stdOutputFlush(ob)) {
+      return false;
+    }
+    if (n >= ob.size) {
+      return writeFD(ob.fd, s, n);
+    }
+  }
+  if (n > 0) {
+    memcpy(ob.buf.get() + ob.len, s, n);
+    ob.len += n;
+    if (ob.lineMode && memchr(s, '\n', n)) {
+      return stdOutputFlush(ob);
+    }
+  }
+  return true;
+}
+
+// Write all of the strings in the Vector[String] in [vCell] to [ob].
+// If they don't fit in the buffer, the buffered data and the strings
+// are written together with writev. Returns the total length of the
+// strings, or -1 on error.
+static int64_t stdOutputWriteAll(StdOutputBuf &ob, Cell &vCell) {
+  int64_t n = vectorLength(vCell);
+  int64_t total = 0;
+  for (int64_t i = 0; i < n; ++i) {
+    Cell sCell = vectorGet(vCell, i);
+    total += stringByteLength(sCell);
+  }
+
+  if ((size_t)total > ob.size - ob.len) {
+    // nothing here can trigger GC, so the string data pointers stay
+    // valid until the write is done
+    std::vector<struct iovec> iov;
+    iov.reserve(n + 1);
+    if (ob.len > 0) {
+      iov.push_back({ob.buf.get(), ob.len});
+    }
+    for (int64_t i = 0; i < n; ++i) {
+      Cell sCell = vectorGet(vCell, i);
+      iov.push_back({stringData(sCell), (size_t)stringByteLength(sCell)});
+    }
+    ob.len = 0;
+    if (!writevFD(ob.fd, iov.data(), (int)iov.size())) {
+      return -1;
+    }
+    return total;
+  }
+
+  bool newline = false;
+  for (int64_t i = 0; i < n; ++i) {
+    Cell sCell = vectorGet(vCell, i);
+    uint8_t *s = stringData(sCell);
+    size_t sLen = (size_t)stringByteLength(sCell);
+    if (sLen > 0) {
+      memcpy(ob.buf.get() + ob.len, s, sLen);
+      ob.len += sLen;
+      newline = newline || (ob.lineMode && memchr(s, '\n', sLen));
+    }
+  }
+  if (newline && !stdOutputFlush(ob)) {
+    return -1;
+  }
+  return total;
+}
+
+// Write any buffered data in [ob]. The buffered data is dropped even
+// if the write fails. Returns true on success, false on error.
+static bool stdOutputFlush(StdOutputBuf &ob) {
+  if (ob.len == 0) {
+    return true;
+  }
+  size_t n = ob.len;
+  ob.len = 0;
+  return writeFD(ob.fd, ob.buf.get(), n);
+}
+
+static void flushStdOutputAtExit() {
+  stdOutputFlush(stdoutBuf);
+  stdOutputFlush(stderrBuf);
+}
+
+bool flushStdout() {
+  return stdOutputFlush(stdoutBuf);
+}
+
+// Read up to [n] bytes from the fd underlying [f] into [out]. Stops
+// early only at end of file. Returns the number of bytes read, or -1
+// on error.
+static int64_t readFD(FILE *f, uint8_t *out, int64_t n) {
+  // make sure a prompt is visible before blocking on input
+  if (f == stdin) {
+    stdOutputFlush(stdoutBuf);
+  }
+  int fd = fileno(f);
+  int64_t nRead = 0;
+  while (nRead < n) {
+    ssize_t k = read(fd, out + nRead, (size_t)(n - nRead));
+    if (k < 0) {
+      if (errno == EINTR) {
+	continue;
+      }
+      return -1;
+    }
+    if (k == 0) {
+      break;
+    }
+    nRead += k;
+  }
+  return nRead;
+}
+
+// Read [n] bytes from [f], using the buffered bytes in [rb] first.
+// Returns fewer than [n] bytes only at end of file. Returns the
+// number of bytes read, or -1 on error.
+static int64_t readBufRead(FILE *f, FileReadBuf &rb, uint8_t *out, int64_t n) {
+  int64_t nBuffered = std::min((int64_t)(rb.end - rb.pos), n);
+  if (nBuffered > 0) {
+    memcpy(out, rb.buf.get() + rb.pos, nBuffered);
+    rb.pos += nBuffered;
+  }
+  if (nBuffered == n) {
+    return n;
+  }
+  // the rest of the request is read directly, bypassing the buffer
+  int64_t nRead = readFD(f, out + nBuffered, n - nBuffered);
+  if (nRead < 0) {
+    return -1;
+  }
+  return nBuffered + nRead;
+}
+
+// Find the next line in [rb], reading more data from [f] as needed.
+// On return, the line is at rb.buf + rb.pos, and is contiguous in
+// the buffer. Returns the length of the line, including the
+// terminating newline, if any (the last line of the file may not have
+// one). Returns 0 at end of file, or -1 on error.
+static int64_t readBufFindLine(FILE *f, FileReadBuf &rb) {
+  size_t scanPos = rb.pos;
+  while (true) {
+    if (scanPos < rb.end) {
+      uint8_t *nl = (uint8_t *)memchr(rb.buf.get() + scanPos, '\n', rb.end - scanPos);
+      if (nl) {
+	return (int64_t)(nl - (rb.buf.get() + rb.pos)) + 1;
+      }
+    }
+
+    // move the partial line to the start of the buffer, and expand
+    // the buffer if the partial line fills it
+    if (rb.pos > 0) {
+      memmove(rb.buf.get(), rb.buf.get() + rb.pos, rb.end - rb.pos);
+      rb.end -= rb.pos;
+      rb.pos = 0;
+    }
+    if (rb.end == rb.size) {
+      size_t newSize = rb.size ? 2 * rb.size : fileReadBufSize;
+      uint8_t *newBuf;
+      try {
+	newBuf = new uint8_t[newSize];
+      } catch (std::bad_alloc) {
+	BytecodeEngine::fatalError("Out of memory");
+      }
+      if (rb.end > 0) {
+	memcpy(newBuf, rb.buf.get(), rb.end);
+      }
+      rb.buf.reset(newBuf);
+      rb.size = newSize;
+    }
+    scanPos = rb.end;
+
+    // read whatever is available (which may be less than a full
+    // buffer, e.g., for a terminal or pipe) -- after making sure a
+    // prompt is visible
+    if (f == stdin) {
+      stdOutputFlush(stdoutBuf);
+    }
+    ssize_t k;
+    do {
+      k = read(fileno(f), rb.buf.get() + rb.end, rb.size - rb.end);
+    } while (k < 0 && errno == EINTR);
+    if (k < 0) {
+      return -1;
+    }
+    if (k == 0) {
+      return (int64_t)(rb.end - rb.pos);
+    }
+    rb.end += k;
+  }
+}
+
+// Read a line from [f] and push it (or an error) onto the stack. At
+// end of file, this pushes an empty string.
+// NB: this may trigger GC.
+static void readLine(FILE *f, FileReadBuf &rb, BytecodeEngine &engine) {
+  int64_t n = readBufFindLine(f, rb);
+  if (n < 0) {
+    engine.push(cellMakeError());
+    return;
+  }
+  // NB: this may trigger GC
+  Cell sCell = stringMake(rb.buf.get() + rb.pos, n, engine);
+  rb.pos += n;
+  engine.push(sCell);
+}
+
+// Read up to [maxLines] lines from [f] and push a Vector of them (or
+// an error) onto the stack. At end of file, this pushes an empty
+// Vector.
+// NB: this may trigger GC.
+static void readLines(FILE *f, FileReadBuf &rb, int64_t maxLines, BytecodeEngine &engine) {
+  if (maxLines < 0) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+
+  // NB: this may trigger GC
+  Cell vCell = vectorMake(engine);
+  engine.pushGCRoot(vCell);
+
+  for (int64_t i = 0; i < maxLines; ++i) {
+    int64_t n = readBufFindLine(f, rb);
+    if (n < 0) {
+      engine.popGCRoot(vCell);
+      engine.push(cellMakeError());
+      return;
+    }
+    if (n == 0) {
+      break;
+    }
+    // NB: this may trigger GC
+    Cell sCell = stringMake(rb.buf.get() + rb.pos, n, engine);
+    rb.pos += n;
+    // NB: this may trigger GC
+    vectorAppend(vCell, sCell, engine);
+  }
+
+  engine.popGCRoot(vCell);
+  engine.push(vCell);
+}
+
+int64_t fileReadBytes(Cell &fCell, uint8_t *buf, int64_t n, BytecodeEngine &engine) {
+  File *file = (File *)cellHeapPtr(fCell);
+  engine.failOnNilPtr(file);
+  FileResource *fileResource = (FileResource *)cellResourcePtr(file->fileResource);
+
+  return readBufRead(fileResource->f, fileResource->readBuf, buf, n);
+}
+
+//------------------------------------------------------------------------
+
 void runtime_File_init(BytecodeEngine &engine) {
+  // stdout is line buffered if it's a terminal; stderr is unbuffered
+  stdOutputInit(stdoutBuf, STDOUT_FILENO, stdoutBufSize, isatty(STDOUT_FILENO));
+  stdOutputInit(stderrBuf, STDERR_FILENO, 0, false);
+  atexit(&flushStdOutputAtExit);
+
   engine.addNativeFunction("openFile_S8FileMode", &runtime_openFile_S8FileMode);
   engine.addNativeFunction("openTempFile_S", &runtime_openTempFile_S);
   engine.addNativeFunction("close_4File", &runtime_close_4File);
   engine.addNativeFunction("read_4FileTI", &runtime_read_4FileTI);
   engine.addNativeFunction("readLine_4File", &runtime_readLine_4File);
+  engine.addNativeFunction("readLines_4FileI", &runtime_readLines_4FileI);
   engine.addNativeFunction("write_4FileS", &runtime_write_4FileS);
   engine.addNativeFunction("write_4FileT", &runtime_write_4FileT);
+  engine.addNativeFunction("writeAll_4FileVS", &runtime_writeAll_4FileVS);
   engine.addNativeFunction("read_TI", &runtime_read_TI);
   engine.addNativeFunction("readLine", &runtime_readLine);
+  engine.addNativeFunction("readLines_I", &runtime_readLines_I);
   engine.addNativeFunction("write_S", &runtime_write_S);
   engine.addNativeFunction("ewrite_S", &runtime_ewrite_S);
+  engine.addNativeFunction("writeAll_VS", &runtime_writeAll_VS);
+  engine.addNativeFunction("flush", &runtime_flush);
+  engine.addNativeFunction("setOutputBuffering_IB", &runtime_setOutputBuffering_IB);
+  engine.addNativeFunction("mapFile_S", &runtime_mapFile_S);
+  engine.addNativeFunction("contents_10MappedFile", &runtime_contents_10MappedFile);
+  engine.addNativeFunction("close_10MappedFile", &runtime_close_10MappedFile);
+  engine.addNativeFunction("readAsync_4FileII", &runtime_readAsync_4FileII);
+  engine.addNativeFunction("writeAsync_4FileIS", &runtime_writeAsync_4FileIS);
+  engine.addNativeFunction("futureID_6Future", &runtime_futureID_6Future);
+  engine.addNativeFunction("isDone_6Future", &runtime_isDone_6Future);
+  engine.addNativeFunction("wait_6Future", &runtime_wait_6Future);
+  engine.addNativeFunction("contents_6Future", &runtime_contents_6Future);
+  engine.addNativeFunction("waitAny_V6Future", &runtime_waitAny_V6Future);
 }
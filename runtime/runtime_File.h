@@ -14,6 +14,16 @@
 
 #include "BytecodeEngine.h"
 
+// Read up to [n] bytes from the File in [fCell] into [buf]. Returns
+// the number of bytes read (which is 0 at end of file), or -1 on
+// error.
+extern int64_t fileReadBytes(Cell &fCell, uint8_t *buf, int64_t n, BytecodeEngine &engine);
+
+// Write any buffered stdout data. This is called before starting a
+// child process that shares stdout. Returns true on success, false on
+// error.
+extern bool flushStdout();
+
 extern void runtime_File_init(BytecodeEngine &engine);
 
 #endif // runtime_File_h
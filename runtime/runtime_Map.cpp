@@ -146,6 +146,23 @@ static void rehash(MapArray *array, int64_t size, MapArray *newArray, int64_t ne
   newArray->free = cellMakeInt(newLength);
 }
 
+// Reallocate the bucket array for the map in [mCell] to have
+// [newSize] buckets, and rehash the existing elements. [newSize] must
+// be a power of 2, and must be at least the map's length. This
+// function may trigger GC.
+static void mapResize(Cell &mCell, int64_t newSize,
+		      int64_t (*doHash)(Cell &cell, int64_t size),
+		      BytecodeEngine &engine) {
+  // NB: this may trigger GC
+  MapArray *newArray = (MapArray *)engine.heapAllocTuple(1 + 4 * newSize, 0);
+
+  MapHandle *m = (MapHandle *)cellPtr(mCell);
+  MapArray *array = (MapArray *)cellPtr(m->arrayPtr);
+  int64_t size = array ? heapObjSize(array) / bytesPerBucket : 0;
+  rehash(array, size, newArray, newSize, doHash);
+  m->arrayPtr = cellMakeHeapPtr(newArray);
+}
+
 // Expand the map in [mCell] to fit [newLength] elements. This may
 // change the map's size (number of hash table buckets), but will not
 // change the map's length; the caller is responsible for changing the
@@ -157,7 +174,6 @@ static bool mapExpand(Cell &mCell, int64_t newLength,
   MapHandle *m = (MapHandle *)cellPtr(mCell);
   engine.failOnNilPtr(m);
   MapArray *array = (MapArray *)cellPtr(m->arrayPtr);
-  int64_t length = heapObjSize(m);
   int64_t size = array ? heapObjSize(array) / bytesPerBucket : 0;
   if (newLength <= size) {
     return false;
@@ -172,12 +188,7 @@ static bool mapExpand(Cell &mCell, int64_t newLength,
   }
 
   // NB: this may trigger GC
-  MapArray *newArray = (MapArray *)engine.heapAllocTuple(1 + 4 * newSize, 0);
-
-  m = (MapHandle *)cellPtr(mCell);
-  array = (MapArray *)cellPtr(m->arrayPtr);
-  rehash(array, size, newArray, newSize, doHash);
-  m->arrayPtr = cellMakeHeapPtr(newArray);
+  mapResize(mCell, newSize, doHash, engine);
 
   return true;
 }
@@ -205,25 +216,32 @@ static bool mapShrink(Cell &mCell,
   } while (newSize > minMapSize && newSize / 4 >= length);
 
   // NB: this may trigger GC
-  MapArray *newArray = (MapArray *)engine.heapAllocTuple(1 + 4 * newSize, 0);
-
-  m = (MapHandle *)cellPtr(mCell);
-  array = (MapArray *)cellPtr(m->arrayPtr);
-  rehash(array, size, newArray, newSize, doHash);
-  m->arrayPtr = cellMakeHeapPtr(newArray);
+  mapResize(mCell, newSize, doHash, engine);
 
   return true;
 }
 
+// _allocMap()
+// _allocMap(capacity: Int)
 static NativeFuncDefn(runtime_allocMap) {
 #if CHECK_RUNTIME_FUNC_ARGS
-  if (engine.nArgs() != 0) {
+  if (engine.nArgs() > 1 ||
+      (engine.nArgs() == 1 && !cellIsInt(engine.arg(0)))) {
     BytecodeEngine::fatalError("Invalid argument");
   }
 #endif
-  MapHandle *m = (MapHandle *)engine.heapAllocHandle(0, 0);
-  m->arrayPtr = cellMakeNilHeapPtr();
-  engine.push(cellMakeHeapPtr(m));
+  int64_t capacity = 0;
+  if (engine.nArgs() == 1) {
+    capacity = cellInt(engine.arg(0));
+    if (capacity < 0) {
+      BytecodeEngine::fatalError("Invalid argument");
+    }
+  }
+
+  // NB: this may trigger GC
+  Cell mCell = mapMake(capacity, engine);
+
+  engine.push(mCell);
 }
 
 // length(m: Map[$K:$T]) -> Int
@@ -406,8 +424,6 @@ static void doSet(Cell &mCell, Cell &keyCell, Cell &valueCell,
 
     heapObjSetSize(m, length + 1);
   }
-
-  engine.push(cellMakeInt(0));
 }
 
 // set(m: Map[String:$T], key: String, value: $T)
@@ -424,6 +440,7 @@ static NativeFuncDefn(runtime_set_MS3) {
   Cell &valueCell = engine.arg(2);
   BytecodeEngine::failOnNilPtr(keyCell);
   doSet(mCell, keyCell, valueCell, &doHashString, &doCompareStrings, engine);
+  engine.push(cellMakeInt(0));
 }
 
 // set(m: Map[Int:$T], key: Int, value: $T)
@@ -439,6 +456,7 @@ static NativeFuncDefn(runtime_set_MI3) {
   Cell &keyCell = engine.arg(1);
   Cell &valueCell = engine.arg(2);
   doSet(mCell, keyCell, valueCell, &doHashInt, &doCompareInts, engine);
+  engine.push(cellMakeInt(0));
 }
 
 static void doDelete(Cell &mCell, Cell &keyCell,
@@ -533,6 +551,115 @@ static NativeFuncDefn(runtime_clear_M1) {
   engine.push(cellMakeInt(0));
 }
 
+// capacity(m: Map[$K:$T]) -> Int
+static NativeFuncDefn(runtime_capacity_M1) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &mCell = engine.arg(0);
+
+  MapHandle *m = (MapHandle *)cellPtr(mCell);
+  engine.failOnNilPtr(m);
+  MapArray *array = (MapArray *)cellPtr(m->arrayPtr);
+  int64_t size = array ? heapObjSize(array) / bytesPerBucket : 0;
+
+  engine.push(cellMakeInt(size));
+}
+
+static void doReserve(Cell &mCell, Cell &nCell,
+		      int64_t (*doHash)(Cell &cell, int64_t size),
+		      BytecodeEngine &engine) {
+  int64_t n = cellInt(nCell);
+  if (n < 0) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+
+  // NB: this may trigger GC
+  mapExpand(mCell, n, doHash, engine);
+
+  engine.push(cellMakeInt(0));
+}
+
+// reserve(m: Map[String:$T], n: Int)
+static NativeFuncDefn(runtime_reserve_MS2) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsInt(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &mCell = engine.arg(0);
+  Cell &nCell = engine.arg(1);
+  doReserve(mCell, nCell, &doHashString, engine);
+}
+
+// reserve(m: Map[Int:$T], n: Int)
+static NativeFuncDefn(runtime_reserve_MI2) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsInt(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &mCell = engine.arg(0);
+  Cell &nCell = engine.arg(1);
+  doReserve(mCell, nCell, &doHashInt, engine);
+}
+
+static void doShrinkToFit(Cell &mCell,
+			  int64_t (*doHash)(Cell &cell, int64_t size),
+			  BytecodeEngine &engine) {
+  MapHandle *m = (MapHandle *)cellPtr(mCell);
+  engine.failOnNilPtr(m);
+  MapArray *array = (MapArray *)cellPtr(m->arrayPtr);
+  int64_t length = heapObjSize(m);
+  int64_t size = array ? heapObjSize(array) / bytesPerBucket : 0;
+
+  if (length == 0) {
+    m->arrayPtr = cellMakeNilHeapPtr();
+  } else {
+    int64_t newSize = minMapSize;
+    while (newSize < length) {
+      newSize *= 2;
+    }
+    if (newSize < size) {
+      // NB: this may trigger GC
+      mapResize(mCell, newSize, doHash, engine);
+    }
+  }
+
+  engine.push(cellMakeInt(0));
+}
+
+// shrinkToFit(m: Map[String:$T])
+static NativeFuncDefn(runtime_shrinkToFit_MS1) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &mCell = engine.arg(0);
+  doShrinkToFit(mCell, &doHashString, engine);
+}
+
+// shrinkToFit(m: Map[Int:$T])
+static NativeFuncDefn(runtime_shrinkToFit_MI1) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &mCell = engine.arg(0);
+  doShrinkToFit(mCell, &doHashInt, engine);
+}
+
 // ifirst(m: Map[$K:$T]) -> Int
 static NativeFuncDefn(runtime_ifirst_M1) {
 #if CHECK_RUNTIME_FUNC_ARGS
@@ -631,6 +758,9 @@ void runtime_Map_init(BytecodeEngine &engine) {
   engine.addNativeFunction("set_MS3", &runtime_set_MS3);
   engine.addNativeFunction("delete_MS2", &runtime_delete_MS2);
   engine.addNativeFunction("clear_MS1", &runtime_clear_M1);
+  engine.addNativeFunction("capacity_MS1", &runtime_capacity_M1);
+  engine.addNativeFunction("reserve_MS2", &runtime_reserve_MS2);
+  engine.addNativeFunction("shrinkToFit_MS1", &runtime_shrinkToFit_MS1);
   engine.addNativeFunction("ifirst_MS1", &runtime_ifirst_M1);
   engine.addNativeFunction("imore_MS2", &runtime_imore_M2);
   engine.addNativeFunction("inext_MS2", &runtime_inext_M2);
@@ -642,8 +772,63 @@ void runtime_Map_init(BytecodeEngine &engine) {
   engine.addNativeFunction("set_MI3", &runtime_set_MI3);
   engine.addNativeFunction("delete_MI2", &runtime_delete_MI2);
   engine.addNativeFunction("clear_MI1", &runtime_clear_M1);
+  engine.addNativeFunction("capacity_MI1", &runtime_capacity_M1);
+  engine.addNativeFunction("reserve_MI2", &runtime_reserve_MI2);
+  engine.addNativeFunction("shrinkToFit_MI1", &runtime_shrinkToFit_MI1);
   engine.addNativeFunction("ifirst_MI1", &runtime_ifirst_M1);
   engine.addNativeFunction("imore_MI2", &runtime_imore_M2);
   engine.addNativeFunction("inext_MI2", &runtime_inext_M2);
   engine.addNativeFunction("iget_MI2", &runtime_iget_M2);
 }
+
+//------------------------------------------------------------------------
+// support functions
+//------------------------------------------------------------------------
+
+Cell mapMake(int64_t capacity, BytecodeEngine &engine) {
+  MapHandle *m = (MapHandle *)engine.heapAllocHandle(0, 0);
+  m->arrayPtr = cellMakeNilHeapPtr();
+  Cell mCell = cellMakeHeapPtr(m);
+
+  if (capacity > 0) {
+    engine.pushGCRoot(mCell);
+    // the map is empty, so the hash function is never called,
+    // and it doesn't matter which one is passed here
+    // NB: this may trigger GC
+    mapExpand(mCell, capacity, &doHashInt, engine);
+    engine.popGCRoot(mCell);
+  }
+
+  return mCell;
+}
+
+void mapSet(Cell &mCell, Cell &keyCell, Cell &valueCell, bool stringKeys,
+	    BytecodeEngine &engine) {
+  // [keyCell] and [valueCell] are often unregistered locals in the
+  // caller, so this roots copies (see vectorAppend)
+  Cell key = keyCell;
+  Cell value = valueCell;
+  engine.pushGCRoot(key);
+  engine.pushGCRoot(value);
+  // NB: this may trigger GC
+  if (stringKeys) {
+    BytecodeEngine::failOnNilPtr(key);
+    doSet(mCell, key, value, &doHashString, &doCompareStrings, engine);
+  } else {
+    doSet(mCell, key, value, &doHashInt, &doCompareInts, engine);
+  }
+  engine.popGCRoot(value);
+  engine.popGCRoot(key);
+}
+
+void mapForEach(Cell &mCell, const std::function<void(Cell keyCell, Cell valueCell)> &func) {
+  MapHandle *m = (MapHandle *)cellPtr(mCell);
+  BytecodeEngine::failOnNilPtr(m);
+  MapArray *array = (MapArray *)cellPtr(m->arrayPtr);
+  int64_t size = array ? (heapObjSize(array) / bytesPerBucket) : 0;
+  for (int64_t i = 0; i < size; ++i) {
+    if (!cellIsNilHeapPtr(array->buckets[i].key)) {
+      func(array->buckets[i].key, array->buckets[i].val);
+    }
+  }
+}
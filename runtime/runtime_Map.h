@@ -12,8 +12,26 @@
 #ifndef runtime_Map_h
 #define runtime_Map_h
 
+#include <functional>
 #include "BytecodeEngine.h"
 
+// Construct an empty map on the heap, with room for [capacity]
+// elements.
+// NB: the caller is responsible for making the returned Cell visible
+// to the GC.
+// NB: this may trigger GC.
+extern Cell mapMake(int64_t capacity, BytecodeEngine &engine);
+
+// Set [keyCell] to [valueCell] in [mCell]. [stringKeys] is true for
+// Map[String:$T], false for Map[Int:$T].
+// NB: this may trigger GC.
+extern void mapSet(Cell &mCell, Cell &keyCell, Cell &valueCell, bool stringKeys,
+		   BytecodeEngine &engine);
+
+// Call [func] on each key/value pair in [mCell]. [func] must not
+// trigger GC.
+extern void mapForEach(Cell &mCell, const std::function<void(Cell keyCell, Cell valueCell)> &func);
+
 extern void runtime_Map_init(BytecodeEngine &engine);
 
 #endif // runtime_Map_h
@@ -142,6 +142,23 @@ static void rehash(SetArray *array, int64_t size, SetArray *newArray, int64_t ne
   newArray->free = cellMakeInt(newLength);
 }
 
+// Reallocate the bucket array for the set in [sCell] to have
+// [newSize] buckets, and rehash the existing elements. [newSize] must
+// be a power of 2, and must be at least the set's length. This
+// function may trigger GC.
+static void setResize(Cell &sCell, int64_t newSize,
+		      int64_t (*doHash)(Cell &cell, int64_t size),
+		      BytecodeEngine &engine) {
+  // NB: this may trigger GC
+  SetArray *newArray = (SetArray *)engine.heapAllocTuple(1 + 3 * newSize, 0);
+
+  SetHandle *s = (SetHandle *)cellPtr(sCell);
+  SetArray *array = (SetArray *)cellPtr(s->arrayPtr);
+  int64_t size = array ? heapObjSize(array) / bytesPerBucket : 0;
+  rehash(array, size, newArray, newSize, doHash);
+  s->arrayPtr = cellMakeHeapPtr(newArray);
+}
+
 // Expand the set in [sCell] to fit [newLength] elements. This may
 // change the set's size (number of hash table buckets), but will not
 // change the set's length; the caller is responsible for changing the
@@ -153,7 +170,6 @@ static bool setExpand(Cell &sCell, int64_t newLength,
   SetHandle *s = (SetHandle *)cellPtr(sCell);
   engine.failOnNilPtr(s);
   SetArray *array = (SetArray *)cellPtr(s->arrayPtr);
-  int64_t length = heapObjSize(s);
   int64_t size = array ? heapObjSize(array) / bytesPerBucket : 0;
   if (newLength <= size) {
     return false;
@@ -168,12 +184,7 @@ static bool setExpand(Cell &sCell, int64_t newLength,
   }
 
   // NB: this may trigger GC
-  SetArray *newArray = (SetArray *)engine.heapAllocTuple(1 + 3 * newSize, 0);
-
-  s = (SetHandle *)cellPtr(sCell);
-  array = (SetArray *)cellPtr(s->arrayPtr);
-  rehash(array, size, newArray, newSize, doHash);
-  s->arrayPtr = cellMakeHeapPtr(newArray);
+  setResize(sCell, newSize, doHash, engine);
 
   return true;
 }
@@ -201,25 +212,32 @@ static bool setShrink(Cell &sCell,
   } while (newSize > minSetSize && newSize / 4 >= length);
 
   // NB: this may trigger GC
-  SetArray *newArray = (SetArray *)engine.heapAllocTuple(1 + 3 * newSize, 0);
-
-  s = (SetHandle *)cellPtr(sCell);
-  array = (SetArray *)cellPtr(s->arrayPtr);
-  rehash(array, size, newArray, newSize, doHash);
-  s->arrayPtr = cellMakeHeapPtr(newArray);
+  setResize(sCell, newSize, doHash, engine);
 
   return true;
 }
 
+// _allocSet()
+// _allocSet(capacity: Int)
 static NativeFuncDefn(runtime_allocSet) {
 #if CHECK_RUNTIME_FUNC_ARGS
-  if (engine.nArgs() != 0) {
+  if (engine.nArgs() > 1 ||
+      (engine.nArgs() == 1 && !cellIsInt(engine.arg(0)))) {
     BytecodeEngine::fatalError("Invalid argument");
   }
 #endif
-  SetHandle *s = (SetHandle *)engine.heapAllocHandle(0, 0);
-  s->arrayPtr = cellMakeNilHeapPtr();
-  engine.push(cellMakeHeapPtr(s));
+  int64_t capacity = 0;
+  if (engine.nArgs() == 1) {
+    capacity = cellInt(engine.arg(0));
+    if (capacity < 0) {
+      BytecodeEngine::fatalError("Invalid argument");
+    }
+  }
+
+  // NB: this may trigger GC
+  Cell sCell = setMake(capacity, engine);
+
+  engine.push(sCell);
 }
 
 // length(s: Set[$K]) -> Int
@@ -342,8 +360,6 @@ static void doInsert(Cell &sCell, Cell &elemCell,
 
     heapObjSetSize(s, length + 1);
   }
-
-  engine.push(cellMakeInt(0));
 }
 
 // insert(s: Set[String], elem: String)
@@ -359,6 +375,7 @@ static NativeFuncDefn(runtime_insert_ZS2) {
   Cell &elemCell = engine.arg(1);
   BytecodeEngine::failOnNilPtr(elemCell);
   doInsert(sCell, elemCell, &doHashString, &doCompareStrings, engine);
+  engine.push(cellMakeInt(0));
 }
 
 // insert(s: Set[Int], elem: Int)
@@ -372,6 +389,7 @@ static NativeFuncDefn(runtime_insert_ZI2) {
     BytecodeEngine::fatalError("Invalid argument");
   }
   doInsert(sCell, elemCell, &doHashInt, &doCompareInts, engine);
+  engine.push(cellMakeInt(0));
 }
 
 static void doDelete(Cell &sCell, Cell &elemCell,
@@ -465,6 +483,115 @@ static NativeFuncDefn(runtime_clear_Z1) {
   engine.push(cellMakeInt(0));
 }
 
+// capacity(s: Set[$K]) -> Int
+static NativeFuncDefn(runtime_capacity_Z1) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &sCell = engine.arg(0);
+
+  SetHandle *s = (SetHandle *)cellPtr(sCell);
+  engine.failOnNilPtr(s);
+  SetArray *array = (SetArray *)cellPtr(s->arrayPtr);
+  int64_t size = array ? heapObjSize(array) / bytesPerBucket : 0;
+
+  engine.push(cellMakeInt(size));
+}
+
+static void doReserve(Cell &sCell, Cell &nCell,
+		      int64_t (*doHash)(Cell &cell, int64_t size),
+		      BytecodeEngine &engine) {
+  int64_t n = cellInt(nCell);
+  if (n < 0) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+
+  // NB: this may trigger GC
+  setExpand(sCell, n, doHash, engine);
+
+  engine.push(cellMakeInt(0));
+}
+
+// reserve(s: Set[String], n: Int)
+static NativeFuncDefn(runtime_reserve_ZS2) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsInt(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &sCell = engine.arg(0);
+  Cell &nCell = engine.arg(1);
+  doReserve(sCell, nCell, &doHashString, engine);
+}
+
+// reserve(s: Set[Int], n: Int)
+static NativeFuncDefn(runtime_reserve_ZI2) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsInt(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &sCell = engine.arg(0);
+  Cell &nCell = engine.arg(1);
+  doReserve(sCell, nCell, &doHashInt, engine);
+}
+
+static void doShrinkToFit(Cell &sCell,
+			  int64_t (*doHash)(Cell &cell, int64_t size),
+			  BytecodeEngine &engine) {
+  SetHandle *s = (SetHandle *)cellPtr(sCell);
+  engine.failOnNilPtr(s);
+  SetArray *array = (SetArray *)cellPtr(s->arrayPtr);
+  int64_t length = heapObjSize(s);
+  int64_t size = array ? heapObjSize(array) / bytesPerBucket : 0;
+
+  if (length == 0) {
+    s->arrayPtr = cellMakeNilHeapPtr();
+  } else {
+    int64_t newSize = minSetSize;
+    while (newSize < length) {
+      newSize *= 2;
+    }
+    if (newSize < size) {
+      // NB: this may trigger GC
+      setResize(sCell, newSize, doHash, engine);
+    }
+  }
+
+  engine.push(cellMakeInt(0));
+}
+
+// shrinkToFit(s: Set[String])
+static NativeFuncDefn(runtime_shrinkToFit_ZS1) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &sCell = engine.arg(0);
+  doShrinkToFit(sCell, &doHashString, engine);
+}
+
+// shrinkToFit(s: Set[Int])
+static NativeFuncDefn(runtime_shrinkToFit_ZI1) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &sCell = engine.arg(0);
+  doShrinkToFit(sCell, &doHashInt, engine);
+}
+
 // ifirst(s: Set[$K]) -> Int
 static NativeFuncDefn(runtime_ifirst_Z1) {
 #if CHECK_RUNTIME_FUNC_ARGS
@@ -562,6 +689,9 @@ void runtime_Set_init(BytecodeEngine &engine) {
   engine.addNativeFunction("insert_ZS2", &runtime_insert_ZS2);
   engine.addNativeFunction("delete_ZS2", &runtime_delete_ZS2);
   engine.addNativeFunction("clear_ZS1", &runtime_clear_Z1);
+  engine.addNativeFunction("capacity_ZS1", &runtime_capacity_Z1);
+  engine.addNativeFunction("reserve_ZS2", &runtime_reserve_ZS2);
+  engine.addNativeFunction("shrinkToFit_ZS1", &runtime_shrinkToFit_ZS1);
   engine.addNativeFunction("ifirst_ZS1", &runtime_ifirst_Z1);
   engine.addNativeFunction("imore_ZS2", &runtime_imore_Z2);
   engine.addNativeFunction("inext_ZS2", &runtime_inext_Z2);
@@ -572,8 +702,59 @@ void runtime_Set_init(BytecodeEngine &engine) {
   engine.addNativeFunction("insert_ZI2", &runtime_insert_ZI2);
   engine.addNativeFunction("delete_ZI2", &runtime_delete_ZI2);
   engine.addNativeFunction("clear_ZI1", &runtime_clear_Z1);
+  engine.addNativeFunction("capacity_ZI1", &runtime_capacity_Z1);
+  engine.addNativeFunction("reserve_ZI2", &runtime_reserve_ZI2);
+  engine.addNativeFunction("shrinkToFit_ZI1", &runtime_shrinkToFit_ZI1);
   engine.addNativeFunction("ifirst_ZI1", &runtime_ifirst_Z1);
   engine.addNativeFunction("imore_ZI2", &runtime_imore_Z2);
   engine.addNativeFunction("inext_ZI2", &runtime_inext_Z2);
   engine.addNativeFunction("iget_ZI2", &runtime_iget_Z2);
 }
+
+//------------------------------------------------------------------------
+// support functions
+//------------------------------------------------------------------------
+
+Cell setMake(int64_t capacity, BytecodeEngine &engine) {
+  SetHandle *s = (SetHandle *)engine.heapAllocHandle(0, 0);
+  s->arrayPtr = cellMakeNilHeapPtr();
+  Cell sCell = cellMakeHeapPtr(s);
+
+  if (capacity > 0) {
+    engine.pushGCRoot(sCell);
+    // the set is empty, so the hash function is never called,
+    // and it doesn't matter which one is passed here
+    // NB: this may trigger GC
+    setExpand(sCell, capacity, &doHashInt, engine);
+    engine.popGCRoot(sCell);
+  }
+
+  return sCell;
+}
+
+void setInsert(Cell &sCell, Cell &elemCell, bool stringElems, BytecodeEngine &engine) {
+  // [elemCell] is often an unregistered local in the caller, so this
+  // roots a copy (see vectorAppend)
+  Cell elem = elemCell;
+  engine.pushGCRoot(elem);
+  // NB: this may trigger GC
+  if (stringElems) {
+    BytecodeEngine::failOnNilPtr(elem);
+    doInsert(sCell, elem, &doHashString, &doCompareStrings, engine);
+  } else {
+    doInsert(sCell, elem, &doHashInt, &doCompareInts, engine);
+  }
+  engine.popGCRoot(elem);
+}
+
+void setForEach(Cell &sCell, const std::function<void(Cell elemCell)> &func) {
+  SetHandle *s = (SetHandle *)cellPtr(sCell);
+  BytecodeEngine::failOnNilPtr(s);
+  SetArray *array = (SetArray *)cellPtr(s->arrayPtr);
+  int64_t size = array ? (heapObjSize(array) / bytesPerBucket) : 0;
+  for (int64_t i = 0; i < size; ++i) {
+    if (!cellIsNilHeapPtr(array->buckets[i].key)) {
+      func(array->buckets[i].key);
+    }
+  }
+}
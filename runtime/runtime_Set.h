@@ -12,8 +12,25 @@
 #ifndef runtime_Set_h
 #define runtime_Set_h
 
+#include <functional>
 #include "BytecodeEngine.h"
 
+// Construct an empty set on the heap, with room for [capacity]
+// elements.
+// NB: the caller is responsible for making the returned Cell visible
+// to the GC.
+// NB: this may trigger GC.
+extern Cell setMake(int64_t capacity, BytecodeEngine &engine);
+
+// Insert [elemCell] into [sCell]. [stringElems] is true for
+// Set[String], false for Set[Int].
+// NB: this may trigger GC.
+extern void setInsert(Cell &sCell, Cell &elemCell, bool stringElems, BytecodeEngine &engine);
+
+// Call [func] on each element of [sCell]. [func] must not trigger
+// GC.
+extern void setForEach(Cell &sCell, const std::function<void(Cell elemCell)> &func);
+
 extern void runtime_Set_init(BytecodeEngine &engine);
 
 #endif // runtime_Set_h
@@ -9,12 +9,106 @@
 
 #include "runtime_String.h"
 #include <string.h>
+#include <vector>
 #include <unicode/uchar.h>
 #include "BytecodeDefs.h"
 #include "NumConversion.h"
 #include "UTF8.h"
 #include "runtime_Vector.h"
 
+//------------------------------------------------------------------------
+
+// A string is either a flat string, i.e., a blob containing the
+// bytes, or a slice, i.e., a tuple (with type tag
+// heapTypeTagStringSlice) that refers to part of a flat string:
+//
+// +-----+--------+--------+--------+-------+
+// | hdr | parent | offset | length | owner |
+// +-----+--------+--------+--------+-------+
+//
+// The parent of a slice is always a flat string (possibly a string
+// literal, or a memory-mapped file, which are not on the heap).
+// Substrings shorter than minStringSliceLength bytes are copied,
+// because a copy is no larger than a slice. The GC keeps the parent
+// alive as long as any slice refers to it, but will make flat copies
+// of small slices of otherwise-unreachable parents. A parent that
+// isn't on the heap and isn't a literal is kept alive by the owner,
+// a resource pointer, which is shared by all slices of the parent
+// (owner is a nil resource pointer for other slices).
+struct StringSlice {
+  uint64_t hdr;
+  Cell parent;
+  Cell offset;
+  Cell length;
+  Cell owner;
+};
+
+#define stringSliceNCells (sizeof(StringSlice) / sizeof(Cell) - 1)
+
+#define minStringSliceLength 32
+
+//------------------------------------------------------------------------
+
+// Find the first occurrence of [sub] in [s], starting at byte
+// [start]. Returns the byte index, or -1 if not found. Single-byte
+// patterns use memchr; longer patterns use memmem (which is a
+// Two-Way search in glibc).
+static int64_t stringFind(const uint8_t *s, int64_t sLength, int64_t start,
+			  const uint8_t *sub, int64_t subLength) {
+  if (start > sLength || subLength > sLength - start) {
+    return -1;
+  }
+  if (subLength == 0) {
+    return start;
+  }
+  const uint8_t *p;
+  if (subLength == 1) {
+    p = (const uint8_t *)memchr(s + start, sub[0], sLength - start);
+  } else {
+    p = (const uint8_t *)memmem(s + start, sLength - start, sub, subLength);
+  }
+  return p ? (int64_t)(p - s) : -1;
+}
+
+// Find the last occurrence of [sub] in [s]. Returns the byte index,
+// or -1 if not found. This is a Horspool search run backward: the
+// skip table is indexed by the byte aligned with the start of the
+// pattern.
+static int64_t stringFindLast(const uint8_t *s, int64_t sLength,
+			      const uint8_t *sub, int64_t subLength) {
+  if (subLength > sLength) {
+    return -1;
+  }
+  if (subLength == 0) {
+    return sLength;
+  }
+  if (subLength == 1) {
+    for (int64_t i = sLength - 1; i >= 0; --i) {
+      if (s[i] == sub[0]) {
+	return i;
+      }
+    }
+    return -1;
+  }
+  int64_t skip[256];
+  for (int i = 0; i < 256; ++i) {
+    skip[i] = subLength;
+  }
+  for (int64_t k = subLength - 1; k >= 1; --k) {
+    skip[sub[k]] = k;
+  }
+  int64_t i = sLength - subLength;
+  while (i >= 0) {
+    if (s[i] == sub[0] && !memcmp(s + i + 1, sub + 1, subLength - 1)) {
+      return i;
+    }
+    i -= skip[s[i]];
+  }
+  return -1;
+}
+
+//------------------------------------------------------------------------
+
 // compare(s1: String, s2: String) -> Int
 static NativeFuncDefn(runtime_compare_SS) {
 #if CHECK_RUNTIME_FUNC_ARGS
@@ -176,17 +270,9 @@ static NativeFuncDefn(runtime_splitLast_SS) {
   Cell vCell = vectorMake(engine);
   engine.pushGCRoot(vCell);
 
-  uint8_t *sData = stringData(sCell);
   int64_t sLength = stringByteLength(sCell);
-  uint8_t *termData = stringData(termCell);
   int64_t termLength = stringByteLength(termCell);
-  //~ this should use a more efficient string search algorithm
-  int64_t i;
-  for (i = sLength - termLength; i >= 0; --i) {
-    if (!memcmp(sData + i, termData, termLength)) {
-      break;
-    }
-  }
+  int64_t i = stringFindLast(stringData(sCell), sLength, stringData(termCell), termLength);
   if (i >= 0) {
     int64_t j = i + termLength;
     Cell substr1Cell = stringMake(sCell, 0, i, engine);
@@ -248,6 +334,216 @@ static NativeFuncDefn(runtime_removeSuffix_SS) {
   }
 }
 
+// indexOf(s: String, sub: String) -> Int
+static NativeFuncDefn(runtime_indexOf_SS) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsPtr(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &sCell = engine.arg(0);
+  Cell &subCell = engine.arg(1);
+
+  int64_t idx = stringFind(stringData(sCell), stringByteLength(sCell), 0,
+			   stringData(subCell), stringByteLength(subCell));
+  engine.push(cellMakeInt(idx));
+}
+
+// indexOf(s: String, sub: String, start: Int) -> Int
+static NativeFuncDefn(runtime_indexOf_SSI) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 3 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsPtr(engine.arg(1)) ||
+      !cellIsInt(engine.arg(2))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &sCell = engine.arg(0);
+  Cell &subCell = engine.arg(1);
+  Cell &startCell = engine.arg(2);
+
+  int64_t sLength = stringByteLength(sCell);
+  int64_t start = cellInt(startCell);
+  if (start < 0 || start > sLength) {
+    BytecodeEngine::fatalError("Index out of bounds");
+  }
+
+  int64_t idx = stringFind(stringData(sCell), sLength, start,
+			   stringData(subCell), stringByteLength(subCell));
+  engine.push(cellMakeInt(idx));
+}
+
+// lastIndexOf(s: String, sub: String) -> Int
+static NativeFuncDefn(runtime_lastIndexOf_SS) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsPtr(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &sCell = engine.arg(0);
+  Cell &subCell = engine.arg(1);
+
+  int64_t idx = stringFindLast(stringData(sCell), stringByteLength(sCell),
+			       stringData(subCell), stringByteLength(subCell));
+  engine.push(cellMakeInt(idx));
+}
+
+// contains(s: String, sub: String) -> Bool
+static NativeFuncDefn(runtime_contains_SS) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsPtr(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &sCell = engine.arg(0);
+  Cell &subCell = engine.arg(1);
+
+  int64_t idx = stringFind(stringData(sCell), stringByteLength(sCell), 0,
+			   stringData(subCell), stringByteLength(subCell));
+  engine.push(cellMakeBool(idx >= 0));
+}
+
+// count(s: String, sub: String) -> Int
+// Counts non-overlapping occurrences. [sub] must not be empty.
+static NativeFuncDefn(runtime_count_SS) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsPtr(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &sCell = engine.arg(0);
+  Cell &subCell = engine.arg(1);
+
+  uint8_t *sData = stringData(sCell);
+  int64_t sLength = stringByteLength(sCell);
+  uint8_t *subData = stringData(subCell);
+  int64_t subLength = stringByteLength(subCell);
+  if (subLength == 0) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+
+  int64_t n = 0;
+  int64_t i = 0;
+  while ((i = stringFind(sData, sLength, i, subData, subLength)) >= 0) {
+    ++n;
+    i += subLength;
+  }
+  engine.push(cellMakeInt(n));
+}
+
+// Replace the occurrences of [sub] at byte offsets [matches] in [s]
+// with [repl]. The output is allocated once, at its final size.
+// NB: this may trigger GC
+static Cell stringReplaceMatches(Cell &sCell, int64_t subLength, Cell &replCell,
+				 const std::vector<int64_t> &matches,
+				 BytecodeEngine &engine) {
+  int64_t sLength = stringByteLength(sCell);
+  int64_t replLength = stringByteLength(replCell);
+  int64_t nMatches = (int64_t)matches.size();
+  int64_t outLength;
+  if (__builtin_mul_overflow(nMatches, replLength - subLength, &outLength) ||
+      __builtin_add_overflow(outLength, sLength, &outLength) ||
+      outLength > bytecodeMaxInt) {
+    BytecodeEngine::fatalError("Integer overflow");
+  }
+
+  // NB: this may trigger GC
+  Cell outCell = stringAlloc(outLength, engine);
+
+  uint8_t *out = stringData(outCell);
+  uint8_t *sData = stringData(sCell);
+  uint8_t *replData = stringData(replCell);
+  int64_t i = 0;
+  for (int64_t match : matches) {
+    memcpy(out, sData + i, match - i);
+    out += match - i;
+    memcpy(out, replData, replLength);
+    out += replLength;
+    i = match + subLength;
+  }
+  memcpy(out, sData + i, sLength - i);
+  return outCell;
+}
+
+// replace(s: String, sub: String, repl: String) -> String
+// Replaces the first occurrence of [sub]. [sub] must not be empty.
+static NativeFuncDefn(runtime_replace_SSS) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 3 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsPtr(engine.arg(1)) ||
+      !cellIsPtr(engine.arg(2))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &sCell = engine.arg(0);
+  Cell &subCell = engine.arg(1);
+  Cell &replCell = engine.arg(2);
+
+  int64_t subLength = stringByteLength(subCell);
+  if (subLength == 0) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+  int64_t idx = stringFind(stringData(sCell), stringByteLength(sCell), 0,
+			   stringData(subCell), subLength);
+  if (idx < 0) {
+    engine.push(sCell);
+    return;
+  }
+
+  std::vector<int64_t> matches(1, idx);
+  // NB: this may trigger GC
+  engine.push(stringReplaceMatches(sCell, subLength, replCell, matches, engine));
+}
+
+// replaceAll(s: String, sub: String, repl: String) -> String
+// Replaces all non-overlapping occurrences of [sub], scanning left to
+// right. [sub] must not be empty.
+static NativeFuncDefn(runtime_replaceAll_SSS) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 3 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsPtr(engine.arg(1)) ||
+      !cellIsPtr(engine.arg(2))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &sCell = engine.arg(0);
+  Cell &subCell = engine.arg(1);
+  Cell &replCell = engine.arg(2);
+
+  uint8_t *sData = stringData(sCell);
+  int64_t sLength = stringByteLength(sCell);
+  uint8_t *subData = stringData(subCell);
+  int64_t subLength = stringByteLength(subCell);
+  if (subLength == 0) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+
+  std::vector<int64_t> matches;
+  int64_t i = 0;
+  while ((i = stringFind(sData, sLength, i, subData, subLength)) >= 0) {
+    matches.push_back(i);
+    i += subLength;
+  }
+  if (matches.empty()) {
+    engine.push(sCell);
+    return;
+  }
+
+  // NB: this may trigger GC
+  engine.push(stringReplaceMatches(sCell, subLength, replCell, matches, engine));
+}
+
 // toInt(s: String) -> Result[Int]
 static NativeFuncDefn(runtime_toInt_S) {
 #if CHECK_RUNTIME_FUNC_ARGS
@@ -259,7 +555,8 @@ static NativeFuncDefn(runtime_toInt_S) {
   Cell &sCell = engine.arg(0);
 
   int64_t val;
-  if (stringToInt56Checked(stringToStdString(sCell), 10, val)) {
+  if (stringToInt56Checked((const char *)stringData(sCell), stringByteLength(sCell),
+			   10, val)) {
     engine.push(cellMakeInt(val));
   } else {
     engine.push(cellMakeError());
@@ -284,7 +581,8 @@ static NativeFuncDefn(runtime_toInt_SI) {
   }
 
   int64_t val;
-  if (stringToInt56Checked(stringToStdString(sCell), (int)base, val)) {
+  if (stringToInt56Checked((const char *)stringData(sCell), stringByteLength(sCell),
+			   (int)base, val)) {
     engine.push(cellMakeInt(val));
   } else {
     engine.push(cellMakeError());
@@ -302,13 +600,34 @@ static NativeFuncDefn(runtime_toFloat_S) {
   Cell &sCell = engine.arg(0);
 
   float val;
-  if (stringToFloatChecked(stringToStdString(sCell), val)) {
+  if (stringToFloatChecked((const char *)stringData(sCell), stringByteLength(sCell),
+			   val)) {
     engine.push(cellMakeFloat(val));
   } else {
     engine.push(cellMakeError());
   }
 }
 
+// toDouble(s: String) -> Result[Double]
+static NativeFuncDefn(runtime_toDouble_S) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &sCell = engine.arg(0);
+
+  double val;
+  if (stringToDoubleChecked((const char *)stringData(sCell), stringByteLength(sCell),
+			    val)) {
+    // NB: this may trigger GC
+    engine.push(engine.heapAllocDouble(val));
+  } else {
+    engine.push(cellMakeError());
+  }
+}
+
 // byteLength(s: String) -> Int
 static NativeFuncDefn(runtime_byteLength_S) {
 #if CHECK_RUNTIME_FUNC_ARGS
@@ -410,6 +729,45 @@ static NativeFuncDefn(runtime_prevCodepoint_SI) {
   engine.push(cellMakeInt(idx - n));
 }
 
+// codepointLength(s: String) -> Int
+static NativeFuncDefn(runtime_codepointLength_S) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &s = engine.arg(0);
+
+  engine.push(cellMakeInt(utf8CountCodepoints(stringData(s), stringByteLength(s))));
+}
+
+// isAscii(s: String) -> Bool
+static NativeFuncDefn(runtime_isAscii_S) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &s = engine.arg(0);
+
+  engine.push(cellMakeBool(utf8IsAscii(stringData(s), stringByteLength(s))));
+}
+
+// isValidUTF8(s: String) -> Bool
+static NativeFuncDefn(runtime_isValidUTF8_S) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &s = engine.arg(0);
+
+  engine.push(cellMakeBool(utf8IsValid(stringData(s), stringByteLength(s))));
+}
+
 // substr(s: String, first: Int, last: Int) -> String
 static NativeFuncDefn(runtime_substr_SII) {
 #if CHECK_RUNTIME_FUNC_ARGS
@@ -534,14 +892,25 @@ void runtime_String_init(BytecodeEngine &engine) {
   engine.addNativeFunction("splitLast_SS", &runtime_splitLast_SS);
   engine.addNativeFunction("removePrefix_SS", &runtime_removePrefix_SS);
   engine.addNativeFunction("removeSuffix_SS", &runtime_removeSuffix_SS);
+  engine.addNativeFunction("indexOf_SS", &runtime_indexOf_SS);
+  engine.addNativeFunction("indexOf_SSI", &runtime_indexOf_SSI);
+  engine.addNativeFunction("lastIndexOf_SS", &runtime_lastIndexOf_SS);
+  engine.addNativeFunction("contains_SS", &runtime_contains_SS);
+  engine.addNativeFunction("count_SS", &runtime_count_SS);
+  engine.addNativeFunction("replace_SSS", &runtime_replace_SSS);
+  engine.addNativeFunction("replaceAll_SSS", &runtime_replaceAll_SSS);
   engine.addNativeFunction("toInt_S", &runtime_toInt_S);
   engine.addNativeFunction("toInt_SI", &runtime_toInt_SI);
   engine.addNativeFunction("toFloat_S", &runtime_toFloat_S);
+  engine.addNativeFunction("toDouble_S", &runtime_toDouble_S);
   engine.addNativeFunction("byteLength_S", &runtime_byteLength_S);
   engine.addNativeFunction("byte_SI", &runtime_byte_SI);
   engine.addNativeFunction("codepoint_SI", &runtime_codepoint_SI);
   engine.addNativeFunction("nextCodepoint_SI", &runtime_nextCodepoint_SI);
   engine.addNativeFunction("prevCodepoint_SI", &runtime_prevCodepoint_SI);
+  engine.addNativeFunction("codepointLength_S", &runtime_codepointLength_S);
+  engine.addNativeFunction("isAscii_S", &runtime_isAscii_S);
+  engine.addNativeFunction("isValidUTF8_S", &runtime_isValidUTF8_S);
   engine.addNativeFunction("substr_SII", &runtime_substr_SII);
   engine.addNativeFunction("codepointToString_I", &runtime_codepointToString_I);
   engine.addNativeFunction("codepointToLower_I", &runtime_codepointToLower_I);
@@ -558,19 +927,24 @@ void runtime_String_init(BytecodeEngine &engine) {
 int64_t stringByteLength(Cell &s) {
   void *sPtr = cellPtr(s);
   BytecodeEngine::failOnNilPtr(sPtr);
+  if (heapObjTypeTag(sPtr) == heapTypeTagStringSlice) {
+    return cellInt(((StringSlice *)sPtr)->length);
+  }
   return heapObjSize(sPtr);
 }
 
 uint8_t *stringData(Cell &s) {
   void *sPtr = cellPtr(s);
   BytecodeEngine::failOnNilPtr(sPtr);
+  if (heapObjTypeTag(sPtr) == heapTypeTagStringSlice) {
+    StringSlice *slice = (StringSlice *)sPtr;
+    return (uint8_t *)cellPtr(slice->parent) + 8 + cellInt(slice->offset);
+  }
   return (uint8_t *)sPtr + 8;
 }
 
 std::string stringToStdString(Cell &s) {
-  void *sPtr = cellPtr(s);
-  BytecodeEngine::failOnNilPtr(sPtr);
-  return std::string((char *)sPtr + 8, heapObjSize(sPtr));
+  return std::string((char *)stringData(s), stringByteLength(s));
 }
 
 Cell stringAlloc(int64_t length, BytecodeEngine &engine) {
@@ -584,25 +958,59 @@ Cell stringMake(const uint8_t *data, int64_t length, BytecodeEngine &engine) {
 }
 
 Cell stringMake(Cell &s, int64_t offset, int64_t length, BytecodeEngine &engine) {
-  uint8_t *out = (uint8_t *)engine.heapAllocBlob((uint64_t)length, 0);
-  memcpy(out + 8, stringData(s) + offset, length);
-  return cellMakeHeapPtr(out);
+  if (length < minStringSliceLength) {
+    uint8_t *out = (uint8_t *)engine.heapAllocBlob((uint64_t)length, 0);
+    memcpy(out + 8, stringData(s) + offset, length);
+    return cellMakeHeapPtr(out);
+  }
+
+  // NB: this may trigger GC
+  StringSlice *slice = (StringSlice *)engine.heapAllocTuple(stringSliceNCells,
+							   heapTypeTagStringSlice);
+
+  // a slice of a slice refers directly to the flat parent string
+  void *sPtr = cellPtr(s);
+  BytecodeEngine::failOnNilPtr(sPtr);
+  if (heapObjTypeTag(sPtr) == heapTypeTagStringSlice) {
+    StringSlice *sSlice = (StringSlice *)sPtr;
+    slice->parent = sSlice->parent;
+    offset += cellInt(sSlice->offset);
+    slice->owner = sSlice->owner;
+  } else {
+    slice->parent = s;
+    slice->owner = cellMakeNilResourcePtr();
+  }
+  slice->offset = cellMakeInt(offset);
+  slice->length = cellMakeInt(length);
+  return cellMakeHeapPtr(slice);
+}
+
+Cell stringMakeOwnedSlice(uint8_t *parent, ResourceObject *owner, BytecodeEngine &engine) {
+  // NB: this may trigger GC
+  StringSlice *slice = (StringSlice *)engine.heapAllocTuple(stringSliceNCells,
+							   heapTypeTagStringSlice);
+  slice->parent = cellMakeNonHeapPtr(parent);
+  slice->offset = cellMakeInt(0);
+  slice->length = cellMakeInt((int64_t)heapObjSize(parent));
+  slice->owner = cellMakeResourcePtr(owner);
+  return cellMakeHeapPtr(slice);
 }
 
 int64_t stringCompare(Cell &s1, Cell &s2) {
+  // identical string literals share a single copy, so this is a
+  // common case
+  if (s1 == s2) {
+    BytecodeEngine::failOnNilPtr(cellPtr(s1));
+    return 0;
+  }
   int64_t n1 = stringByteLength(s1);
   int64_t n2 = stringByteLength(s2);
   uint8_t *p1 = (uint8_t *)stringData(s1);
   uint8_t *p2 = (uint8_t *)stringData(s2);
   int64_t n = std::min(n1, n2);
-  for (int64_t i = 0; i < n; ++i) {
-    if (p1[i] < p2[i]) {
-      return -1;
-    }
-    if (p1[i] > p2[i]) {
-      return 1;
-      break;
-    }
+  int cmp = memcmp(p1, p2, n);
+  if (cmp != 0) {
+    return (cmp < 0) ? -1 : 1;
   }
   return (n1 < n2) ? -1 : (n1 > n2) ? 1 : 0;
 }
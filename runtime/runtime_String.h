@@ -39,12 +39,24 @@ extern Cell stringAlloc(int64_t length, BytecodeEngine &engine);
 extern Cell stringMake(const uint8_t *data, int64_t length, BytecodeEngine &engine);
 
 // Construct a string on the heap from bytes [offset] .. [offset] +
-// [length] - 1 of string [s]. Returns a pointer to the string object.
+// [length] - 1 of string [s]. Returns a pointer to the string
+// object. Long substrings are slices that share [s]'s bytes instead
+// of copying them.
 // NB: the caller is responsible for making the returned Cell visible
 // to the GC.
 // NB: this may trigger GC.
 extern Cell stringMake(Cell &s, int64_t offset, int64_t length, BytecodeEngine &engine);
 
+// Construct a slice covering all of the flat string at [parent],
+// which is not on the heap, and which stays valid until the resource
+// object [owner] is finalized. The GC keeps [owner] alive as long as
+// the slice (or any slice of it) is reachable.
+// NB: the caller is responsible for making the returned Cell visible
+// to the GC.
+// NB: this may trigger GC.
+extern Cell stringMakeOwnedSlice(uint8_t *parent, ResourceObject *owner,
+				 BytecodeEngine &engine);
+
 // Compare two strings and return +1/0/-1.
 extern int64_t stringCompare(Cell &s1, Cell &s2);
 
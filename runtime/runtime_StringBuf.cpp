@@ -7,31 +7,38 @@
 //
 //========================================================================
 
-// A StringBuf is implemented as a handle that points to a blob of
-// bytes.
+// A StringBuf is implemented as a tuple that points to a blob of
+// bytes, along with the used range of the blob and a flag that
+// indicates whether the blob is shared with any strings.
 //
-// +--------+---------+
-// | length | pointer |
-// +--------+---------+
-// handle        |
-//               v
-//          +------+-------+-------+-----+---------+------//------+
-//          | size | sb[0] | sb[1] | ... | sb[n-1] | unused space |
-//          +------+-------+-------+-----+---------+--------------+
-//          blob
+// +-----+------+-----+-------+--------+
+// | hdr | data | end | start | shared |
+// +-----+------+-----+-------+--------+
+// tuple   |
+//         v
+//       +------+------//------+-------+-----+---------+------//------+
+//       | size | consumed ... | sb[0] | ... | sb[n-1] | unused space |
+//       +------+------//------+-------+-----+---------+--------------+
+//       blob
 //
-// - The length field in the handle is the number of valid bytes in
-//   the StringBuf.
+// - The StringBuf contents are bytes start .. end-1 of the blob, so
+//   the StringBuf length is end-start.
+// - Bytes 0 .. start-1 of the blob have been consumed (see consume),
+//   and are reclaimed by compaction. If consume empties the
+//   StringBuf, start and end are reset to zero, so a buffer that is
+//   filled and drained repeatedly reuses its blob without
+//   compaction.
 // - The size field in the blob is the number of bytes in the blob,
 //   i.e., the StringBuf size (capacity).
-// - There are size-length unused bytes at the end of the blob.
+// - There are size-end unused bytes at the end of the blob.
+// - The blob has the same layout as a flat string, so strings can
+//   refer to it directly (see byteSlice and takeString). Once that
+//   happens, the shared flag is set, and bytes 0 .. end-1 are never
+//   modified again: anything that would overwrite them (clear,
+//   compact, etc.) switches to a new blob instead.
 //
-// As a special case, an empty StringBuf is a handle with a nil
-// pointer:
-//
-// +----------+-------------+
-// | length=0 | pointer=nil |
-// +----------+-------------+
+// As a special case, an empty StringBuf can have a nil data pointer
+// (with start=end=0).
 
 #include "runtime_StringBuf.h"
 #include <string.h>
@@ -43,11 +50,16 @@
 
 #define minStringBufSize 16
 
-struct StringBufHandle {
+struct StringBuf {
   uint64_t hdr;
   Cell dataPtr;
+  Cell end;
+  Cell start;
+  Cell shared;
 };
 
+#define stringBufNCells (sizeof(StringBuf) / sizeof(Cell) - 1)
+
 struct StringBufData {
   uint64_t hdr;
   uint8_t bytes[0];
@@ -55,17 +67,72 @@ struct StringBufData {
 
 //------------------------------------------------------------------------
 
-// Expand the StringBuf in [vCell] to fit [newLength] elements. This
-// may change the StringBuf's size (capacity), but will not change its
-// length; the caller is responsible for changing the StringBuf length
-// to [newLength]. This function may trigger GC.
+// Reallocate the data blob for the StringBuf in [sbCell] to hold
+// exactly [newSize] bytes, copying the existing contents to the
+// start of the new blob. [newSize] must be at least the StringBuf's
+// length. A [newSize] of zero frees the data blob. This function may
+// trigger GC.
+static void stringBufResize(Cell &sbCell, int64_t newSize, BytecodeEngine &engine) {
+  StringBuf *sb = (StringBuf *)cellPtr(sbCell);
+  engine.failOnNilPtr(sb);
+  if (newSize == 0) {
+    sb->dataPtr = cellMakeNilHeapPtr();
+    sb->end = cellMakeInt(0);
+    sb->start = cellMakeInt(0);
+    sb->shared = cellMakeBool(false);
+    return;
+  }
+
+  // NB: this may trigger GC
+  StringBufData *newData = (StringBufData *)engine.heapAllocBlob(newSize, 0);
+
+  sb = (StringBuf *)cellPtr(sbCell);
+  int64_t start = cellInt(sb->start);
+  int64_t length = cellInt(sb->end) - start;
+  if (length > 0) {
+    StringBufData *data = (StringBufData *)cellPtr(sb->dataPtr);
+    memcpy(newData->bytes, data->bytes + start, length);
+  }
+  sb->dataPtr = cellMakeHeapPtr(newData);
+  sb->end = cellMakeInt(length);
+  sb->start = cellMakeInt(0);
+  sb->shared = cellMakeBool(false);
+}
+
+// Move the contents of the StringBuf in [sbCell] to the start of its
+// blob, reclaiming the consumed space. The blob must not be shared.
+static void stringBufCompactInPlace(StringBuf *sb) {
+  int64_t start = cellInt(sb->start);
+  if (start == 0) {
+    return;
+  }
+  int64_t length = cellInt(sb->end) - start;
+  StringBufData *data = (StringBufData *)cellPtr(sb->dataPtr);
+  memmove(data->bytes, data->bytes + start, length);
+  sb->end = cellMakeInt(length);
+  sb->start = cellMakeInt(0);
+}
+
+// Expand the StringBuf in [sbCell] to fit [newLength] bytes. This
+// may change the StringBuf's size (capacity) or move its contents to
+// the start of the blob, but will not change its length; the caller
+// is responsible for changing the StringBuf end to start +
+// [newLength]. This function may trigger GC.
 static void stringBufExpand(Cell &sbCell, int64_t newLength, BytecodeEngine &engine) {
-  StringBufHandle *sb = (StringBufHandle *)cellPtr(sbCell);
+  StringBuf *sb = (StringBuf *)cellPtr(sbCell);
   engine.failOnNilPtr(sb);
   StringBufData *data = (StringBufData *)cellPtr(sb->dataPtr);
-  int64_t length = heapObjSize(sb);
   int64_t size = data ? heapObjSize(data) : 0;
-  if (newLength <= size) {
+  int64_t start = cellInt(sb->start);
+  if (newLength <= size - start) {
+    return;
+  }
+
+  // if there's enough consumed space, reclaim it instead of growing
+  // -- this leaves at least a quarter of the blob free, so the cost
+  // of the memmove is amortized over the following appends
+  if (!cellBool(sb->shared) && newLength <= size - size / 4) {
+    stringBufCompactInPlace(sb);
     return;
   }
 
@@ -78,14 +145,7 @@ static void stringBufExpand(Cell &sbCell, int64_t newLength, BytecodeEngine &eng
   }
 
   // NB: this may trigger GC
-  StringBufData *newData = (StringBufData *)engine.heapAllocBlob(newSize, 0);
-
-  sb = (StringBufHandle *)cellPtr(sbCell);
-  if (length > 0) {
-    data = (StringBufData *)cellPtr(sb->dataPtr);
-    memcpy(newData->bytes, data->bytes, length);
-  }
-  sb->dataPtr = cellMakeHeapPtr(newData);
+  stringBufResize(sbCell, newSize, engine);
 }
 
 // Shrink the StringBuf in [sbCell] to fit its length. If the
@@ -93,10 +153,10 @@ static void stringBufExpand(Cell &sbCell, int64_t newLength, BytecodeEngine &eng
 // the size will be reduced. This will not change the StringBuf's
 // length.  This function may trigger GC.
 static void stringBufShrink(Cell &sbCell, BytecodeEngine &engine) {
-  StringBufHandle *sb = (StringBufHandle *)cellPtr(sbCell);
+  StringBuf *sb = (StringBuf *)cellPtr(sbCell);
   engine.failOnNilPtr(sb);
   StringBufData *data = (StringBufData *)cellPtr(sb->dataPtr);
-  int64_t length = heapObjSize(sb);
+  int64_t length = cellInt(sb->end) - cellInt(sb->start);
   int64_t size = data ? heapObjSize(data) : 0;
   if (size <= minStringBufSize || size / 4 < length) {
     return;
@@ -108,25 +168,52 @@ static void stringBufShrink(Cell &sbCell, BytecodeEngine &engine) {
   } while (newSize / 4 >= length && newSize > minStringBufSize);
 
   // NB: this may trigger GC
-  StringBufData *newData = (StringBufData *)engine.heapAllocBlob(newSize, 0);
+  stringBufResize(sbCell, newSize, engine);
+}
 
-  sb = (StringBufHandle *)cellPtr(sbCell);
-  if (length > 0) {
-    data = (StringBufData *)cellPtr(sb->dataPtr);
-    memcpy(newData->bytes, data->bytes, length);
+// Empty the StringBuf [sb]. If its blob is shared, it's dropped;
+// otherwise it's kept for reuse.
+static void stringBufReset(StringBuf *sb) {
+  if (cellBool(sb->shared)) {
+    sb->dataPtr = cellMakeNilHeapPtr();
+    sb->shared = cellMakeBool(false);
   }
-  sb->dataPtr = cellMakeHeapPtr(newData);
+  sb->end = cellMakeInt(0);
+  sb->start = cellMakeInt(0);
 }
 
+// _allocStringBuf()
+// _allocStringBuf(capacity: Int)
 static NativeFuncDefn(runtime_allocStringBuf) {
 #if CHECK_RUNTIME_FUNC_ARGS
-  if (engine.nArgs() != 0) {
+  if (engine.nArgs() > 1 ||
+      (engine.nArgs() == 1 && !cellIsInt(engine.arg(0)))) {
     BytecodeEngine::fatalError("Invalid argument");
   }
 #endif
-  StringBufHandle *sb = (StringBufHandle *)engine.heapAllocHandle(0, 0);
+  int64_t capacity = 0;
+  if (engine.nArgs() == 1) {
+    capacity = cellInt(engine.arg(0));
+    if (capacity < 0) {
+      BytecodeEngine::fatalError("Invalid argument");
+    }
+  }
+
+  StringBuf *sb = (StringBuf *)engine.heapAllocTuple(stringBufNCells, 0);
   sb->dataPtr = cellMakeNilHeapPtr();
-  engine.push(cellMakeHeapPtr(sb));
+  sb->end = cellMakeInt(0);
+  sb->start = cellMakeInt(0);
+  sb->shared = cellMakeBool(false);
+  Cell sbCell = cellMakeHeapPtr(sb);
+
+  if (capacity > 0) {
+    engine.pushGCRoot(sbCell);
+    // NB: this may trigger GC
+    stringBufResize(sbCell, capacity, engine);
+    engine.popGCRoot(sbCell);
+  }
+
+  engine.push(sbCell);
 }
 
 // appendCodepoint(sb: StringBuf, codepoint: Int)
@@ -185,12 +272,8 @@ static NativeFuncDefn(runtime_append_TT) {
   // can't use stringBufAppend here, because GC can invalidate the
   // StringBuf data pointer
 
-  StringBufHandle *sb = (StringBufHandle *)cellPtr(sbCell);
-  engine.failOnNilPtr(sb);
-  int64_t sbLength = heapObjSize(sb);
-  StringBufHandle *other = (StringBufHandle *)cellPtr(otherCell);
-  engine.failOnNilPtr(sb);
-  int64_t otherLength = heapObjSize(other);
+  int64_t sbLength = stringBufLength(sbCell);
+  int64_t otherLength = stringBufLength(otherCell);
   if (sbLength > bytecodeMaxInt - otherLength) {
     BytecodeEngine::fatalError("Invalid argument");
   }
@@ -198,12 +281,15 @@ static NativeFuncDefn(runtime_append_TT) {
   // NB: this may trigger GC
   stringBufExpand(sbCell, sbLength + otherLength, engine);
 
-  sb = (StringBufHandle *)cellPtr(sbCell);
+  // [other] may be the same StringBuf as [sb], so its data pointer is
+  // fetched after the expansion
+  StringBuf *sb = (StringBuf *)cellPtr(sbCell);
   StringBufData *sbData = (StringBufData *)cellPtr(sb->dataPtr);
-  other = (StringBufHandle *)cellPtr(otherCell);
-  StringBufData *otherData = (StringBufData *)cellPtr(other->dataPtr);
-  memcpy(sbData->bytes + sbLength, otherData->bytes, otherLength);
-  heapObjSetSize(sb, sbLength + otherLength);
+  int64_t sbEnd = cellInt(sb->end);
+  if (otherLength > 0) {
+    memcpy(sbData->bytes + sbEnd, stringBufData(otherCell), otherLength);
+  }
+  sb->end = cellMakeInt(sbEnd + otherLength);
   engine.push(cellMakeInt(0));
 }
 
@@ -219,14 +305,6 @@ static NativeFuncDefn(runtime_appendByte_TI) {
   Cell &sbCell = engine.arg(0);
   Cell &bCell = engine.arg(1);
 
-  StringBufHandle *sb = (StringBufHandle *)cellPtr(sbCell);
-  engine.failOnNilPtr(sb);
-  int64_t sbLength = heapObjSize(sb);
-  engine.failOnNilPtr(sb);
-  if (sbLength > bytecodeMaxInt - 1) {
-    BytecodeEngine::fatalError("Invalid argument");
-  }
-
   // NB: this may trigger GC
   stringBufAppendByte(sbCell, cellInt(bCell), engine);
 
@@ -243,9 +321,9 @@ static NativeFuncDefn(runtime_clear_T) {
 #endif
   Cell &sbCell = engine.arg(0);
 
-  StringBufHandle *sb = (StringBufHandle *)cellPtr(sbCell);
+  StringBuf *sb = (StringBuf *)cellPtr(sbCell);
   engine.failOnNilPtr(sb);
-  heapObjSetSize(sb, 0);
+  stringBufReset(sb);
 
   // NB: this may trigger GC
   stringBufShrink(sbCell, engine);
@@ -253,6 +331,78 @@ static NativeFuncDefn(runtime_clear_T) {
   engine.push(cellMakeInt(0));
 }
 
+// capacity(sb: StringBuf) -> Int
+static NativeFuncDefn(runtime_capacity_T) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &sbCell = engine.arg(0);
+
+  StringBuf *sb = (StringBuf *)cellPtr(sbCell);
+  engine.failOnNilPtr(sb);
+  StringBufData *data = (StringBufData *)cellPtr(sb->dataPtr);
+  int64_t size = data ? heapObjSize(data) : 0;
+
+  engine.push(cellMakeInt(size));
+}
+
+// reserve(sb: StringBuf, n: Int)
+static NativeFuncDefn(runtime_reserve_TI) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsInt(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &sbCell = engine.arg(0);
+  Cell &nCell = engine.arg(1);
+
+  StringBuf *sb = (StringBuf *)cellPtr(sbCell);
+  engine.failOnNilPtr(sb);
+  StringBufData *data = (StringBufData *)cellPtr(sb->dataPtr);
+  int64_t size = data ? heapObjSize(data) : 0;
+  int64_t n = cellInt(nCell);
+  if (n < 0) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+
+  // unlike stringBufExpand, this allocates exactly the requested size
+  if (n > size) {
+    // NB: this may trigger GC
+    stringBufResize(sbCell, n, engine);
+  }
+
+  engine.push(cellMakeInt(0));
+}
+
+// shrinkToFit(sb: StringBuf)
+static NativeFuncDefn(runtime_shrinkToFit_T) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &sbCell = engine.arg(0);
+
+  StringBuf *sb = (StringBuf *)cellPtr(sbCell);
+  engine.failOnNilPtr(sb);
+  StringBufData *data = (StringBufData *)cellPtr(sb->dataPtr);
+  int64_t length = cellInt(sb->end) - cellInt(sb->start);
+  int64_t size = data ? heapObjSize(data) : 0;
+
+  if (size > length) {
+    // NB: this may trigger GC
+    stringBufResize(sbCell, length, engine);
+  }
+
+  engine.push(cellMakeInt(0));
+}
+
 // toString(sb: StringBuf) -> String
 static NativeFuncDefn(runtime_toString_T) {
 #if CHECK_RUNTIME_FUNC_ARGS
@@ -263,21 +413,120 @@ static NativeFuncDefn(runtime_toString_T) {
 #endif
   Cell &sbCell = engine.arg(0);
 
-  StringBufHandle *sb = (StringBufHandle *)cellPtr(sbCell);
-  engine.failOnNilPtr(sb);
-  int64_t sbLength = heapObjSize(sb);
+  int64_t sbLength = stringBufLength(sbCell);
 
   // NB: this may trigger GC
   Cell s = stringAlloc(sbLength, engine);
 
-  sb = (StringBufHandle *)cellPtr(sbCell);
-  StringBufData *data = (StringBufData *)cellPtr(sb->dataPtr);
-  memcpy(stringData(s), data->bytes, sbLength);
+  if (sbLength > 0) {
+    memcpy(stringData(s), stringBufData(sbCell), sbLength);
+  }
   engine.push(s);
 }
 
-// byteLength(sb: StringBuf) -> Int
-static NativeFuncDefn(runtime_byteLength_T) {
+// takeString(sb: StringBuf) -> String
+// Returns the contents of [sb] as a String, and empties [sb]. If
+// possible, the String takes over [sb]'s blob instead of copying it.
+static NativeFuncDefn(runtime_takeString_T) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &sbCell = engine.arg(0);
+
+  StringBuf *sb = (StringBuf *)cellPtr(sbCell);
+  engine.failOnNilPtr(sb);
+  int64_t start = cellInt(sb->start);
+  int64_t end = cellInt(sb->end);
+
+  // the contents are at the start of the blob: truncate the blob to
+  // the contents, which turns it into a flat string -- the GC finds
+  // object sizes by following pointers (it never walks the old heap),
+  // so the words past the new size are simply dropped at the next GC
+  if (start == 0 && end > 0) {
+    Cell sCell = sb->dataPtr;
+    heapObjSetSize(cellPtr(sCell), end);
+    sb->dataPtr = cellMakeNilHeapPtr();
+    sb->end = cellMakeInt(0);
+    sb->shared = cellMakeBool(false);
+    engine.push(sCell);
+    return;
+  }
+
+  // NB: this may trigger GC
+  Cell sCell = stringBufSlice(sbCell, 0, end - start, engine);
+
+  sb = (StringBuf *)cellPtr(sbCell);
+  stringBufReset(sb);
+  engine.push(sCell);
+}
+
+// byteSlice(sb: StringBuf, offset: Int, length: Int) -> String
+// Returns bytes [offset] .. [offset] + [length] - 1 of [sb]. Long
+// slices share [sb]'s blob instead of copying it.
+static NativeFuncDefn(runtime_byteSlice_TII) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 3 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsInt(engine.arg(1)) ||
+      !cellIsInt(engine.arg(2))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &sbCell = engine.arg(0);
+  Cell &offsetCell = engine.arg(1);
+  Cell &lengthCell = engine.arg(2);
+
+  int64_t sbLength = stringBufLength(sbCell);
+  int64_t offset = cellInt(offsetCell);
+  int64_t length = cellInt(lengthCell);
+  if (offset < 0 || offset > sbLength ||
+      length < 0 || length > sbLength - offset) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+
+  // NB: this may trigger GC
+  engine.push(stringBufSlice(sbCell, offset, length, engine));
+}
+
+// consume(sb: StringBuf, n: Int)
+// Removes the first [n] bytes from [sb]. This doesn't move the
+// remaining bytes (see compact).
+static NativeFuncDefn(runtime_consume_TI) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsInt(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &sbCell = engine.arg(0);
+  Cell &nCell = engine.arg(1);
+
+  StringBuf *sb = (StringBuf *)cellPtr(sbCell);
+  engine.failOnNilPtr(sb);
+  int64_t start = cellInt(sb->start);
+  int64_t end = cellInt(sb->end);
+  int64_t n = cellInt(nCell);
+  if (n < 0 || n > end - start) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+
+  if (start + n == end) {
+    stringBufReset(sb);
+  } else {
+    sb->start = cellMakeInt(start + n);
+  }
+
+  engine.push(cellMakeInt(0));
+}
+
+// compact(sb: StringBuf)
+// Moves the contents of [sb] to the start of its buffer, reclaiming
+// the space used by consumed bytes.
+static NativeFuncDefn(runtime_compact_T) {
 #if CHECK_RUNTIME_FUNC_ARGS
   if (engine.nArgs() != 1 ||
       !cellIsPtr(engine.arg(0))) {
@@ -286,11 +535,32 @@ static NativeFuncDefn(runtime_byteLength_T) {
 #endif
   Cell &sbCell = engine.arg(0);
 
-  StringBufHandle *sb = (StringBufHandle *)cellPtr(sbCell);
+  StringBuf *sb = (StringBuf *)cellPtr(sbCell);
   engine.failOnNilPtr(sb);
-  int64_t length = heapObjSize(sb);
+  if (cellInt(sb->start) > 0) {
+    if (cellBool(sb->shared)) {
+      StringBufData *data = (StringBufData *)cellPtr(sb->dataPtr);
+      // NB: this may trigger GC
+      stringBufResize(sbCell, heapObjSize(data), engine);
+    } else {
+      stringBufCompactInPlace(sb);
+    }
+  }
 
-  engine.push(cellMakeInt(length));
+  engine.push(cellMakeInt(0));
+}
+
+// byteLength(sb: StringBuf) -> Int
+static NativeFuncDefn(runtime_byteLength_T) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &sbCell = engine.arg(0);
+
+  engine.push(cellMakeInt(stringBufLength(sbCell)));
 }
 
 static NativeFuncDefn(runtime_byte_TI) {
@@ -304,16 +574,12 @@ static NativeFuncDefn(runtime_byte_TI) {
   Cell &sbCell = engine.arg(0);
   Cell &idxCell = engine.arg(1);
 
-  StringBufHandle *sb = (StringBufHandle *)cellPtr(sbCell);
-  engine.failOnNilPtr(sb);
   int64_t idx = cellInt(idxCell);
-
-  int64_t length = heapObjSize(sb);
+  int64_t length = stringBufLength(sbCell);
   if (idx < 0 || idx >= length) {
     BytecodeEngine::fatalError("Index out of bounds");
   }
-  StringBufData *data = (StringBufData *)cellPtr(sb->dataPtr);
-  engine.push(cellMakeInt(data->bytes[idx]));
+  engine.push(cellMakeInt(stringBufData(sbCell)[idx]));
 }
 
 //------------------------------------------------------------------------
@@ -325,7 +591,14 @@ void runtime_StringBuf_init(BytecodeEngine &engine) {
   engine.addNativeFunction("append_TT", &runtime_append_TT);
   engine.addNativeFunction("appendByte_TI", &runtime_appendByte_TI);
   engine.addNativeFunction("clear_T", &runtime_clear_T);
+  engine.addNativeFunction("capacity_T", &runtime_capacity_T);
+  engine.addNativeFunction("reserve_TI", &runtime_reserve_TI);
+  engine.addNativeFunction("shrinkToFit_T", &runtime_shrinkToFit_T);
   engine.addNativeFunction("toString_T", &runtime_toString_T);
+  engine.addNativeFunction("takeString_T", &runtime_takeString_T);
+  engine.addNativeFunction("byteSlice_TII", &runtime_byteSlice_TII);
+  engine.addNativeFunction("consume_TI", &runtime_consume_TI);
+  engine.addNativeFunction("compact_T", &runtime_compact_T);
   engine.addNativeFunction("byteLength_T", &runtime_byteLength_T);
   engine.addNativeFunction("byte_TI", &runtime_byte_TI);
 }
@@ -335,22 +608,45 @@ void runtime_StringBuf_init(BytecodeEngine &engine) {
 //------------------------------------------------------------------------
 
 int64_t stringBufLength(Cell &sbCell) {
-  StringBufHandle *sb = (StringBufHandle *)cellPtr(sbCell);
+  StringBuf *sb = (StringBuf *)cellPtr(sbCell);
   BytecodeEngine::failOnNilPtr(sb);
-  return heapObjSize(sb);
+  return cellInt(sb->end) - cellInt(sb->start);
 }
 
 uint8_t *stringBufData(Cell &sbCell) {
-  StringBufHandle *sb = (StringBufHandle *)cellPtr(sbCell);
+  StringBuf *sb = (StringBuf *)cellPtr(sbCell);
   BytecodeEngine::failOnNilPtr(sb);
   StringBufData *sbData = (StringBufData *)cellPtr(sb->dataPtr);
-  return sbData->bytes;
+  return sbData->bytes + cellInt(sb->start);
 }
 
-void stringBufAppend(Cell &sbCell, uint8_t *buf, int64_t n, BytecodeEngine &engine) {
-  StringBufHandle *sb = (StringBufHandle *)cellPtr(sbCell);
+Cell stringBufSlice(Cell &sbCell, int64_t offset, int64_t length, BytecodeEngine &engine) {
+  StringBuf *sb = (StringBuf *)cellPtr(sbCell);
   engine.failOnNilPtr(sb);
-  int64_t length = heapObjSize(sb);
+  if (length == 0) {
+    // NB: this may trigger GC
+    return stringAlloc(0, engine);
+  }
+
+  // the blob has the same layout as a flat string, so it can be
+  // passed to stringMake as the parent of a slice
+  Cell dataCell = sb->dataPtr;
+  engine.pushGCRoot(dataCell);
+  // NB: this may trigger GC
+  Cell sCell = stringMake(dataCell, cellInt(sb->start) + offset, length, engine);
+  engine.popGCRoot(dataCell);
+
+  // stringMake copies short substrings -- if it made a slice, the
+  // blob is now shared
+  if (heapObjTypeTag(cellPtr(sCell)) == heapTypeTagStringSlice) {
+    sb = (StringBuf *)cellPtr(sbCell);
+    sb->shared = cellMakeBool(true);
+  }
+  return sCell;
+}
+
+void stringBufAppend(Cell &sbCell, uint8_t *buf, int64_t n, BytecodeEngine &engine) {
+  int64_t length = stringBufLength(sbCell);
   if (n > bytecodeMaxInt - length) {
     BytecodeEngine::fatalError("Integer overflow");
   }
@@ -358,16 +654,15 @@ void stringBufAppend(Cell &sbCell, uint8_t *buf, int64_t n, BytecodeEngine &engi
   // NB: this may trigger GC
   stringBufExpand(sbCell, length + n, engine);
 
-  sb = (StringBufHandle *)cellPtr(sbCell);
+  StringBuf *sb = (StringBuf *)cellPtr(sbCell);
   StringBufData *data = (StringBufData *)cellPtr(sb->dataPtr);
-  memcpy(data->bytes + length, buf, n);
-  heapObjSetSize(sb, length + n);
+  int64_t end = cellInt(sb->end);
+  memcpy(data->bytes + end, buf, n);
+  sb->end = cellMakeInt(end + n);
 }
 
 void stringBufAppendString(Cell &sbCell, Cell &sCell, BytecodeEngine &engine) {
-  StringBufHandle *sb = (StringBufHandle *)cellPtr(sbCell);
-  engine.failOnNilPtr(sb);
-  int64_t sbLength = heapObjSize(sb);
+  int64_t sbLength = stringBufLength(sbCell);
   int64_t sLength = stringByteLength(sCell);
   if (sbLength > bytecodeMaxInt - sLength) {
     BytecodeEngine::fatalError("Integer overflow");
@@ -376,16 +671,15 @@ void stringBufAppendString(Cell &sbCell, Cell &sCell, BytecodeEngine &engine) {
   // NB: this may trigger GC
   stringBufExpand(sbCell, sbLength + sLength, engine);
 
-  sb = (StringBufHandle *)cellPtr(sbCell);
+  StringBuf *sb = (StringBuf *)cellPtr(sbCell);
   StringBufData *data = (StringBufData *)cellPtr(sb->dataPtr);
-  memcpy(data->bytes + sbLength, stringData(sCell), sLength);
-  heapObjSetSize(sb, sbLength + sLength);
+  int64_t end = cellInt(sb->end);
+  memcpy(data->bytes + end, stringData(sCell), sLength);
+  sb->end = cellMakeInt(end + sLength);
 }
 
 void stringBufAppendByte(Cell &sbCell, int64_t b, BytecodeEngine &engine) {
-  StringBufHandle *sb = (StringBufHandle *)cellPtr(sbCell);
-  engine.failOnNilPtr(sb);
-  int64_t sbLength = heapObjSize(sb);
+  int64_t sbLength = stringBufLength(sbCell);
   if (sbLength > bytecodeMaxInt - 1) {
     BytecodeEngine::fatalError("Integer overflow");
   }
@@ -393,8 +687,9 @@ void stringBufAppendByte(Cell &sbCell, int64_t b, BytecodeEngine &engine) {
   // NB: this may trigger GC
   stringBufExpand(sbCell, sbLength + 1, engine);
 
-  sb = (StringBufHandle *)cellPtr(sbCell);
+  StringBuf *sb = (StringBuf *)cellPtr(sbCell);
   StringBufData *data = (StringBufData *)cellPtr(sb->dataPtr);
-  data->bytes[sbLength] = (uint8_t)b;
-  heapObjSetSize(sb, sbLength + 1);
+  int64_t end = cellInt(sb->end);
+  data->bytes[end] = (uint8_t)b;
+  sb->end = cellMakeInt(end + 1);
 }
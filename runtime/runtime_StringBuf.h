@@ -21,6 +21,15 @@ extern int64_t stringBufLength(Cell &sbCell);
 // invalidated by anything that can trigger GC.
 extern uint8_t *stringBufData(Cell &sbCell);
 
+// Construct a string from bytes [offset] .. [offset] + [length] - 1
+// of [sbCell]. Long substrings are slices that share [sbCell]'s data
+// blob instead of copying it. [offset] and [length] must be in
+// bounds.
+// NB: the caller is responsible for making the returned Cell visible
+// to the GC.
+// NB: this may trigger GC.
+extern Cell stringBufSlice(Cell &sbCell, int64_t offset, int64_t length, BytecodeEngine &engine);
+
 // Append [n] bytes at [buf] to [sbCell].
 // NB: this may trigger GC.
 extern void stringBufAppend(Cell &sbCell, uint8_t *buf, int64_t n, BytecodeEngine &engine);
@@ -31,11 +31,23 @@
 // +----------+-------------+
 // | length=0 | pointer=nil |
 // +----------+-------------+
+//
+// Vectors of primitive types (Vector[Int], Vector[Float], and
+// Vector[Bool]) use a blob instead of a tuple, containing raw
+// (untagged) values: int64_t, float, and uint8_t, respectively. The
+// size field in the blob is the number of bytes, i.e., the element
+// size * the vector size (capacity). The compiler calls separate
+// functions for these (e.g., _allocVectorI instead of _allocVector,
+// and get_VI2 instead of get_V2).
 
 #include "runtime_Vector.h"
+#include <math.h>
 #include <string.h>
 #include <algorithm>
+#include <vector>
 #include "BytecodeDefs.h"
+#include "runtime_String.h"
+#include "ThreadPool.h"
 
 //------------------------------------------------------------------------
 
@@ -52,6 +64,9 @@ struct VectorData {
 };
 #define bytesPerElement 8
 
+// Chunk size for the parallel kernels.
+#define parallelChunkSize 65536
+
 //------------------------------------------------------------------------
 
 class VectorIter {
@@ -148,6 +163,30 @@ public:
 
 //------------------------------------------------------------------------
 
+// Reallocate the data tuple for the vector in [vCell] to hold exactly
+// [newSize] elements, copying the existing elements. [newSize] must
+// be at least the vector's length. A [newSize] of zero frees the data
+// tuple. This function may trigger GC.
+static void vectorResize(Cell &vCell, int64_t newSize, BytecodeEngine &engine) {
+  VectorHandle *v = (VectorHandle *)cellPtr(vCell);
+  engine.failOnNilPtr(v);
+  int64_t length = heapObjSize(v);
+  if (newSize == 0) {
+    v->dataPtr = cellMakeNilHeapPtr();
+    return;
+  }
+
+  // NB: this may trigger GC
+  VectorData *newData = (VectorData *)engine.heapAllocTuple(newSize, 0);
+
+  v = (VectorHandle *)cellPtr(vCell);
+  if (length > 0) {
+    VectorData *data = (VectorData *)cellPtr(v->dataPtr);
+    memcpy(newData->elems, data->elems, length * bytesPerElement);
+  }
+  v->dataPtr = cellMakeHeapPtr(newData);
+}
+
 // Expand the vector in [vCell] to fit [newLength] elements. This may
 // change the vector's size (capacity), but will not change its
 // length; the caller is responsible for changing the vector length to
@@ -156,7 +195,6 @@ static void vectorExpand(Cell &vCell, int64_t newLength, BytecodeEngine &engine)
   VectorHandle *v = (VectorHandle *)cellPtr(vCell);
   engine.failOnNilPtr(v);
   VectorData *data = (VectorData *)cellPtr(v->dataPtr);
-  int64_t length = heapObjSize(v);
   int64_t size = data ? heapObjSize(data) / bytesPerElement : 0;
   if (newLength <= size) {
     return;
@@ -171,14 +209,7 @@ static void vectorExpand(Cell &vCell, int64_t newLength, BytecodeEngine &engine)
   }
 
   // NB: this may trigger GC
-  VectorData *newData = (VectorData *)engine.heapAllocTuple(newSize, 0);
-
-  v = (VectorHandle *)cellPtr(vCell);
-  if (length > 0) {
-    data = (VectorData *)cellPtr(v->dataPtr);
-    memcpy(newData->elems, data->elems, length * bytesPerElement);
-  }
-  v->dataPtr = cellMakeHeapPtr(newData);
+  vectorResize(vCell, newSize, engine);
 }
 
 // Shrink the vector in [vCell] to fit its length. If the vector's
@@ -201,23 +232,37 @@ static void vectorShrink(Cell &vCell, BytecodeEngine &engine) {
   } while (newSize / 4 >= length && newSize > minVectorSize);
 
   // NB: this may trigger GC
-  VectorData *newData = (VectorData *)engine.heapAllocTuple(newSize, 0);
-
-  v = (VectorHandle *)cellPtr(vCell);
-  if (length > 0) {
-    data = (VectorData *)cellPtr(v->dataPtr);
-    memcpy(newData->elems, data->elems, length * bytesPerElement);
-  }
-  v->dataPtr = cellMakeHeapPtr(newData);
+  vectorResize(vCell, newSize, engine);
 }
 
+// _allocVector()
+// _allocVector(capacity: Int)
 static NativeFuncDefn(runtime_allocVector) {
 #if CHECK_RUNTIME_FUNC_ARGS
-  if (engine.nArgs() != 0) {
+  if (engine.nArgs() > 1 ||
+      (engine.nArgs() == 1 && !cellIsInt(engine.arg(0)))) {
     BytecodeEngine::fatalError("Invalid argument");
   }
 #endif
-  engine.push(vectorMake(engine));
+  int64_t capacity = 0;
+  if (engine.nArgs() == 1) {
+    capacity = cellInt(engine.arg(0));
+    if (capacity < 0) {
+      BytecodeEngine::fatalError("Invalid argument");
+    }
+  }
+
+  // NB: this may trigger GC
+  Cell vCell = vectorMake(engine);
+
+  if (capacity > 0) {
+    engine.pushGCRoot(vCell);
+    // NB: this may trigger GC
+    vectorResize(vCell, capacity, engine);
+    engine.popGCRoot(vCell);
+  }
+
+  engine.push(vCell);
 }
 
 // length(v: Vector[$T]) -> Int
@@ -405,7 +450,7 @@ static NativeFuncDefn(runtime_delete_V3) {
 
   VectorData *data = (VectorData *)cellPtr(v->dataPtr);
   if (n < length - idx) {
-    memmove(&data->elems[idx], &data->elems[idx+n], (length - idx) * bytesPerElement);
+    memmove(&data->elems[idx], &data->elems[idx+n], (length - idx - n) * bytesPerElement);
   }
   heapObjSetSize(v, length - n);
 
@@ -433,6 +478,78 @@ static NativeFuncDefn(runtime_clear_V1) {
   engine.push(cellMakeInt(0));
 }
 
+// capacity(v: Vector[$T]) -> Int
+static NativeFuncDefn(runtime_capacity_V1) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &vCell = engine.arg(0);
+
+  VectorHandle *v = (VectorHandle *)cellPtr(vCell);
+  engine.failOnNilPtr(v);
+  VectorData *data = (VectorData *)cellPtr(v->dataPtr);
+  int64_t size = data ? heapObjSize(data) / bytesPerElement : 0;
+
+  engine.push(cellMakeInt(size));
+}
+
+// reserve(v: Vector[$T], n: Int)
+static NativeFuncDefn(runtime_reserve_V2) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsInt(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &vCell = engine.arg(0);
+  Cell &nCell = engine.arg(1);
+
+  VectorHandle *v = (VectorHandle *)cellPtr(vCell);
+  engine.failOnNilPtr(v);
+  VectorData *data = (VectorData *)cellPtr(v->dataPtr);
+  int64_t size = data ? heapObjSize(data) / bytesPerElement : 0;
+  int64_t n = cellInt(nCell);
+  if (n < 0) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+
+  // unlike vectorExpand, this allocates exactly the requested size
+  if (n > size) {
+    // NB: this may trigger GC
+    vectorResize(vCell, n, engine);
+  }
+
+  engine.push(cellMakeInt(0));
+}
+
+// shrinkToFit(v: Vector[$T])
+static NativeFuncDefn(runtime_shrinkToFit_V1) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &vCell = engine.arg(0);
+
+  VectorHandle *v = (VectorHandle *)cellPtr(vCell);
+  engine.failOnNilPtr(v);
+  VectorData *data = (VectorData *)cellPtr(v->dataPtr);
+  int64_t length = heapObjSize(v);
+  int64_t size = data ? heapObjSize(data) / bytesPerElement : 0;
+
+  if (size > length) {
+    // NB: this may trigger GC
+    vectorResize(vCell, length, engine);
+  }
+
+  engine.push(cellMakeInt(0));
+}
+
 // sort(v: Vector[$T], cmp: Func[$T,$T->Bool])
 static NativeFuncDefn(runtime_sort_V2) {
 #if CHECK_RUNTIME_FUNC_ARGS
@@ -511,31 +628,1117 @@ static NativeFuncDefn(runtime_inext_V2) {
   engine.push(cellMakeInt(idx < length ? idx + 1 : idx));
 }
 
-void runtime_Vector_init(BytecodeEngine &engine) {
-  engine.addNativeFunction("_allocVector", &runtime_allocVector);
-  engine.addNativeFunction("length_V1", &runtime_length_V1);
-  engine.addNativeFunction("get_V2", &runtime_get_V2);
-  engine.addNativeFunction("set_V3", &runtime_set_V3);
-  engine.addNativeFunction("append_V2", &runtime_append_V2);
-  engine.addNativeFunction("insert_V3", &runtime_insert_V3);
-  engine.addNativeFunction("delete_V2", &runtime_delete_V2);
-  engine.addNativeFunction("delete_V3", &runtime_delete_V3);
-  engine.addNativeFunction("clear_V1", &runtime_clear_V1);
-  engine.addNativeFunction("sort_V2", &runtime_sort_V2);
-  engine.addNativeFunction("ifirst_V1", &runtime_ifirst_V1);
-  engine.addNativeFunction("imore_V2", &runtime_imore_V2);
-  engine.addNativeFunction("inext_V2", &runtime_inext_V2);
-  engine.addNativeFunction("iget_V2", &runtime_get_V2);
-}
-
 //------------------------------------------------------------------------
-// support functions
+// primitive vectors
 //------------------------------------------------------------------------
 
-Cell vectorMake(BytecodeEngine &engine) {
-  VectorHandle *v = (VectorHandle *)engine.heapAllocHandle(0, 0);
-  v->dataPtr = cellMakeNilHeapPtr();
-  return cellMakeHeapPtr(v);
+// Vector[Int], Vector[Float], and Vector[Bool] store raw values in a
+// blob (so the GC doesn't need to scan them). Each of these structs
+// describes one element type: the raw storage type, and conversions
+// to/from cells.
+
+struct IntElem {
+  typedef int64_t Raw;
+  static bool check(Cell cell) { return cellIsInt(cell); }
+  static Raw fromCell(Cell cell) { return cellInt(cell); }
+  static Cell toCell(Raw x) { return cellMakeInt(x); }
+};
+
+struct FloatElem {
+  typedef float Raw;
+  static bool check(Cell cell) { return cellIsFloat(cell); }
+  static Raw fromCell(Cell cell) { return cellFloat(cell); }
+  static Cell toCell(Raw x) { return cellMakeFloat(x); }
+};
+
+struct BoolElem {
+  typedef uint8_t Raw;
+  static bool check(Cell cell) { return cellIsBool(cell); }
+  static Raw fromCell(Cell cell) { return cellBool(cell) ? 1 : 0; }
+  static Cell toCell(Raw x) { return cellMakeBool(x != 0); }
+};
+
+// Return a pointer to the raw element array for a primitive vector,
+// or nullptr if the vector has no data blob.
+template<class Elem>
+static typename Elem::Raw *primVectorElems(VectorHandle *v) {
+  VectorData *data = (VectorData *)cellPtr(v->dataPtr);
+  return data ? (typename Elem::Raw *)&data->elems[0] : nullptr;
+}
+
+// Return the size (capacity) of a primitive vector.
+template<class Elem>
+static int64_t primVectorSize(VectorHandle *v) {
+  VectorData *data = (VectorData *)cellPtr(v->dataPtr);
+  return data ? heapObjSize(data) / (int64_t)sizeof(typename Elem::Raw) : 0;
+}
+
+// Reallocate the data blob for the primitive vector in [vCell] to
+// hold exactly [newSize] elements. Same as vectorResize, but for
+// primitive vectors. This function may trigger GC.
+template<class Elem>
+static void primVectorResize(Cell &vCell, int64_t newSize, BytecodeEngine &engine) {
+  VectorHandle *v = (VectorHandle *)cellPtr(vCell);
+  engine.failOnNilPtr(v);
+  int64_t length = heapObjSize(v);
+  if (newSize == 0) {
+    v->dataPtr = cellMakeNilHeapPtr();
+    return;
+  }
+
+  // NB: this may trigger GC
+  VectorData *newData =
+      (VectorData *)engine.heapAllocBlob(newSize * sizeof(typename Elem::Raw), 0);
+
+  v = (VectorHandle *)cellPtr(vCell);
+  if (length > 0) {
+    memcpy(&newData->elems[0], primVectorElems<Elem>(v),
+	   length * sizeof(typename Elem::Raw));
+  }
+  v->dataPtr = cellMakeHeapPtr(newData);
+}
+
+// Same as vectorExpand, but for primitive vectors.
+template<class Elem>
+static void primVectorExpand(Cell &vCell, int64_t newLength, BytecodeEngine &engine) {
+  VectorHandle *v = (VectorHandle *)cellPtr(vCell);
+  engine.failOnNilPtr(v);
+  int64_t size = primVectorSize<Elem>(v);
+  if (newLength <= size) {
+    return;
+  }
+
+  int64_t newSize = size ? size : minVectorSize;
+  while (newSize < newLength) {
+    if (newSize > bytecodeMaxInt / 2) {
+      BytecodeEngine::fatalError("Integer overflow");
+    }
+    newSize *= 2;
+  }
+
+  // NB: this may trigger GC
+  primVectorResize<Elem>(vCell, newSize, engine);
+}
+
+// Same as vectorShrink, but for primitive vectors.
+template<class Elem>
+static void primVectorShrink(Cell &vCell, BytecodeEngine &engine) {
+  VectorHandle *v = (VectorHandle *)cellPtr(vCell);
+  engine.failOnNilPtr(v);
+  int64_t length = heapObjSize(v);
+  int64_t size = primVectorSize<Elem>(v);
+  if (size <= minVectorSize || size / 4 < length) {
+    return;
+  }
+
+  int64_t newSize = size;
+  do {
+    newSize /= 2;
+  } while (newSize / 4 >= length && newSize > minVectorSize);
+
+  // NB: this may trigger GC
+  primVectorResize<Elem>(vCell, newSize, engine);
+}
+
+// _allocVectorI()
+// _allocVectorI(capacity: Int)
+// (and similarly for _allocVectorF and _allocVectorB)
+template<class Elem>
+static NativeFuncDefn(runtime_allocVectorP) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() > 1 ||
+      (engine.nArgs() == 1 && !cellIsInt(engine.arg(0)))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  int64_t capacity = 0;
+  if (engine.nArgs() == 1) {
+    capacity = cellInt(engine.arg(0));
+    if (capacity < 0) {
+      BytecodeEngine::fatalError("Invalid argument");
+    }
+  }
+
+  // NB: this may trigger GC
+  Cell vCell = vectorMake(engine);
+
+  if (capacity > 0) {
+    engine.pushGCRoot(vCell);
+    // NB: this may trigger GC
+    primVectorResize<Elem>(vCell, capacity, engine);
+    engine.popGCRoot(vCell);
+  }
+
+  engine.push(vCell);
+}
+
+// get(v: Vector[Int|Float|Bool], idx: Int) -> Int|Float|Bool
+// iget(v: Vector[Int|Float|Bool], iter: Int) -> Int|Float|Bool
+template<class Elem>
+static NativeFuncDefn(runtime_get_VP2) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsInt(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &vCell = engine.arg(0);
+  Cell &idxCell = engine.arg(1);
+
+  VectorHandle *v = (VectorHandle *)cellPtr(vCell);
+  engine.failOnNilPtr(v);
+  int64_t idx = cellInt(idxCell);
+
+  int64_t length = heapObjSize(v);
+  if (idx < 0 || idx >= length) {
+    BytecodeEngine::fatalError("Index out of bounds");
+  }
+  engine.push(Elem::toCell(primVectorElems<Elem>(v)[idx]));
+}
+
+// set(v: Vector[Int|Float|Bool], idx: Int, value: Int|Float|Bool)
+template<class Elem>
+static NativeFuncDefn(runtime_set_VP3) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 3 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsInt(engine.arg(1)) ||
+      !Elem::check(engine.arg(2))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &vCell = engine.arg(0);
+  Cell &idxCell = engine.arg(1);
+  Cell &valueCell = engine.arg(2);
+
+  VectorHandle *v = (VectorHandle *)cellPtr(vCell);
+  engine.failOnNilPtr(v);
+  int64_t idx = cellInt(idxCell);
+
+  int64_t length = heapObjSize(v);
+  if (idx < 0 || idx >= length) {
+    BytecodeEngine::fatalError("Index out of bounds");
+  }
+  primVectorElems<Elem>(v)[idx] = Elem::fromCell(valueCell);
+
+  engine.push(cellMakeInt(0));
+}
+
+// append(v: Vector[Int|Float|Bool], value: Int|Float|Bool)
+template<class Elem>
+static NativeFuncDefn(runtime_append_VP2) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !Elem::check(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &vCell = engine.arg(0);
+  Cell &valueCell = engine.arg(1);
+
+  VectorHandle *v = (VectorHandle *)cellPtr(vCell);
+  engine.failOnNilPtr(v);
+  int64_t length = heapObjSize(v);
+  if (length > bytecodeMaxInt - 1) {
+    BytecodeEngine::fatalError("Integer overflow");
+  }
+
+  // NB: this may trigger GC
+  primVectorExpand<Elem>(vCell, length + 1, engine);
+
+  v = (VectorHandle *)cellPtr(vCell);
+  primVectorElems<Elem>(v)[length] = Elem::fromCell(valueCell);
+  heapObjSetSize(v, length + 1);
+
+  engine.push(cellMakeInt(0));
+}
+
+// insert(v: Vector[Int|Float|Bool], idx: Int, value: Int|Float|Bool)
+template<class Elem>
+static NativeFuncDefn(runtime_insert_VP3) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 3 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsInt(engine.arg(1)) ||
+      !Elem::check(engine.arg(2))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &vCell = engine.arg(0);
+  Cell &idxCell = engine.arg(1);
+  Cell &valueCell = engine.arg(2);
+
+  VectorHandle *v = (VectorHandle *)cellPtr(vCell);
+  engine.failOnNilPtr(v);
+  int64_t idx = cellInt(idxCell);
+
+  int64_t length = heapObjSize(v);
+  if (idx < 0 || idx > length) {
+    BytecodeEngine::fatalError("Index out of bounds");
+  }
+  if (length > bytecodeMaxInt - 1) {
+    BytecodeEngine::fatalError("Integer overflow");
+  }
+
+  // NB: this may trigger GC
+  primVectorExpand<Elem>(vCell, length + 1, engine);
+
+  v = (VectorHandle *)cellPtr(vCell);
+  typename Elem::Raw *elems = primVectorElems<Elem>(v);
+  if (idx < length) {
+    memmove(&elems[idx+1], &elems[idx], (length - idx) * sizeof(typename Elem::Raw));
+  }
+  elems[idx] = Elem::fromCell(valueCell);
+  heapObjSetSize(v, length + 1);
+
+  engine.push(cellMakeInt(0));
+}
+
+// delete(v: Vector[Int|Float|Bool], idx: Int)
+template<class Elem>
+static NativeFuncDefn(runtime_delete_VP2) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsInt(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &vCell = engine.arg(0);
+  Cell &idxCell = engine.arg(1);
+
+  VectorHandle *v = (VectorHandle *)cellPtr(vCell);
+  engine.failOnNilPtr(v);
+  int64_t idx = cellInt(idxCell);
+
+  int64_t length = heapObjSize(v);
+  if (idx < 0 || idx >= length) {
+    BytecodeEngine::fatalError("Index out of bounds");
+  }
+
+  typename Elem::Raw *elems = primVectorElems<Elem>(v);
+  if (idx < length - 1) {
+    memmove(&elems[idx], &elems[idx+1], (length - 1 - idx) * sizeof(typename Elem::Raw));
+  }
+  heapObjSetSize(v, length - 1);
+
+  // NB: this may trigger GC
+  primVectorShrink<Elem>(vCell, engine);
+
+  engine.push(cellMakeInt(0));
+}
+
+// delete(v: Vector[Int|Float|Bool], idx: Int, n: Int)
+template<class Elem>
+static NativeFuncDefn(runtime_delete_VP3) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 3 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsInt(engine.arg(1)) ||
+      !cellIsInt(engine.arg(2))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &vCell = engine.arg(0);
+  Cell &idxCell = engine.arg(1);
+  Cell &nCell = engine.arg(2);
+
+  VectorHandle *v = (VectorHandle *)cellPtr(vCell);
+  engine.failOnNilPtr(v);
+  int64_t idx = cellInt(idxCell);
+  int64_t n = cellInt(nCell);
+
+  int64_t length = heapObjSize(v);
+  if (idx < 0 || idx > length || n < 0 || n > length - idx) {
+    BytecodeEngine::fatalError("Index out of bounds");
+  }
+
+  typename Elem::Raw *elems = primVectorElems<Elem>(v);
+  if (n < length - idx) {
+    memmove(&elems[idx], &elems[idx+n], (length - idx - n) * sizeof(typename Elem::Raw));
+  }
+  heapObjSetSize(v, length - n);
+
+  // NB: this may trigger GC
+  primVectorShrink<Elem>(vCell, engine);
+
+  engine.push(cellMakeInt(0));
+}
+
+// capacity(v: Vector[Int|Float|Bool]) -> Int
+template<class Elem>
+static NativeFuncDefn(runtime_capacity_VP1) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &vCell = engine.arg(0);
+
+  VectorHandle *v = (VectorHandle *)cellPtr(vCell);
+  engine.failOnNilPtr(v);
+
+  engine.push(cellMakeInt(primVectorSize<Elem>(v)));
+}
+
+// reserve(v: Vector[Int|Float|Bool], n: Int)
+template<class Elem>
+static NativeFuncDefn(runtime_reserve_VP2) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsInt(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &vCell = engine.arg(0);
+  Cell &nCell = engine.arg(1);
+
+  VectorHandle *v = (VectorHandle *)cellPtr(vCell);
+  engine.failOnNilPtr(v);
+  int64_t size = primVectorSize<Elem>(v);
+  int64_t n = cellInt(nCell);
+  if (n < 0) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+
+  if (n > size) {
+    // NB: this may trigger GC
+    primVectorResize<Elem>(vCell, n, engine);
+  }
+
+  engine.push(cellMakeInt(0));
+}
+
+// shrinkToFit(v: Vector[Int|Float|Bool])
+template<class Elem>
+static NativeFuncDefn(runtime_shrinkToFit_VP1) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &vCell = engine.arg(0);
+
+  VectorHandle *v = (VectorHandle *)cellPtr(vCell);
+  engine.failOnNilPtr(v);
+  int64_t length = heapObjSize(v);
+  int64_t size = primVectorSize<Elem>(v);
+
+  if (size > length) {
+    // NB: this may trigger GC
+    primVectorResize<Elem>(vCell, length, engine);
+  }
+
+  engine.push(cellMakeInt(0));
+}
+
+// sort(v: Vector[Int|Float|Bool], cmp: Func[$T,$T->Bool])
+template<class Elem>
+static NativeFuncDefn(runtime_sort_VP2) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsPtr(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &vCell = engine.arg(0);
+  Cell &cmpCell = engine.arg(1);
+
+  VectorHandle *v = (VectorHandle *)cellPtr(vCell);
+  engine.failOnNilPtr(v);
+  int64_t length = heapObjSize(v);
+
+  // the comparison function can trigger GC, which can move the data
+  // blob, so sort a copy of the elements
+  std::vector<typename Elem::Raw> elems(primVectorElems<Elem>(v),
+					primVectorElems<Elem>(v) + length);
+  std::sort(elems.begin(), elems.end(),
+	    [&engine, &cmpCell](typename Elem::Raw x1, typename Elem::Raw x2) {
+	      engine.push(Elem::toCell(x1));
+	      engine.push(Elem::toCell(x2));
+	      engine.callFunctionPtr(cmpCell, 2);
+	      return engine.popBool();
+	    });
+
+  // the comparison function may have modified the vector
+  v = (VectorHandle *)cellPtr(vCell);
+  if (heapObjSize(v) != length) {
+    BytecodeEngine::fatalError("Vector modified during sort");
+  }
+  if (length > 0) {
+    memcpy(primVectorElems<Elem>(v), elems.data(), length * sizeof(typename Elem::Raw));
+  }
+
+  engine.push(cellMakeInt(0));
+}
+
+//------------------------------------------------------------------------
+// sorting
+//------------------------------------------------------------------------
+
+// Generic (non-primitive) vectors store cells in a tuple. This has
+// the same interface as IntElem, etc., so the sorting functions below
+// can handle all vector types.
+struct CellElem {
+  typedef Cell Raw;
+  static bool check(Cell cell) { return true; }
+  static Raw fromCell(Cell cell) { return cell; }
+  static Cell toCell(Raw x) { return x; }
+};
+
+// Return element [idx] of the vector in [vCell], as a cell. This
+// re-reads the vector handle, so it can be used after a callback
+// (which may trigger GC). Fails if the vector's length has changed
+// (i.e., if a callback modified the vector).
+template<class Elem>
+static Cell sortGetElem(Cell &vCell, int64_t length, int64_t idx) {
+  VectorHandle *v = (VectorHandle *)cellPtr(vCell);
+  if (heapObjSize(v) != length) {
+    BytecodeEngine::fatalError("Vector modified during sort");
+  }
+  return Elem::toCell(primVectorElems<Elem>(v)[idx]);
+}
+
+// Rearrange the elements of the vector in [vCell] so that element i
+// is the old element [perm][i]. This does not trigger GC.
+template<class Elem>
+static void sortPermute(Cell &vCell, std::vector<int64_t> &perm) {
+  VectorHandle *v = (VectorHandle *)cellPtr(vCell);
+  int64_t length = heapObjSize(v);
+  if (length != (int64_t)perm.size()) {
+    BytecodeEngine::fatalError("Vector modified during sort");
+  }
+  typename Elem::Raw *elems = primVectorElems<Elem>(v);
+  std::vector<typename Elem::Raw> tmp(elems, elems + length);
+  for (int64_t i = 0; i < length; ++i) {
+    elems[i] = tmp[perm[i]];
+  }
+}
+
+// Return the identity permutation of [length] elements.
+static std::vector<int64_t> sortIdentityPerm(int64_t length) {
+  std::vector<int64_t> perm(length);
+  for (int64_t i = 0; i < length; ++i) {
+    perm[i] = i;
+  }
+  return perm;
+}
+
+// sort(v: Vector[Int])
+static NativeFuncDefn(runtime_sort_VI) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &vCell = engine.arg(0);
+
+  VectorHandle *v = (VectorHandle *)cellPtr(vCell);
+  engine.failOnNilPtr(v);
+  int64_t length = heapObjSize(v);
+
+  if (length > 1) {
+    int64_t *elems = primVectorElems<IntElem>(v);
+    parallelSort(elems, length, std::less<int64_t>());
+  }
+
+  engine.push(cellMakeInt(0));
+}
+
+// sort(v: Vector[Float])
+// NaNs are sorted to the end of the vector.
+static NativeFuncDefn(runtime_sort_VF) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &vCell = engine.arg(0);
+
+  VectorHandle *v = (VectorHandle *)cellPtr(vCell);
+  engine.failOnNilPtr(v);
+  int64_t length = heapObjSize(v);
+
+  if (length > 1) {
+    float *elems = primVectorElems<FloatElem>(v);
+    parallelSort(elems, length,
+		 [](float x1, float x2) {
+		   return x1 < x2 || (!isnan(x1) && isnan(x2));
+		 });
+  }
+
+  engine.push(cellMakeInt(0));
+}
+
+// sort(v: Vector[String])
+static NativeFuncDefn(runtime_sort_VS) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &vCell = engine.arg(0);
+
+  VectorHandle *v = (VectorHandle *)cellPtr(vCell);
+  engine.failOnNilPtr(v);
+  int64_t length = heapObjSize(v);
+
+  if (length > 1) {
+    Cell *elems = primVectorElems<CellElem>(v);
+    parallelSort(elems, length,
+		 [](Cell &s1, Cell &s2) {
+		   return stringCompare(s1, s2) < 0;
+		 });
+  }
+
+  engine.push(cellMakeInt(0));
+}
+
+// stableSort(v: Vector[$T], cmp: Func[$T,$T->Bool])
+template<class Elem>
+static NativeFuncDefn(runtime_stableSort_V2) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsPtr(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &vCell = engine.arg(0);
+  Cell &cmpCell = engine.arg(1);
+
+  VectorHandle *v = (VectorHandle *)cellPtr(vCell);
+  engine.failOnNilPtr(v);
+  int64_t length = heapObjSize(v);
+
+  // the comparison function can trigger GC, which can move the
+  // vector data, so sort a permutation vector, and fetch the elements
+  // through the handle for each comparison
+  std::vector<int64_t> perm = sortIdentityPerm(length);
+  std::stable_sort(perm.begin(), perm.end(),
+		   [&engine, &vCell, &cmpCell, length](int64_t i1, int64_t i2) {
+		     engine.push(sortGetElem<Elem>(vCell, length, i1));
+		     engine.push(sortGetElem<Elem>(vCell, length, i2));
+		     engine.callFunctionPtr(cmpCell, 2);
+		     return engine.popBool();
+		   });
+  sortPermute<Elem>(vCell, perm);
+
+  engine.push(cellMakeInt(0));
+}
+
+// sortByIntKey(v: Vector[$T], key: Func[$T->Int])
+template<class Elem>
+static NativeFuncDefn(runtime_sortByIntKey_V2) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsPtr(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &vCell = engine.arg(0);
+  Cell &keyCell = engine.arg(1);
+
+  VectorHandle *v = (VectorHandle *)cellPtr(vCell);
+  engine.failOnNilPtr(v);
+  int64_t length = heapObjSize(v);
+
+  // call the key function once per element
+  std::vector<int64_t> keys(length);
+  for (int64_t i = 0; i < length; ++i) {
+    engine.push(sortGetElem<Elem>(vCell, length, i));
+    // NB: this may trigger GC
+    engine.callFunctionPtr(keyCell, 1);
+    keys[i] = engine.popInt();
+  }
+
+  std::vector<int64_t> perm = sortIdentityPerm(length);
+  std::stable_sort(perm.begin(), perm.end(),
+		   [&keys](int64_t i1, int64_t i2) {
+		     return keys[i1] < keys[i2];
+		   });
+  sortPermute<Elem>(vCell, perm);
+
+  engine.push(cellMakeInt(0));
+}
+
+// sortByFloatKey(v: Vector[$T], key: Func[$T->Float])
+// Elements with NaN keys are sorted to the end of the vector.
+template<class Elem>
+static NativeFuncDefn(runtime_sortByFloatKey_V2) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsPtr(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &vCell = engine.arg(0);
+  Cell &keyCell = engine.arg(1);
+
+  VectorHandle *v = (VectorHandle *)cellPtr(vCell);
+  engine.failOnNilPtr(v);
+  int64_t length = heapObjSize(v);
+
+  // call the key function once per element
+  std::vector<float> keys(length);
+  for (int64_t i = 0; i < length; ++i) {
+    engine.push(sortGetElem<Elem>(vCell, length, i));
+    // NB: this may trigger GC
+    engine.callFunctionPtr(keyCell, 1);
+    keys[i] = engine.popFloat();
+  }
+
+  std::vector<int64_t> perm = sortIdentityPerm(length);
+  std::stable_sort(perm.begin(), perm.end(),
+		   [&keys](int64_t i1, int64_t i2) {
+		     float x1 = keys[i1];
+		     float x2 = keys[i2];
+		     return x1 < x2 || (!isnan(x1) && isnan(x2));
+		   });
+  sortPermute<Elem>(vCell, perm);
+
+  engine.push(cellMakeInt(0));
+}
+
+// sortByStringKey(v: Vector[$T], key: Func[$T->String])
+template<class Elem>
+static NativeFuncDefn(runtime_sortByStringKey_V2) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsPtr(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &vCell = engine.arg(0);
+  Cell &keyCell = engine.arg(1);
+
+  VectorHandle *v = (VectorHandle *)cellPtr(vCell);
+  engine.failOnNilPtr(v);
+  int64_t length = heapObjSize(v);
+
+  // the keys are heap objects, so they are stored in a tuple that is
+  // registered as a GC root while the key function is called
+  // NB: this may trigger GC
+  VectorData *keys = (VectorData *)engine.heapAllocTuple(length, 0);
+  for (int64_t i = 0; i < length; ++i) {
+    keys->elems[i] = cellMakeNilHeapPtr();
+  }
+  Cell keysCell = cellMakeHeapPtr(keys);
+  engine.pushGCRoot(keysCell);
+  for (int64_t i = 0; i < length; ++i) {
+    engine.push(sortGetElem<Elem>(vCell, length, i));
+    // NB: this may trigger GC
+    engine.callFunctionPtr(keyCell, 1);
+    Cell key = engine.pop();
+#if CHECK_RUNTIME_FUNC_ARGS
+    if (!cellIsPtr(key)) {
+      BytecodeEngine::fatalError("Invalid argument");
+    }
+#endif
+    keys = (VectorData *)cellPtr(keysCell);
+    keys->elems[i] = key;
+  }
+  engine.popGCRoot(keysCell);
+
+  // no GC can happen from here on
+  keys = (VectorData *)cellPtr(keysCell);
+  std::vector<int64_t> perm = sortIdentityPerm(length);
+  std::stable_sort(perm.begin(), perm.end(),
+		   [keys](int64_t i1, int64_t i2) {
+		     return stringCompare(keys->elems[i1], keys->elems[i2]) < 0;
+		   });
+  sortPermute<Elem>(vCell, perm);
+
+  engine.push(cellMakeInt(0));
+}
+
+//------------------------------------------------------------------------
+// parallel kernels
+//------------------------------------------------------------------------
+
+// These run on the thread pool (see ThreadPool.h), so they operate
+// only on the raw element arrays of primitive vectors, and never call
+// back into the engine from inside a parallelFor.
+
+// sum(v: Vector[Int]) -> Int
+static NativeFuncDefn(runtime_sum_VI) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &vCell = engine.arg(0);
+
+  VectorHandle *v = (VectorHandle *)cellPtr(vCell);
+  engine.failOnNilPtr(v);
+  int64_t length = heapObjSize(v);
+  int64_t *elems = primVectorElems<IntElem>(v);
+
+  // the chunk sums are 128-bit, so a running sum can't overflow
+  // partway through -- only the final sum is range-checked
+  int64_t nChunks = (length + parallelChunkSize - 1) / parallelChunkSize;
+  std::vector<__int128> sums(nChunks);
+  parallelFor(length, parallelChunkSize,
+	      [elems, &sums](int64_t first, int64_t last) {
+		__int128 sum = 0;
+		for (int64_t i = first; i < last; ++i) {
+		  sum += elems[i];
+		}
+		sums[first / parallelChunkSize] = sum;
+	      });
+
+  __int128 sum = 0;
+  for (int64_t i = 0; i < nChunks; ++i) {
+    sum += sums[i];
+  }
+  if (sum > bytecodeMaxInt || sum < bytecodeMinInt) {
+    BytecodeEngine::fatalError("Integer overflow");
+  }
+
+  engine.push(cellMakeInt((int64_t)sum));
+}
+
+// sum(v: Vector[Float]) -> Float
+static NativeFuncDefn(runtime_sum_VF) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &vCell = engine.arg(0);
+
+  VectorHandle *v = (VectorHandle *)cellPtr(vCell);
+  engine.failOnNilPtr(v);
+  int64_t length = heapObjSize(v);
+  float *elems = primVectorElems<FloatElem>(v);
+
+  // accumulate in double precision, and combine the per-chunk sums in
+  // order, so the result doesn't depend on the number of threads
+  int64_t nChunks = (length + parallelChunkSize - 1) / parallelChunkSize;
+  std::vector<double> sums(nChunks);
+  parallelFor(length, parallelChunkSize,
+	      [elems, &sums](int64_t first, int64_t last) {
+		double sum = 0;
+		for (int64_t i = first; i < last; ++i) {
+		  sum += elems[i];
+		}
+		sums[first / parallelChunkSize] = sum;
+	      });
+
+  double sum = 0;
+  for (int64_t i = 0; i < nChunks; ++i) {
+    sum += sums[i];
+  }
+
+  engine.push(cellMakeFloat((float)sum));
+}
+
+// dot(a: Vector[Float], b: Vector[Float]) -> Float
+static NativeFuncDefn(runtime_dot_VFVF) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsPtr(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &aCell = engine.arg(0);
+  Cell &bCell = engine.arg(1);
+
+  VectorHandle *a = (VectorHandle *)cellPtr(aCell);
+  engine.failOnNilPtr(a);
+  VectorHandle *b = (VectorHandle *)cellPtr(bCell);
+  engine.failOnNilPtr(b);
+  int64_t length = heapObjSize(a);
+  if (heapObjSize(b) != length) {
+    BytecodeEngine::fatalError("Vector lengths differ");
+  }
+  float *aElems = primVectorElems<FloatElem>(a);
+  float *bElems = primVectorElems<FloatElem>(b);
+
+  int64_t nChunks = (length + parallelChunkSize - 1) / parallelChunkSize;
+  std::vector<double> sums(nChunks);
+  parallelFor(length, parallelChunkSize,
+	      [aElems, bElems, &sums](int64_t first, int64_t last) {
+		double sum = 0;
+		for (int64_t i = first; i < last; ++i) {
+		  sum += (double)aElems[i] * (double)bElems[i];
+		}
+		sums[first / parallelChunkSize] = sum;
+	      });
+
+  double sum = 0;
+  for (int64_t i = 0; i < nChunks; ++i) {
+    sum += sums[i];
+  }
+
+  engine.push(cellMakeFloat((float)sum));
+}
+
+// scale(v: Vector[Float], k: Float)
+static NativeFuncDefn(runtime_scale_VFF) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsFloat(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &vCell = engine.arg(0);
+  float k = cellFloat(engine.arg(1));
+
+  VectorHandle *v = (VectorHandle *)cellPtr(vCell);
+  engine.failOnNilPtr(v);
+  int64_t length = heapObjSize(v);
+  float *elems = primVectorElems<FloatElem>(v);
+
+  parallelFor(length, parallelChunkSize,
+	      [elems, k](int64_t first, int64_t last) {
+		for (int64_t i = first; i < last; ++i) {
+		  elems[i] *= k;
+		}
+	      });
+
+  engine.push(cellMakeInt(0));
+}
+
+// filterRange(v: Vector[Int], min: Int, max: Int) -> Vector[Int]
+// filterRange(v: Vector[Float], min: Float, max: Float) -> Vector[Float]
+// Returns a new vector containing the elements x of [v] with
+// min <= x <= max, in their original order.
+template<class Elem>
+static NativeFuncDefn(runtime_filterRange_VP3) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 3 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !Elem::check(engine.arg(1)) ||
+      !Elem::check(engine.arg(2))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &vCell = engine.arg(0);
+  typename Elem::Raw min = Elem::fromCell(engine.arg(1));
+  typename Elem::Raw max = Elem::fromCell(engine.arg(2));
+
+  VectorHandle *v = (VectorHandle *)cellPtr(vCell);
+  engine.failOnNilPtr(v);
+  int64_t length = heapObjSize(v);
+  typename Elem::Raw *elems = primVectorElems<Elem>(v);
+
+  // count the matching elements in each chunk
+  int64_t nChunks = (length + parallelChunkSize - 1) / parallelChunkSize;
+  std::vector<int64_t> offsets(nChunks + 1);
+  parallelFor(length, parallelChunkSize,
+	      [elems, min, max, &offsets](int64_t first, int64_t last) {
+		int64_t n = 0;
+		for (int64_t i = first; i < last; ++i) {
+		  n += elems[i] >= min && elems[i] <= max;
+		}
+		offsets[first / parallelChunkSize + 1] = n;
+	      });
+  for (int64_t i = 0; i < nChunks; ++i) {
+    offsets[i+1] += offsets[i];
+  }
+  int64_t outLength = offsets[nChunks];
+
+  // NB: this may trigger GC
+  Cell outCell = vectorMake(engine);
+  if (outLength > 0) {
+    engine.pushGCRoot(outCell);
+    // NB: this may trigger GC
+    primVectorResize<Elem>(outCell, outLength, engine);
+    engine.popGCRoot(outCell);
+  }
+
+  // copy the matching elements
+  v = (VectorHandle *)cellPtr(vCell);
+  elems = primVectorElems<Elem>(v);
+  VectorHandle *out = (VectorHandle *)cellPtr(outCell);
+  typename Elem::Raw *outElems = primVectorElems<Elem>(out);
+  parallelFor(length, parallelChunkSize,
+	      [elems, outElems, min, max, &offsets](int64_t first, int64_t last) {
+		int64_t j = offsets[first / parallelChunkSize];
+		for (int64_t i = first; i < last; ++i) {
+		  if (elems[i] >= min && elems[i] <= max) {
+		    outElems[j++] = elems[i];
+		  }
+		}
+	      });
+  heapObjSetSize(out, outLength);
+
+  engine.push(outCell);
+}
+
+//------------------------------------------------------------------------
+
+void runtime_Vector_init(BytecodeEngine &engine) {
+  engine.addNativeFunction("_allocVector", &runtime_allocVector);
+  engine.addNativeFunction("length_V1", &runtime_length_V1);
+  engine.addNativeFunction("get_V2", &runtime_get_V2);
+  engine.addNativeFunction("set_V3", &runtime_set_V3);
+  engine.addNativeFunction("append_V2", &runtime_append_V2);
+  engine.addNativeFunction("insert_V3", &runtime_insert_V3);
+  engine.addNativeFunction("delete_V2", &runtime_delete_V2);
+  engine.addNativeFunction("delete_V3", &runtime_delete_V3);
+  engine.addNativeFunction("clear_V1", &runtime_clear_V1);
+  engine.addNativeFunction("capacity_V1", &runtime_capacity_V1);
+  engine.addNativeFunction("reserve_V2", &runtime_reserve_V2);
+  engine.addNativeFunction("shrinkToFit_V1", &runtime_shrinkToFit_V1);
+  engine.addNativeFunction("sort_V2", &runtime_sort_V2);
+  engine.addNativeFunction("stableSort_V2", &runtime_stableSort_V2<CellElem>);
+  engine.addNativeFunction("sortByIntKey_V2", &runtime_sortByIntKey_V2<CellElem>);
+  engine.addNativeFunction("sortByFloatKey_V2", &runtime_sortByFloatKey_V2<CellElem>);
+  engine.addNativeFunction("sortByStringKey_V2", &runtime_sortByStringKey_V2<CellElem>);
+  engine.addNativeFunction("ifirst_V1", &runtime_ifirst_V1);
+  engine.addNativeFunction("imore_V2", &runtime_imore_V2);
+  engine.addNativeFunction("inext_V2", &runtime_inext_V2);
+  engine.addNativeFunction("iget_V2", &runtime_get_V2);
+
+  engine.addNativeFunction("_allocVectorI", &runtime_allocVectorP<IntElem>);
+  engine.addNativeFunction("length_VI1", &runtime_length_V1);
+  engine.addNativeFunction("get_VI2", &runtime_get_VP2<IntElem>);
+  engine.addNativeFunction("set_VI3", &runtime_set_VP3<IntElem>);
+  engine.addNativeFunction("append_VI2", &runtime_append_VP2<IntElem>);
+  engine.addNativeFunction("insert_VI3", &runtime_insert_VP3<IntElem>);
+  engine.addNativeFunction("delete_VI2", &runtime_delete_VP2<IntElem>);
+  engine.addNativeFunction("delete_VI3", &runtime_delete_VP3<IntElem>);
+  engine.addNativeFunction("clear_VI1", &runtime_clear_V1);
+  engine.addNativeFunction("capacity_VI1", &runtime_capacity_VP1<IntElem>);
+  engine.addNativeFunction("reserve_VI2", &runtime_reserve_VP2<IntElem>);
+  engine.addNativeFunction("shrinkToFit_VI1", &runtime_shrinkToFit_VP1<IntElem>);
+  engine.addNativeFunction("sort_VI2", &runtime_sort_VP2<IntElem>);
+  engine.addNativeFunction("stableSort_VI2", &runtime_stableSort_V2<IntElem>);
+  engine.addNativeFunction("sortByIntKey_VI2", &runtime_sortByIntKey_V2<IntElem>);
+  engine.addNativeFunction("sortByFloatKey_VI2", &runtime_sortByFloatKey_V2<IntElem>);
+  engine.addNativeFunction("sortByStringKey_VI2", &runtime_sortByStringKey_V2<IntElem>);
+  engine.addNativeFunction("ifirst_VI1", &runtime_ifirst_V1);
+  engine.addNativeFunction("imore_VI2", &runtime_imore_V2);
+  engine.addNativeFunction("inext_VI2", &runtime_inext_V2);
+  engine.addNativeFunction("iget_VI2", &runtime_get_VP2<IntElem>);
+
+  engine.addNativeFunction("_allocVectorF", &runtime_allocVectorP<FloatElem>);
+  engine.addNativeFunction("length_VF1", &runtime_length_V1);
+  engine.addNativeFunction("get_VF2", &runtime_get_VP2<FloatElem>);
+  engine.addNativeFunction("set_VF3", &runtime_set_VP3<FloatElem>);
+  engine.addNativeFunction("append_VF2", &runtime_append_VP2<FloatElem>);
+  engine.addNativeFunction("insert_VF3", &runtime_insert_VP3<FloatElem>);
+  engine.addNativeFunction("delete_VF2", &runtime_delete_VP2<FloatElem>);
+  engine.addNativeFunction("delete_VF3", &runtime_delete_VP3<FloatElem>);
+  engine.addNativeFunction("clear_VF1", &runtime_clear_V1);
+  engine.addNativeFunction("capacity_VF1", &runtime_capacity_VP1<FloatElem>);
+  engine.addNativeFunction("reserve_VF2", &runtime_reserve_VP2<FloatElem>);
+  engine.addNativeFunction("shrinkToFit_VF1", &runtime_shrinkToFit_VP1<FloatElem>);
+  engine.addNativeFunction("sort_VF2", &runtime_sort_VP2<FloatElem>);
+  engine.addNativeFunction("stableSort_VF2", &runtime_stableSort_V2<FloatElem>);
+  engine.addNativeFunction("sortByIntKey_VF2", &runtime_sortByIntKey_V2<FloatElem>);
+  engine.addNativeFunction("sortByFloatKey_VF2", &runtime_sortByFloatKey_V2<FloatElem>);
+  engine.addNativeFunction("sortByStringKey_VF2", &runtime_sortByStringKey_V2<FloatElem>);
+  engine.addNativeFunction("ifirst_VF1", &runtime_ifirst_V1);
+  engine.addNativeFunction("imore_VF2", &runtime_imore_V2);
+  engine.addNativeFunction("inext_VF2", &runtime_inext_V2);
+  engine.addNativeFunction("iget_VF2", &runtime_get_VP2<FloatElem>);
+
+  engine.addNativeFunction("_allocVectorB", &runtime_allocVectorP<BoolElem>);
+  engine.addNativeFunction("length_VB1", &runtime_length_V1);
+  engine.addNativeFunction("get_VB2", &runtime_get_VP2<BoolElem>);
+  engine.addNativeFunction("set_VB3", &runtime_set_VP3<BoolElem>);
+  engine.addNativeFunction("append_VB2", &runtime_append_VP2<BoolElem>);
+  engine.addNativeFunction("insert_VB3", &runtime_insert_VP3<BoolElem>);
+  engine.addNativeFunction("delete_VB2", &runtime_delete_VP2<BoolElem>);
+  engine.addNativeFunction("delete_VB3", &runtime_delete_VP3<BoolElem>);
+  engine.addNativeFunction("clear_VB1", &runtime_clear_V1);
+  engine.addNativeFunction("capacity_VB1", &runtime_capacity_VP1<BoolElem>);
+  engine.addNativeFunction("reserve_VB2", &runtime_reserve_VP2<BoolElem>);
+  engine.addNativeFunction("shrinkToFit_VB1", &runtime_shrinkToFit_VP1<BoolElem>);
+  engine.addNativeFunction("sort_VB2", &runtime_sort_VP2<BoolElem>);
+  engine.addNativeFunction("stableSort_VB2", &runtime_stableSort_V2<BoolElem>);
+  engine.addNativeFunction("sortByIntKey_VB2", &runtime_sortByIntKey_V2<BoolElem>);
+  engine.addNativeFunction("sortByFloatKey_VB2", &runtime_sortByFloatKey_V2<BoolElem>);
+  engine.addNativeFunction("sortByStringKey_VB2", &runtime_sortByStringKey_V2<BoolElem>);
+  engine.addNativeFunction("ifirst_VB1", &runtime_ifirst_V1);
+  engine.addNativeFunction("imore_VB2", &runtime_imore_V2);
+  engine.addNativeFunction("inext_VB2", &runtime_inext_V2);
+  engine.addNativeFunction("iget_VB2", &runtime_get_VP2<BoolElem>);
+
+  engine.addNativeFunction("sort_VI", &runtime_sort_VI);
+  engine.addNativeFunction("sort_VF", &runtime_sort_VF);
+  engine.addNativeFunction("sort_VS", &runtime_sort_VS);
+  engine.addNativeFunction("sum_VI", &runtime_sum_VI);
+  engine.addNativeFunction("sum_VF", &runtime_sum_VF);
+  engine.addNativeFunction("dot_VFVF", &runtime_dot_VFVF);
+  engine.addNativeFunction("scale_VFF", &runtime_scale_VFF);
+  engine.addNativeFunction("filterRange_VIII", &runtime_filterRange_VP3<IntElem>);
+  engine.addNativeFunction("filterRange_VFFF", &runtime_filterRange_VP3<FloatElem>);
+}
+
+//------------------------------------------------------------------------
+// support functions
+//------------------------------------------------------------------------
+
+Cell vectorMake(BytecodeEngine &engine) {
+  VectorHandle *v = (VectorHandle *)engine.heapAllocHandle(0, 0);
+  v->dataPtr = cellMakeNilHeapPtr();
+  return cellMakeHeapPtr(v);
+}
+
+template<class Elem>
+static Cell primVectorMake(const typename Elem::Raw *elems, int64_t n, BytecodeEngine &engine) {
+  // NB: this may trigger GC
+  Cell vCell = vectorMake(engine);
+  if (n > 0) {
+    engine.pushGCRoot(vCell);
+    // NB: this may trigger GC
+    primVectorResize<Elem>(vCell, n, engine);
+    engine.popGCRoot(vCell);
+    VectorHandle *v = (VectorHandle *)cellPtr(vCell);
+    memcpy(primVectorElems<Elem>(v), elems, n * sizeof(typename Elem::Raw));
+    heapObjSetSize(v, n);
+  }
+  return vCell;
+}
+
+Cell vectorMakeInt(const int64_t *elems, int64_t n, BytecodeEngine &engine) {
+  return primVectorMake<IntElem>(elems, n, engine);
+}
+
+Cell vectorMakeFloat(const float *elems, int64_t n, BytecodeEngine &engine) {
+  return primVectorMake<FloatElem>(elems, n, engine);
+}
+
+Cell vectorMakeBool(const uint8_t *elems, int64_t n, BytecodeEngine &engine) {
+  return primVectorMake<BoolElem>(elems, n, engine);
+}
+
+const int64_t *vectorIntElems(Cell &vCell) {
+  VectorHandle *v = (VectorHandle *)cellPtr(vCell);
+  BytecodeEngine::failOnNilPtr(v);
+  return primVectorElems<IntElem>(v);
+}
+
+const float *vectorFloatElems(Cell &vCell) {
+  VectorHandle *v = (VectorHandle *)cellPtr(vCell);
+  BytecodeEngine::failOnNilPtr(v);
+  return primVectorElems<FloatElem>(v);
+}
+
+const uint8_t *vectorBoolElems(Cell &vCell) {
+  VectorHandle *v = (VectorHandle *)cellPtr(vCell);
+  BytecodeEngine::failOnNilPtr(v);
+  return primVectorElems<BoolElem>(v);
 }
 
 int64_t vectorLength(Cell &vCell) {
@@ -563,11 +1766,17 @@ void vectorAppend(Cell &vCell, Cell &elemCell, BytecodeEngine &engine) {
     BytecodeEngine::fatalError("Integer overflow");
   }
 
+  // [elemCell] is often an unregistered local in the caller, so this
+  // roots a copy -- rooting [elemCell] itself would register it twice
+  // if it's already a GC root or a stack slot
+  Cell elem = elemCell;
+  engine.pushGCRoot(elem);
   // NB: this may trigger GC
   vectorExpand(vCell, length + 1, engine);
+  engine.popGCRoot(elem);
 
   v = (VectorHandle *)cellPtr(vCell);
   VectorData *data = (VectorData *)cellPtr(v->dataPtr);
-  data->elems[length] = elemCell;
+  data->elems[length] = elem;
   heapObjSetSize(v, length + 1);
 }
@@ -20,6 +20,29 @@
 // NB: this may trigger GC.
 extern Cell vectorMake(BytecodeEngine &engine);
 
+// Construct a Vector[Int] on the heap, containing [n] elements
+// copied from [elems].
+// NB: the caller is responsible for making the returned Cell visible
+// to the GC.
+// NB: this may trigger GC.
+extern Cell vectorMakeInt(const int64_t *elems, int64_t n, BytecodeEngine &engine);
+
+// Same as vectorMakeInt, but for Vector[Float] and Vector[Bool]
+// (where each Bool element is a 0/1 byte).
+// NB: the caller is responsible for making the returned Cell visible
+// to the GC.
+// NB: this may trigger GC.
+extern Cell vectorMakeFloat(const float *elems, int64_t n, BytecodeEngine &engine);
+extern Cell vectorMakeBool(const uint8_t *elems, int64_t n, BytecodeEngine &engine);
+
+// Return a pointer to the raw elements of a Vector[Int],
+// Vector[Float], or Vector[Bool] -- or nullptr if the vector has
+// never held any elements. The pointer is only valid until the next
+// GC.
+extern const int64_t *vectorIntElems(Cell &vCell);
+extern const float *vectorFloatElems(Cell &vCell);
+extern const uint8_t *vectorBoolElems(Cell &vCell);
+
 // Return the length of [vCell].
 extern int64_t vectorLength(Cell &vCell);
 
@@ -0,0 +1,244 @@
+//========================================================================
+//
+// runtime_datafile.cpp
+//
+// Part of the Haxonite project, under the MIT License.
+// Copyright 2025 Derek Noonburg
+//
+//========================================================================
+
+// DataFiles (see library/src/DataFile.hax) are line-oriented: each
+// non-blank, non-comment line is a list of space-separated tokens,
+// which may be double-quoted (with \" and \\ escapes). This
+// tokenizes one line at a time, so the DataFile module can build (or
+// stream) sections without touching individual bytes.
+
+#include "runtime_datafile.h"
+#include <string.h>
+#include <string>
+#include <vector>
+#include "BytecodeDefs.h"
+#include "runtime_String.h"
+#include "runtime_StringBuf.h"
+#include "runtime_Vector.h"
+
+//------------------------------------------------------------------------
+
+struct DataCursor {
+  uint64_t hdr;
+  Cell pos;
+  Cell lineNum;
+};
+
+struct DataLine {
+  uint64_t hdr;
+  Cell cmd;
+  Cell args;
+  Cell lineNum;
+};
+#define dataLineNCells (sizeof(DataLine)/sizeof(Cell) - 1)
+
+//------------------------------------------------------------------------
+
+// Skip blank lines and comments, starting at [pos], which is the
+// start of line [lineNum]. Returns false at end of input.
+static bool dataSkipBlankLines(const uint8_t *data, int64_t length,
+			       int64_t &pos, int64_t &lineNum) {
+  while (true) {
+    if (pos >= length) {
+      return false;
+    }
+    int64_t pos2 = pos;
+
+    // skip spaces at start of line
+    while (pos2 < length && data[pos2] == ' ') {
+      ++pos2;
+    }
+
+    // skip comment
+    if (pos2 <= length - 2 && data[pos2] == '/' && data[pos2 + 1] == '/') {
+      pos2 += 2;
+      while (pos2 < length && data[pos2] != '\n') {
+	++pos2;
+      }
+    }
+
+    // end of data (unterminated last line)
+    if (pos2 >= length) {
+      return false;
+    }
+
+    // blank line or comment
+    if (data[pos2] == '\n') {
+      pos = pos2 + 1;
+      ++lineNum;
+
+    // valid line
+    } else {
+      return true;
+    }
+  }
+}
+
+// Split the line at [pos] into tokens. The token text is appended to
+// [text], and the end offset of each token (in [text]) is appended to
+// [tokenEnds]. On success, [pos] and [lineNum] are advanced to the
+// start of the next line, and this returns nullptr. On error, returns
+// the error message.
+static const char *dataTokenizeLine(const uint8_t *data, int64_t length,
+				    int64_t &pos, int64_t &lineNum,
+				    std::string &text, std::vector<size_t> &tokenEnds) {
+  // skip spaces at start of line
+  while (pos < length && data[pos] == ' ') {
+    ++pos;
+  }
+  if (pos == length) {
+    return "Syntax error";
+  }
+
+  while (true) {
+    uint8_t c = data[pos];
+
+    // end of line
+    if (c == '\n') {
+      ++pos;
+      ++lineNum;
+      break;
+    }
+
+    // quoted token
+    if (c == '"') {
+      ++pos;
+      while (true) {
+	if (pos == length) {
+	  return "Unterminated string";
+	}
+	c = data[pos++];
+	if (c == '"') {
+	  break;
+	}
+	if (c == '\\') {
+	  if (pos == length) {
+	    return "Invalid escape character in string";
+	  }
+	  c = data[pos++];
+	  if (c != '"' && c != '\\') {
+	    return "Invalid escape character in string";
+	  }
+	}
+	text.push_back((char)c);
+      }
+
+    // unquoted token
+    } else {
+      int64_t start = pos;
+      while (pos < length && data[pos] != ' ' && data[pos] != '\n') {
+	++pos;
+      }
+      text.append((const char *)data + start, pos - start);
+    }
+    tokenEnds.push_back(text.size());
+
+    // skip spaces before next token
+    while (pos < length && data[pos] == ' ') {
+      ++pos;
+    }
+
+    // unterminated line
+    if (pos == length) {
+      ++lineNum;
+      break;
+    }
+  }
+
+  return nullptr;
+}
+
+// readDataLine(in: StringBuf, cursor: DataCursor,
+//              err: Func[Int,String]) -> Result[DataLine]
+static NativeFuncDefn(runtime_readDataLine_T10DataCursorG2NIS) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 3 ||
+      !cellIsHeapPtr(engine.arg(0)) ||
+      !cellIsHeapPtr(engine.arg(1)) ||
+      !cellIsHeapPtr(engine.arg(2))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &inCell = engine.arg(0);
+  Cell &cursorCell = engine.arg(1);
+  Cell &errCell = engine.arg(2);
+
+  DataCursor *cursor = (DataCursor *)cellHeapPtr(cursorCell);
+  engine.failOnNilPtr(cursor);
+  int64_t pos = cellInt(cursor->pos);
+  int64_t lineNum = cellInt(cursor->lineNum);
+  const uint8_t *data = stringBufData(inCell);
+  int64_t length = stringBufLength(inCell);
+  if (pos < 0) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+
+  //--- end of input
+  if (!dataSkipBlankLines(data, length, pos, lineNum)) {
+    cursor->pos = cellMakeInt(pos);
+    cursor->lineNum = cellMakeInt(lineNum);
+    engine.push(cellMakeNilHeapPtr());
+    return;
+  }
+
+  //--- tokenize the line
+  int64_t firstLineNum = lineNum;
+  std::string text;
+  std::vector<size_t> tokenEnds;
+  const char *errMsg = dataTokenizeLine(data, length, pos, lineNum, text, tokenEnds);
+  if (errMsg) {
+    engine.push(cellMakeInt(lineNum));
+    // NB: this may trigger GC
+    engine.push(stringMake((const uint8_t *)errMsg, (int64_t)strlen(errMsg), engine));
+    // NB: this may trigger GC
+    engine.callFunctionPtr(errCell, 2);
+    engine.pop();
+    engine.push(cellMakeError());
+    return;
+  }
+  cursor->pos = cellMakeInt(pos);
+  cursor->lineNum = cellMakeInt(lineNum);
+
+  //--- construct the DataLine
+  // NB: this may trigger GC
+  DataLine *line = (DataLine *)engine.heapAllocTuple(dataLineNCells, 0);
+  line->cmd = cellMakeNilHeapPtr();
+  line->args = cellMakeNilHeapPtr();
+  line->lineNum = cellMakeInt(firstLineNum);
+  Cell lineCell = cellMakeHeapPtr(line);
+  engine.pushGCRoot(lineCell);
+  // NB: this may trigger GC
+  Cell argsCell = vectorMake(engine);
+  engine.pushGCRoot(argsCell);
+  Cell tokenCell = cellMakeNilHeapPtr();
+  for (size_t i = 0; i < tokenEnds.size(); ++i) {
+    size_t start = i ? tokenEnds[i - 1] : 0;
+    // NB: this may trigger GC
+    tokenCell = stringMake((const uint8_t *)text.data() + start,
+			   (int64_t)(tokenEnds[i] - start), engine);
+    if (i == 0) {
+      ((DataLine *)cellHeapPtr(lineCell))->cmd = tokenCell;
+    } else {
+      // NB: this may trigger GC
+      vectorAppend(argsCell, tokenCell, engine);
+    }
+  }
+  ((DataLine *)cellHeapPtr(lineCell))->args = argsCell;
+  engine.popGCRoot(argsCell);
+  engine.popGCRoot(lineCell);
+
+  engine.push(lineCell);
+}
+
+//------------------------------------------------------------------------
+
+void runtime_datafile_init(BytecodeEngine &engine) {
+  engine.addNativeFunction("readDataLine_T10DataCursorG2NIS",
+			   &runtime_readDataLine_T10DataCursorG2NIS);
+}
@@ -0,0 +1,20 @@
+//========================================================================
+//
+// runtime_datafile.h
+//
+// Runtime library: DataFile tokenizer (used by the DataFile library
+// module).
+//
+// Part of the Haxonite project, under the MIT License.
+// Copyright 2025 Derek Noonburg
+//
+//========================================================================
+
+#ifndef runtime_datafile_h
+#define runtime_datafile_h
+
+#include "BytecodeEngine.h"
+
+extern void runtime_datafile_init(BytecodeEngine &engine);
+
+#endif // runtime_datafile_h
@@ -0,0 +1,696 @@
+//========================================================================
+//
+// runtime_drawlist.cpp
+//
+// Part of the Haxonite project, under the MIT License.
+// Copyright 2025 Derek Noonburg
+//
+//========================================================================
+
+// Binary encoding for DrawLists (see hdr/gfx.haxh). The text format
+// written by the DrawList module prints and re-parses every
+// coordinate; this one stores Floats as raw values, and copies each
+// Path's xy and flags arrays in bulk. The encoding is:
+//
+//   header        "HXDL", followed by a version byte
+//   string table  varint(n), followed by n strings, each of which is
+//                 varint(length) followed by the bytes -- every
+//                 distinct String in the DrawList (resource tags,
+//                 font names, text) is stored here once
+//   resources     varint(n + 1), followed by n records
+//   ops           varint(n + 1), followed by n records
+//
+// Each record is a substruct ID byte, followed by varint(payload
+// length) and the payload, which contains the substruct's fields, as
+// listed in drawListResourceFields / drawListOpFields:
+//
+//   f     Float    4 raw bytes
+//   c     ARGB     4 raw bytes
+//   e<k>  enum     varint (the enum has k values)
+//   b     Bool     1 byte
+//   s     String   varint(string table index + 1)
+//   m     Matrix   1 byte, followed by 6 Floats
+//   p     Path     varint(number of points + 1), followed by the
+//                  state byte, the current point (2 Floats), the
+//                  flags bytes, and the xy Floats
+//
+// A nil String, Matrix, Path, or Vector is written as a 0 byte. As
+// with ser/deser, raw values are in native byte order.
+
+#include "runtime_drawlist.h"
+#include <string.h>
+#include <string>
+#include <unordered_map>
+#include "BytecodeDefs.h"
+#include "Gfx.h"
+#include "runtime_String.h"
+#include "runtime_StringBuf.h"
+#include "runtime_Vector.h"
+
+//------------------------------------------------------------------------
+
+struct DrawList {
+  uint64_t hdr;
+  Cell resources;     // Vector[DrawListResource]
+  Cell ops;           // Vector[DrawListOp]
+};
+
+#define drawListNCells (sizeof(DrawList) / sizeof(Cell) - 1)
+
+// DrawListResource and DrawListOp are varstructs: field 0 is the
+// substruct ID, followed by the fields described by these tables,
+// which are indexed by substruct ID. (For resources, the first field
+// is the common [tag] field.)
+
+static const char *drawListResourceFields[] = {
+  "ss",           // DrawListLoadFont: tag, name
+  "se3bb"         // DrawListGenericFont: tag, family, bold, italic
+};
+
+#define drawListNResourceKinds \
+  (sizeof(drawListResourceFields) / sizeof(drawListResourceFields[0]))
+
+static const char *drawListOpFields[] = {
+  "",             // DrawListPush
+  "",             // DrawListPop
+  "m",            // DrawListConcatMatrix
+  "ffff",         // DrawListIntersectClipRect
+  "c",            // DrawListRGB
+  "c",            // DrawListARGB
+  "e2",           // DrawListSetFillRule
+  "f",            // DrawListSetStrokeWidth
+  "s",            // DrawListSetFont
+  "f",            // DrawListSetFontSize
+  "p",            // DrawListStroke
+  "p",            // DrawListFill
+  "ffff",         // DrawListStrokeLine
+  "ffff",         // DrawListStrokeRect
+  "ffff",         // DrawListFillRect
+  "sff"           // DrawListDrawText
+};
+
+#define drawListNOpKinds (sizeof(drawListOpFields) / sizeof(drawListOpFields[0]))
+
+static const char drawListMagic[4] = { 'H', 'X', 'D', 'L' };
+#define drawListVersion 1
+
+// The writer appends to the output StringBuf in chunks of (roughly)
+// this size, instead of building the whole encoding first.
+#define drawListFlushSize 65536
+
+// Returns the number of fields described by [fields].
+static int64_t drawListNFields(const char *fields) {
+  int64_t n = 0;
+  for (const char *p = fields; *p; ++p) {
+    if (*p < '0' || *p > '9') {
+      ++n;
+    }
+  }
+  return n;
+}
+
+// Returns a pointer to the fields of the varstruct in [itemCell]
+// (starting with the substruct ID), and checks the ID.
+static Cell *drawListItemFields(Cell itemCell, size_t nKinds) {
+  Cell *fields = (Cell *)cellHeapPtr(itemCell);
+  BytecodeEngine::failOnNilPtr(fields);
+  ++fields;
+  int64_t id = cellInt(fields[0]);
+  if (id < 0 || id >= (int64_t)nKinds) {
+    BytecodeEngine::fatalError("Invalid substruct ID");
+  }
+  return fields;
+}
+
+//------------------------------------------------------------------------
+// writer
+//------------------------------------------------------------------------
+
+struct DrawListWriter {
+  std::string buf;
+  std::string payload;
+  std::unordered_map<std::string, int64_t> stringIndex;
+  std::string stringTable;
+};
+
+static void drawListSerVarint(uint64_t x, std::string &buf) {
+  while (x >= 0x80) {
+    buf.push_back((char)(x | 0x80));
+    x >>= 7;
+  }
+  buf.push_back((char)x);
+}
+
+static void drawListSerRaw(const void *data, size_t n, std::string &buf) {
+  buf.append((const char *)data, n);
+}
+
+// Add the Strings in each element of [vCell] to the string table.
+static void drawListInternStrings(Cell vCell, const char **fieldTable, size_t nKinds,
+				  DrawListWriter &w) {
+  if (cellIsNilPtr(vCell)) {
+    return;
+  }
+  int64_t n = vectorLength(vCell);
+  for (int64_t i = 0; i < n; ++i) {
+    Cell *fields = drawListItemFields(vectorGet(vCell, i), nKinds);
+    int64_t fieldIdx = 1;
+    for (const char *p = fieldTable[cellInt(fields[0])]; *p; ++p) {
+      if (*p >= '0' && *p <= '9') {
+	continue;
+      }
+      Cell cell = fields[fieldIdx++];
+      if (*p != 's' || cellIsNilPtr(cell)) {
+	continue;
+      }
+      int64_t length = stringByteLength(cell);
+      std::string s((const char *)stringData(cell), (size_t)length);
+      if (w.stringIndex.emplace(s, (int64_t)w.stringIndex.size()).second) {
+	drawListSerVarint((uint64_t)length, w.stringTable);
+	w.stringTable.append(s);
+      }
+    }
+  }
+}
+
+static void drawListSerPath(Cell pathCell, std::string &buf) {
+  if (cellIsNilPtr(pathCell)) {
+    buf.push_back(0);
+    return;
+  }
+  Path *path = (Path *)cellHeapPtr(pathCell);
+  int64_t length = cellInt(path->length);
+  drawListSerVarint((uint64_t)length + 1, buf);
+  buf.push_back((char)cellInt(path->state));
+  float currentX = cellFloat(path->currentX);
+  float currentY = cellFloat(path->currentY);
+  drawListSerRaw(&currentX, sizeof(float), buf);
+  drawListSerRaw(&currentY, sizeof(float), buf);
+  if (length > 0) {
+    PathFlagsData *flagsData = (PathFlagsData *)cellHeapPtr(path->flags);
+    PathXYData *xyData = (PathXYData *)cellHeapPtr(path->xy);
+    drawListSerRaw(flagsData->data, (size_t)length, buf);
+    drawListSerRaw(xyData->data, (size_t)length * 2 * sizeof(float), buf);
+  }
+}
+
+// Write the record for the varstruct in [itemCell] to [w.buf]. This
+// doesn't allocate on the heap, so it never triggers GC.
+static void drawListSerItem(Cell itemCell, const char **fieldTable, size_t nKinds,
+			    DrawListWriter &w) {
+  Cell *fields = drawListItemFields(itemCell, nKinds);
+  int64_t id = cellInt(fields[0]);
+  std::string &payload = w.payload;
+  payload.clear();
+  int64_t fieldIdx = 1;
+  for (const char *p = fieldTable[id]; *p; ++p) {
+    Cell cell = fields[fieldIdx++];
+    switch (*p) {
+    case 'f': {
+      float x = cellFloat(cell);
+      drawListSerRaw(&x, sizeof(float), payload);
+      break;
+    }
+    case 'c': {
+      uint32_t x = (uint32_t)cellInt(cell);
+      drawListSerRaw(&x, sizeof(uint32_t), payload);
+      break;
+    }
+    case 'e':
+      drawListSerVarint((uint64_t)cellInt(cell), payload);
+      ++p;
+      break;
+    case 'b':
+      payload.push_back(cellBool(cell) ? 1 : 0);
+      break;
+    case 's':
+      if (cellIsNilPtr(cell)) {
+	payload.push_back(0);
+      } else {
+	std::string s((const char *)stringData(cell), (size_t)stringByteLength(cell));
+	drawListSerVarint((uint64_t)w.stringIndex[s] + 1, payload);
+      }
+      break;
+    case 'm':
+      if (cellIsNilPtr(cell)) {
+	payload.push_back(0);
+      } else {
+	Matrix *mat = (Matrix *)cellHeapPtr(cell);
+	float m[6] = {
+	  cellFloat(mat->a), cellFloat(mat->b), cellFloat(mat->c),
+	  cellFloat(mat->d), cellFloat(mat->tx), cellFloat(mat->ty)
+	};
+	payload.push_back(1);
+	drawListSerRaw(m, sizeof(m), payload);
+      }
+      break;
+    case 'p':
+      drawListSerPath(cell, payload);
+      break;
+    }
+  }
+  w.buf.push_back((char)id);
+  drawListSerVarint((uint64_t)payload.size(), w.buf);
+  w.buf.append(payload);
+}
+
+// serDrawListBinary(list: DrawList, out: StringBuf)
+static NativeFuncDefn(runtime_serDrawListBinary_8DrawListT) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsHeapPtr(engine.arg(0)) ||
+      !cellIsHeapPtr(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &listCell = engine.arg(0);
+  Cell &outCell = engine.arg(1);
+
+  DrawList *list = (DrawList *)cellHeapPtr(listCell);
+  engine.failOnNilPtr(list);
+
+  //--- header and string table
+  DrawListWriter w;
+  drawListInternStrings(list->resources, drawListResourceFields, drawListNResourceKinds, w);
+  drawListInternStrings(list->ops, drawListOpFields, drawListNOpKinds, w);
+  drawListSerRaw(drawListMagic, sizeof(drawListMagic), w.buf);
+  w.buf.push_back(drawListVersion);
+  drawListSerVarint((uint64_t)w.stringIndex.size(), w.buf);
+  w.buf.append(w.stringTable);
+  w.stringTable.clear();
+
+  //--- resources
+  if (cellIsNilPtr(list->resources)) {
+    w.buf.push_back(0);
+  } else {
+    int64_t n = vectorLength(list->resources);
+    drawListSerVarint((uint64_t)n + 1, w.buf);
+    for (int64_t i = 0; i < n; ++i) {
+      drawListSerItem(vectorGet(list->resources, i),
+		      drawListResourceFields, drawListNResourceKinds, w);
+    }
+  }
+
+  //--- ops
+  if (cellIsNilPtr(list->ops)) {
+    w.buf.push_back(0);
+  } else {
+    int64_t n = vectorLength(list->ops);
+    drawListSerVarint((uint64_t)n + 1, w.buf);
+    for (int64_t i = 0; i < n; ++i) {
+      // the list can move each time [w.buf] is flushed
+      list = (DrawList *)cellHeapPtr(listCell);
+      drawListSerItem(vectorGet(list->ops, i), drawListOpFields, drawListNOpKinds, w);
+      if (w.buf.size() >= drawListFlushSize) {
+	// NB: this may trigger GC
+	stringBufAppend(outCell, (uint8_t *)w.buf.data(), (int64_t)w.buf.size(), engine);
+	w.buf.clear();
+      }
+    }
+  }
+
+  // NB: this may trigger GC
+  stringBufAppend(outCell, (uint8_t *)w.buf.data(), (int64_t)w.buf.size(), engine);
+
+  engine.push(cellMakeInt(0));
+}
+
+//------------------------------------------------------------------------
+// reader
+//------------------------------------------------------------------------
+
+// Reads from a StringBuf. The StringBuf's data can move during GC, so
+// this holds on to the StringBuf cell (which must be visible to the
+// GC), and looks up the data pointer on each access.
+struct DrawListReader {
+  Cell &inCell;
+  int64_t pos;
+  int64_t end;
+
+  DrawListReader(Cell &aInCell): inCell(aInCell) {
+    pos = 0;
+    end = stringBufLength(inCell);
+  }
+
+  const uint8_t *data() {
+    return stringBufData(inCell) + pos;
+  }
+
+  bool readRaw(void *dest, int64_t n) {
+    if (pos > end - n) {
+      return false;
+    }
+    memcpy(dest, data(), n);
+    pos += n;
+    return true;
+  }
+
+  bool readByte(uint8_t &x) {
+    return readRaw(&x, 1);
+  }
+
+  bool readVarint(uint64_t &x) {
+    const uint8_t *p = data();
+    x = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      if (pos >= end) {
+	return false;
+      }
+      uint8_t byte = *p++;
+      ++pos;
+      x |= (uint64_t)(byte & 0x7f) << shift;
+      if (!(byte & 0x80)) {
+	return true;
+      }
+    }
+    return false;
+  }
+
+  // Read a count, encoded as varint(n + 1), with zero meaning nil.
+  // Each element takes at least [elemSize] bytes, so a count that
+  // doesn't fit in the remaining data is an error.
+  bool readCount(int64_t &n, bool &nil, int64_t elemSize) {
+    uint64_t u;
+    if (!readVarint(u)) {
+      return false;
+    }
+    nil = u == 0;
+    n = nil ? 0 : (int64_t)(u - 1);
+    return u <= (uint64_t)((end - pos) / elemSize) + 1;
+  }
+};
+
+// Check that [flags] is a valid sequence of moveTo, lineTo, and
+// (3-point) curveTo points, so the path accessors and the renderer
+// won't run off the end of the path.
+static bool drawListCheckPathFlags(const uint8_t *flags, int64_t length) {
+  int64_t i = 0;
+  while (i < length) {
+    uint8_t f = flags[i];
+    if (f & ~(pathFlagKindMask | pathFlagClose)) {
+      return false;
+    }
+    uint8_t kind = f & pathFlagKindMask;
+    if (kind == pathFlagMoveTo) {
+      if (f & pathFlagClose) {
+	return false;
+      }
+      ++i;
+    } else if (kind == pathFlagLineTo) {
+      ++i;
+    } else if (kind == pathFlagCurveTo) {
+      if (i > length - 3 ||
+	  (f & pathFlagClose) ||
+	  flags[i+1] != pathFlagCurveTo ||
+	  (flags[i+2] & pathFlagKindMask) != pathFlagCurveTo) {
+	return false;
+      }
+      i += 3;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Read a Matrix into [result], which must be visible to the GC.
+// NB: this may trigger GC
+static bool drawListDeserMatrix(DrawListReader &in, Cell &result, BytecodeEngine &engine) {
+  uint8_t present;
+  if (!in.readByte(present) || present > 1) {
+    return false;
+  }
+  if (!present) {
+    result = cellMakeNilHeapPtr();
+    return true;
+  }
+  float m[6];
+  if (!in.readRaw(m, sizeof(m))) {
+    return false;
+  }
+  // NB: this may trigger GC
+  Matrix *mat = (Matrix *)engine.heapAllocTuple(matrixNCells, 0);
+  mat->a = cellMakeFloat(m[0]);
+  mat->b = cellMakeFloat(m[1]);
+  mat->c = cellMakeFloat(m[2]);
+  mat->d = cellMakeFloat(m[3]);
+  mat->tx = cellMakeFloat(m[4]);
+  mat->ty = cellMakeFloat(m[5]);
+  result = cellMakeHeapPtr(mat);
+  return true;
+}
+
+// Read a Path into [result], which must be visible to the GC. The xy
+// and flags blobs are allocated at their final size, and filled
+// directly from the input.
+// NB: this may trigger GC
+static bool drawListDeserPath(DrawListReader &in, Cell &result, BytecodeEngine &engine) {
+  int64_t length;
+  bool nil;
+  if (!in.readCount(length, nil, 1 + 2 * sizeof(float))) {
+    return false;
+  }
+  if (nil) {
+    result = cellMakeNilHeapPtr();
+    return true;
+  }
+  uint8_t state;
+  float currentX, currentY;
+  if (!in.readByte(state) || state > pathStateOpen ||
+      !in.readRaw(&currentX, sizeof(float)) ||
+      !in.readRaw(&currentY, sizeof(float))) {
+    return false;
+  }
+  if (in.end - in.pos < length * (int64_t)(1 + 2 * sizeof(float)) ||
+      !drawListCheckPathFlags(in.data(), length)) {
+    return false;
+  }
+
+  // NB: this may trigger GC
+  Path *path = (Path *)engine.heapAllocTuple(pathNCells, 0);
+  path->state = cellMakeInt(state);
+  path->currentX = cellMakeFloat(currentX);
+  path->currentY = cellMakeFloat(currentY);
+  path->xy = cellMakeNilHeapPtr();
+  path->flags = cellMakeNilHeapPtr();
+  path->length = cellMakeInt(0);
+  result = cellMakeHeapPtr(path);
+
+  if (length > 0) {
+    // NB: this may trigger GC
+    Cell xyCell = cellMakeHeapPtr(engine.heapAllocBlob(length * 2 * sizeof(float), 0));
+    engine.pushGCRoot(xyCell);
+    // NB: this may trigger GC
+    Cell flagsCell = cellMakeHeapPtr(engine.heapAllocBlob(length, 0));
+    engine.pushGCRoot(flagsCell);
+    PathFlagsData *flagsData = (PathFlagsData *)cellHeapPtr(flagsCell);
+    PathXYData *xyData = (PathXYData *)cellHeapPtr(xyCell);
+    in.readRaw(flagsData->data, length);
+    in.readRaw(xyData->data, length * 2 * sizeof(float));
+    path = (Path *)cellHeapPtr(result);
+    path->xy = xyCell;
+    path->flags = flagsCell;
+    path->length = cellMakeInt(length);
+    engine.popGCRoot(flagsCell);
+    engine.popGCRoot(xyCell);
+  }
+  return true;
+}
+
+// Read a record, and build the varstruct it describes in [result],
+// which must be visible to the GC. [stringsCell] is the string table
+// (a Vector[String]).
+// NB: this may trigger GC
+static bool drawListDeserItem(DrawListReader &in, const char **fieldTable, size_t nKinds,
+			      Cell &stringsCell, Cell &result, BytecodeEngine &engine) {
+  uint8_t id;
+  uint64_t payloadLength;
+  if (!in.readByte(id) || id >= nKinds ||
+      !in.readVarint(payloadLength) || payloadLength > (uint64_t)(in.end - in.pos)) {
+    return false;
+  }
+  int64_t recordEnd = in.pos + (int64_t)payloadLength;
+  const char *fields = fieldTable[id];
+
+  int64_t nCells = 1 + drawListNFields(fields);
+  // NB: this may trigger GC
+  Cell *tuple = (Cell *)engine.heapAllocTuple((uint64_t)nCells, 0);
+  tuple[1] = cellMakeInt(id);
+  for (int64_t i = 1; i < nCells; ++i) {
+    tuple[1 + i] = cellMakeInt(0);
+  }
+  result = cellMakeHeapPtr(tuple);
+
+  Cell fieldCell = cellMakeNilHeapPtr();
+  engine.pushGCRoot(fieldCell);
+  bool ok = true;
+  int64_t fieldIdx = 1;
+  for (const char *p = fields; *p && ok; ++p) {
+    switch (*p) {
+    case 'f': {
+      float x = 0;
+      ok = in.readRaw(&x, sizeof(float));
+      fieldCell = cellMakeFloat(x);
+      break;
+    }
+    case 'c': {
+      uint32_t x = 0;
+      ok = in.readRaw(&x, sizeof(uint32_t));
+      fieldCell = cellMakeInt(x);
+      break;
+    }
+    case 'e': {
+      uint64_t x = 0;
+      uint64_t nValues = (uint64_t)(*++p - '0');
+      ok = in.readVarint(x) && x < nValues;
+      fieldCell = cellMakeInt((int64_t)x);
+      break;
+    }
+    case 'b': {
+      uint8_t x = 0;
+      ok = in.readByte(x) && x <= 1;
+      fieldCell = cellMakeBool(x != 0);
+      break;
+    }
+    case 's': {
+      uint64_t x;
+      ok = in.readVarint(x) && x <= (uint64_t)vectorLength(stringsCell);
+      if (ok) {
+	fieldCell = (x == 0) ? cellMakeNilHeapPtr() : vectorGet(stringsCell, (int64_t)x - 1);
+      }
+      break;
+    }
+    case 'm':
+      // NB: this may trigger GC
+      ok = drawListDeserMatrix(in, fieldCell, engine);
+      break;
+    case 'p':
+      // NB: this may trigger GC
+      ok = drawListDeserPath(in, fieldCell, engine);
+      break;
+    }
+    if (ok) {
+      tuple = (Cell *)cellHeapPtr(result);
+      tuple[1 + fieldIdx] = fieldCell;
+    }
+    ++fieldIdx;
+  }
+  engine.popGCRoot(fieldCell);
+  return ok && in.pos == recordEnd;
+}
+
+// Read a Vector of records into [result], which must be visible to
+// the GC.
+// NB: this may trigger GC
+static bool drawListDeserVector(DrawListReader &in, const char **fieldTable, size_t nKinds,
+				Cell &stringsCell, Cell &result, BytecodeEngine &engine) {
+  int64_t n;
+  bool nil;
+  // each record is at least 2 bytes (ID and payload length)
+  if (!in.readCount(n, nil, 2)) {
+    return false;
+  }
+  if (nil) {
+    result = cellMakeNilHeapPtr();
+    return true;
+  }
+  // NB: this may trigger GC
+  result = vectorMake(engine);
+  Cell itemCell = cellMakeNilHeapPtr();
+  engine.pushGCRoot(itemCell);
+  bool ok = true;
+  for (int64_t i = 0; i < n && ok; ++i) {
+    // NB: this may trigger GC
+    ok = drawListDeserItem(in, fieldTable, nKinds, stringsCell, itemCell, engine);
+    if (ok) {
+      // NB: this may trigger GC
+      vectorAppend(result, itemCell, engine);
+    }
+  }
+  engine.popGCRoot(itemCell);
+  return ok;
+}
+
+// Read the string table into [stringsCell] (a Vector[String]), which
+// must be visible to the GC.
+// NB: this may trigger GC
+static bool drawListDeserStrings(DrawListReader &in, Cell &stringsCell, BytecodeEngine &engine) {
+  uint64_t n;
+  if (!in.readVarint(n) || n > (uint64_t)(in.end - in.pos)) {
+    return false;
+  }
+  Cell sCell = cellMakeNilHeapPtr();
+  engine.pushGCRoot(sCell);
+  bool ok = true;
+  for (uint64_t i = 0; i < n && ok; ++i) {
+    uint64_t length;
+    ok = in.readVarint(length) && length <= (uint64_t)(in.end - in.pos);
+    if (ok) {
+      // NB: this may trigger GC
+      sCell = stringAlloc((int64_t)length, engine);
+      in.readRaw(stringData(sCell), (int64_t)length);
+      // NB: this may trigger GC
+      vectorAppend(stringsCell, sCell, engine);
+    }
+  }
+  engine.popGCRoot(sCell);
+  return ok;
+}
+
+// deserDrawListBinary(in: StringBuf) -> Result[DrawList]
+static NativeFuncDefn(runtime_deserDrawListBinary_T) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsHeapPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &inCell = engine.arg(0);
+
+  DrawListReader in(inCell);
+  char magic[sizeof(drawListMagic)];
+  uint8_t version;
+  if (!in.readRaw(magic, sizeof(magic)) ||
+      memcmp(magic, drawListMagic, sizeof(magic)) ||
+      !in.readByte(version) || version != drawListVersion) {
+    engine.push(cellMakeError());
+    return;
+  }
+
+  // NB: this may trigger GC
+  Cell stringsCell = vectorMake(engine);
+  engine.pushGCRoot(stringsCell);
+  Cell resourcesCell = cellMakeNilHeapPtr();
+  engine.pushGCRoot(resourcesCell);
+  Cell opsCell = cellMakeNilHeapPtr();
+  engine.pushGCRoot(opsCell);
+
+  // NB: these may trigger GC
+  bool ok = drawListDeserStrings(in, stringsCell, engine) &&
+            drawListDeserVector(in, drawListResourceFields, drawListNResourceKinds,
+				stringsCell, resourcesCell, engine) &&
+            drawListDeserVector(in, drawListOpFields, drawListNOpKinds,
+				stringsCell, opsCell, engine) &&
+            in.pos == in.end;
+
+  Cell result = cellMakeError();
+  if (ok) {
+    // NB: this may trigger GC
+    DrawList *list = (DrawList *)engine.heapAllocTuple(drawListNCells, 0);
+    list->resources = resourcesCell;
+    list->ops = opsCell;
+    result = cellMakeHeapPtr(list);
+  }
+  engine.popGCRoot(opsCell);
+  engine.popGCRoot(resourcesCell);
+  engine.popGCRoot(stringsCell);
+
+  engine.push(result);
+}
+
+//------------------------------------------------------------------------
+
+void runtime_drawlist_init(BytecodeEngine &engine) {
+  engine.addNativeFunction("serDrawListBinary_8DrawListT", &runtime_serDrawListBinary_8DrawListT);
+  engine.addNativeFunction("deserDrawListBinary_T", &runtime_deserDrawListBinary_T);
+}
@@ -0,0 +1,19 @@
+//========================================================================
+//
+// runtime_drawlist.h
+//
+// Runtime library: binary DrawList encoding.
+//
+// Part of the Haxonite project, under the MIT License.
+// Copyright 2025 Derek Noonburg
+//
+//========================================================================
+
+#ifndef runtime_drawlist_h
+#define runtime_drawlist_h
+
+#include "BytecodeEngine.h"
+
+extern void runtime_drawlist_init(BytecodeEngine &engine);
+
+#endif // runtime_drawlist_h
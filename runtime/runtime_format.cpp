@@ -9,41 +9,67 @@
 
 #include "runtime_format.h"
 #include <string.h>
+#include <vector>
+#include "BytecodeDefs.h"
 #include "NumConversion.h"
 #include "UTF8.h"
 #include "runtime_String.h"
 
-// Create a string on the heap, using [length] bytes of [s].  If
-// [width] is non-negative, [s] is right-justified (with space chars)
-// in a field of [width]. If [width] is negative, [s] is
-// left-justified in a field of -[width]. The resulting string is
-// pushed onto the stack.
-static void formatWidth(const char *s, size_t length, int64_t width, BytecodeEngine &engine) {
-  bool left;
-  int64_t ww;
-  if (width < 0) {
-    left = true;
-    ww = -width;
+// Return the length of a field of [width] containing [length]
+// bytes. See formatWidthCopy.
+static int64_t formatWidthLength(int64_t length, int64_t width) {
+  int64_t ww = (width < 0) ? -width : width;
+  return (length >= ww) ? length : ww;
+}
+
+// Copy [length] bytes of [s] to [out]. If [width] is non-negative,
+// [s] is right-justified (with space chars) in a field of [width]. If
+// [width] is negative, [s] is left-justified in a field of
+// -[width]. Writes formatWidthLength([length], [width]) bytes.
+static void formatWidthCopy(const uint8_t *s, int64_t length, int64_t width, uint8_t *out) {
+  int64_t ww = formatWidthLength(length, width);
+  if (length == ww) {
+    memcpy(out, s, length);
+  } else if (width < 0) {
+    memcpy(out, s, length);
+    memset(out + length, 0x20, ww - length);
   } else {
-    left = false;
-    ww = width;
-  }
-  if (length >= ww) {
-    ww = length;
+    memset(out, 0x20, ww - length);
+    memcpy(out + ww - length, s, length);
   }
+}
+
+// Create a string on the heap, using [length] bytes of [s], justified
+// in a field of [width] (see formatWidthCopy). The resulting string
+// is pushed onto the stack.
+static void formatWidth(const char *s, size_t length, int64_t width, BytecodeEngine &engine) {
   // NB: this may trigger GC.
-  Cell outCell = stringAlloc(ww, engine);
+  Cell outCell = stringAlloc(formatWidthLength((int64_t)length, width), engine);
   engine.push(outCell);
-  uint8_t *outData = stringData(outCell);
-  if (length == ww) {
-    memcpy(outData, s, length);
-  } else if (left) {
-    memcpy(outData, s, length);
-    memset(outData + length, 0x20, ww - length);
+  formatWidthCopy((const uint8_t *)s, (int64_t)length, width, stringData(outCell));
+}
+
+// Format an Int (without the field width).
+static std::string formatInt(int64_t x, int64_t precision, int64_t format) {
+  if (format == 'c') {
+    uint8_t u[utf8MaxBytes];
+    int uLen = utf8Encode((uint32_t)x, u);
+    if (uLen > 0) {
+      return std::string((char *)u, uLen);
+    }
+    return "";
+  }
+  int radix;
+  if (format == 'b') {
+    radix = 2;
+  } else if (format == 'o') {
+    radix = 8;
+  } else if (format == 'x') {
+    radix = 16;
   } else {
-    memset(outData, 0x20, ww - length);
-    memcpy(outData + ww - length, s, length);
+    radix = 10;
   }
+  return int56ToString(x, radix, (int)precision);
 }
 
 // format(x: Int, width: Int, precision: Int, format: Int) -> String
@@ -66,26 +92,7 @@ static NativeFuncDefn(runtime_format_IIII) {
   int64_t precision = cellInt(precisionCell);
   int64_t format = cellInt(formatCell);
 
-  std::string s;
-  if (format == 'c') {
-    uint8_t u[utf8MaxBytes];
-    int uLen = utf8Encode((uint32_t)x, u);
-    if (uLen > 0) {
-      s = std::string((char *)u, uLen);
-    }
-  } else {
-    int radix;
-    if (format == 'b') {
-      radix = 2;
-    } else if (format == 'o') {
-      radix = 8;
-    } else if (format == 'x') {
-      radix = 16;
-    } else {
-      radix = 10;
-    }
-    s = int56ToString(x, radix, (int)precision);
-  }
+  std::string s = formatInt(x, precision, format);
   formatWidth(s.c_str(), s.size(), width, engine);
 }
 
@@ -113,6 +120,30 @@ static NativeFuncDefn(runtime_format_FIII) {
   formatWidth(s.c_str(), s.size(), width, engine);
 }
 
+// format(x: Double, width: Int, precision: Int, format: Int) -> String
+static NativeFuncDefn(runtime_format_DIII) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 4 ||
+      !cellIsDouble(engine.arg(0)) ||
+      !cellIsInt(engine.arg(1)) ||
+      !cellIsInt(engine.arg(2)) ||
+      !cellIsInt(engine.arg(3))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &xCell = engine.arg(0);
+  Cell &widthCell = engine.arg(1);
+  Cell &precisionCell = engine.arg(2);
+  Cell &formatCell = engine.arg(3);
+  double x = cellDouble(xCell);
+  int64_t width = cellInt(widthCell);
+  int64_t precision = cellInt(precisionCell);
+  int64_t format = cellInt(formatCell);
+
+  std::string s = doubleToString(x, (uint8_t)format, (int)precision);
+  formatWidth(s.c_str(), s.size(), width, engine);
+}
+
 // format(x: Bool, width: Int, precision: Int, format: Int) -> String
 static NativeFuncDefn(runtime_format_BIII) {
 #if CHECK_RUNTIME_FUNC_ARGS
@@ -167,9 +198,97 @@ static NativeFuncDefn(runtime_format_SIII) {
   formatWidth(s.c_str(), n, width, engine);
 }
 
+// _interp(x1: Int|Float|Double|Bool|String, width1: Int, precision1: Int, format1: Int,
+//         x2: ..., ...) -> String
+// Builds an interpolated string. Each part is four args, as for the
+// format functions; literal chars are passed as String parts with
+// width=0, precision=-1, format=0. All of the parts are formatted
+// into a single string allocation.
+static NativeFuncDefn(runtime_interp) {
+  int nParts = engine.nArgs() / 4;
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() % 4 != 0) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+  for (int i = 0; i < nParts; ++i) {
+    Cell &xCell = engine.arg(4*i);
+    if (!(cellIsInt(xCell) || cellIsFloat(xCell) || cellIsBool(xCell) || cellIsPtr(xCell)) ||
+	!cellIsInt(engine.arg(4*i + 1)) ||
+	!cellIsInt(engine.arg(4*i + 2)) ||
+	!cellIsInt(engine.arg(4*i + 3))) {
+      BytecodeEngine::fatalError("Invalid argument");
+    }
+  }
+#endif
+
+  // format the non-String parts, and compute the total length
+  std::vector<std::string> formatted(nParts);
+  int64_t totalLength = 0;
+  for (int i = 0; i < nParts; ++i) {
+    Cell &xCell = engine.arg(4*i);
+    int64_t width = cellInt(engine.arg(4*i + 1));
+    int64_t precision = cellInt(engine.arg(4*i + 2));
+    int64_t format = cellInt(engine.arg(4*i + 3));
+    int64_t length;
+    if (cellIsInt(xCell)) {
+      formatted[i] = formatInt(cellInt(xCell), precision, format);
+      length = (int64_t)formatted[i].size();
+    } else if (cellIsFloat(xCell)) {
+      formatted[i] = floatToString(cellFloat(xCell), (uint8_t)format, (int)precision);
+      length = (int64_t)formatted[i].size();
+    } else if (cellIsDouble(xCell)) {
+      formatted[i] = doubleToString(cellDouble(xCell), (uint8_t)format, (int)precision);
+      length = (int64_t)formatted[i].size();
+    } else if (cellIsBool(xCell)) {
+      formatted[i] = cellBool(xCell) ? "true" : "false";
+      length = (int64_t)formatted[i].size();
+    } else {
+      length = stringByteLength(xCell);
+      if (precision >= 0 && length > precision) {
+	length = precision;
+      }
+    }
+    length = formatWidthLength(length, width);
+    if (length > bytecodeMaxInt - totalLength) {
+      BytecodeEngine::fatalError("Integer overflow");
+    }
+    totalLength += length;
+  }
+
+  // NB: this may trigger GC
+  Cell outCell = stringAlloc(totalLength, engine);
+
+  // copy the parts into the output string -- the String args are
+  // re-read here, because GC may have moved them
+  uint8_t *out = stringData(outCell);
+  for (int i = 0; i < nParts; ++i) {
+    Cell &xCell = engine.arg(4*i);
+    int64_t width = cellInt(engine.arg(4*i + 1));
+    int64_t precision = cellInt(engine.arg(4*i + 2));
+    const uint8_t *data;
+    int64_t length;
+    if (cellIsPtr(xCell) && !cellIsDouble(xCell)) {
+      data = stringData(xCell);
+      length = stringByteLength(xCell);
+      if (precision >= 0 && length > precision) {
+	length = precision;
+      }
+    } else {
+      data = (const uint8_t *)formatted[i].c_str();
+      length = (int64_t)formatted[i].size();
+    }
+    formatWidthCopy(data, length, width, out);
+    out += formatWidthLength(length, width);
+  }
+
+  engine.push(outCell);
+}
+
 void runtime_format_init(BytecodeEngine &engine) {
   engine.addNativeFunction("format_IIII", &runtime_format_IIII);
   engine.addNativeFunction("format_FIII", &runtime_format_FIII);
+  engine.addNativeFunction("format_DIII", &runtime_format_DIII);
   engine.addNativeFunction("format_BIII", &runtime_format_BIII);
   engine.addNativeFunction("format_SIII", &runtime_format_SIII);
+  engine.addNativeFunction("_interp", &runtime_interp);
 }
@@ -325,6 +325,325 @@ static NativeFuncDefn(runtime_atan2_FF) {
   engine.push(cellMakeFloat(atan2f(cellFloat(yCell), cellFloat(xCell))));
 }
 
+//------------------------------------------------------------------------
+// Double
+//------------------------------------------------------------------------
+
+// toDouble(x: Int) -> Double
+static NativeFuncDefn(runtime_toDouble_I) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsInt(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &xCell = engine.arg(0);
+  // NB: this may trigger GC
+  engine.push(engine.heapAllocDouble((double)cellInt(xCell)));
+}
+
+// toDouble(x: Float) -> Double
+static NativeFuncDefn(runtime_toDouble_F) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsFloat(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &xCell = engine.arg(0);
+  // NB: this may trigger GC
+  engine.push(engine.heapAllocDouble((double)cellFloat(xCell)));
+}
+
+// toFloat(x: Double) -> Float
+static NativeFuncDefn(runtime_toFloat_D) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsDouble(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &xCell = engine.arg(0);
+  engine.push(cellMakeFloat((float)cellDouble(xCell)));
+}
+
+// ceil(x: Double) -> Double
+static NativeFuncDefn(runtime_ceil_D) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsDouble(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &xCell = engine.arg(0);
+  // NB: this may trigger GC
+  engine.push(engine.heapAllocDouble(ceil(cellDouble(xCell))));
+}
+
+// floor(x: Double) -> Double
+static NativeFuncDefn(runtime_floor_D) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsDouble(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &xCell = engine.arg(0);
+  // NB: this may trigger GC
+  engine.push(engine.heapAllocDouble(floor(cellDouble(xCell))));
+}
+
+// round(x: Double) -> Double
+static NativeFuncDefn(runtime_round_D) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsDouble(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &xCell = engine.arg(0);
+  // NB: this may trigger GC
+  engine.push(engine.heapAllocDouble(round(cellDouble(xCell))));
+}
+
+// ceili(x: Double) -> Int
+static NativeFuncDefn(runtime_ceili_D) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsDouble(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &xCell = engine.arg(0);
+  double t = ceil(cellDouble(xCell));
+  if (t > (double)bytecodeMaxInt || t < (double)bytecodeMinInt) {
+    BytecodeEngine::fatalError("Integer overflow");
+  }
+  engine.push(cellMakeInt((int64_t)t));
+}
+
+// floori(x: Double) -> Int
+static NativeFuncDefn(runtime_floori_D) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsDouble(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &xCell = engine.arg(0);
+  double t = floor(cellDouble(xCell));
+  if (t > (double)bytecodeMaxInt || t < (double)bytecodeMinInt) {
+    BytecodeEngine::fatalError("Integer overflow");
+  }
+  engine.push(cellMakeInt((int64_t)t));
+}
+
+// roundi(x: Double) -> Int
+static NativeFuncDefn(runtime_roundi_D) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsDouble(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &xCell = engine.arg(0);
+  double t = round(cellDouble(xCell));
+  if (t > (double)bytecodeMaxInt || t < (double)bytecodeMinInt) {
+    BytecodeEngine::fatalError("Integer overflow");
+  }
+  engine.push(cellMakeInt((int64_t)t));
+}
+
+// min(x: Double, y: Double) -> Double
+static NativeFuncDefn(runtime_min_DD) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsDouble(engine.arg(0)) ||
+      !cellIsDouble(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &xCell = engine.arg(0);
+  Cell &yCell = engine.arg(1);
+  // NB: this may trigger GC
+  engine.push(engine.heapAllocDouble(std::min(cellDouble(xCell), cellDouble(yCell))));
+}
+
+// max(x: Double, y: Double) -> Double
+static NativeFuncDefn(runtime_max_DD) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsDouble(engine.arg(0)) ||
+      !cellIsDouble(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &xCell = engine.arg(0);
+  Cell &yCell = engine.arg(1);
+  // NB: this may trigger GC
+  engine.push(engine.heapAllocDouble(std::max(cellDouble(xCell), cellDouble(yCell))));
+}
+
+// abs(x: Double) -> Double
+static NativeFuncDefn(runtime_abs_D) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsDouble(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &xCell = engine.arg(0);
+  // NB: this may trigger GC
+  engine.push(engine.heapAllocDouble(fabs(cellDouble(xCell))));
+}
+
+// sqrt(x: Double) -> Double
+static NativeFuncDefn(runtime_sqrt_D) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsDouble(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &xCell = engine.arg(0);
+  // NB: this may trigger GC
+  engine.push(engine.heapAllocDouble(sqrt(cellDouble(xCell))));
+}
+
+// pow(x: Double, y: Double) -> Double
+static NativeFuncDefn(runtime_pow_DD) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsDouble(engine.arg(0)) ||
+      !cellIsDouble(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &xCell = engine.arg(0);
+  Cell &yCell = engine.arg(1);
+  // NB: this may trigger GC
+  engine.push(engine.heapAllocDouble(pow(cellDouble(xCell), cellDouble(yCell))));
+}
+
+// exp(x: Double) -> Double
+static NativeFuncDefn(runtime_exp_D) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsDouble(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &xCell = engine.arg(0);
+  // NB: this may trigger GC
+  engine.push(engine.heapAllocDouble(exp(cellDouble(xCell))));
+}
+
+// log(x: Double) -> Double
+static NativeFuncDefn(runtime_log_D) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsDouble(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &xCell = engine.arg(0);
+  // NB: this may trigger GC
+  engine.push(engine.heapAllocDouble(log(cellDouble(xCell))));
+}
+
+// log10(x: Double) -> Double
+static NativeFuncDefn(runtime_log10_D) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsDouble(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &xCell = engine.arg(0);
+  // NB: this may trigger GC
+  engine.push(engine.heapAllocDouble(log10(cellDouble(xCell))));
+}
+
+// sin(x: Double) -> Double
+static NativeFuncDefn(runtime_sin_D) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsDouble(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &xCell = engine.arg(0);
+  // NB: this may trigger GC
+  engine.push(engine.heapAllocDouble(sin(cellDouble(xCell))));
+}
+
+// cos(x: Double) -> Double
+static NativeFuncDefn(runtime_cos_D) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsDouble(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &xCell = engine.arg(0);
+  // NB: this may trigger GC
+  engine.push(engine.heapAllocDouble(cos(cellDouble(xCell))));
+}
+
+// tan(x: Double) -> Double
+static NativeFuncDefn(runtime_tan_D) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsDouble(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &xCell = engine.arg(0);
+  // NB: this may trigger GC
+  engine.push(engine.heapAllocDouble(tan(cellDouble(xCell))));
+}
+
+// asin(x: Double) -> Double
+static NativeFuncDefn(runtime_asin_D) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsDouble(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &xCell = engine.arg(0);
+  // NB: this may trigger GC
+  engine.push(engine.heapAllocDouble(asin(cellDouble(xCell))));
+}
+
+// acos(x: Double) -> Double
+static NativeFuncDefn(runtime_acos_D) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsDouble(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &xCell = engine.arg(0);
+  // NB: this may trigger GC
+  engine.push(engine.heapAllocDouble(acos(cellDouble(xCell))));
+}
+
+// atan2(y: Double, x: Double) -> Double
+static NativeFuncDefn(runtime_atan2_DD) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsDouble(engine.arg(0)) ||
+      !cellIsDouble(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &yCell = engine.arg(0);
+  Cell &xCell = engine.arg(1);
+  // NB: this may trigger GC
+  engine.push(engine.heapAllocDouble(atan2(cellDouble(yCell), cellDouble(xCell))));
+}
+
 //------------------------------------------------------------------------
 
 void runtime_math_init(BytecodeEngine &engine) {
@@ -352,4 +671,27 @@ void runtime_math_init(BytecodeEngine &engine) {
   engine.addNativeFunction("asin_F", &runtime_asin_F);
   engine.addNativeFunction("acos_F", &runtime_acos_F);
   engine.addNativeFunction("atan2_FF", &runtime_atan2_FF);
+  engine.addNativeFunction("toDouble_I", &runtime_toDouble_I);
+  engine.addNativeFunction("toDouble_F", &runtime_toDouble_F);
+  engine.addNativeFunction("toFloat_D", &runtime_toFloat_D);
+  engine.addNativeFunction("ceil_D", &runtime_ceil_D);
+  engine.addNativeFunction("floor_D", &runtime_floor_D);
+  engine.addNativeFunction("round_D", &runtime_round_D);
+  engine.addNativeFunction("ceili_D", &runtime_ceili_D);
+  engine.addNativeFunction("floori_D", &runtime_floori_D);
+  engine.addNativeFunction("roundi_D", &runtime_roundi_D);
+  engine.addNativeFunction("min_DD", &runtime_min_DD);
+  engine.addNativeFunction("max_DD", &runtime_max_DD);
+  engine.addNativeFunction("abs_D", &runtime_abs_D);
+  engine.addNativeFunction("sqrt_D", &runtime_sqrt_D);
+  engine.addNativeFunction("pow_DD", &runtime_pow_DD);
+  engine.addNativeFunction("exp_D", &runtime_exp_D);
+  engine.addNativeFunction("log_D", &runtime_log_D);
+  engine.addNativeFunction("log10_D", &runtime_log10_D);
+  engine.addNativeFunction("sin_D", &runtime_sin_D);
+  engine.addNativeFunction("cos_D", &runtime_cos_D);
+  engine.addNativeFunction("tan_D", &runtime_tan_D);
+  engine.addNativeFunction("asin_D", &runtime_asin_D);
+  engine.addNativeFunction("acos_D", &runtime_acos_D);
+  engine.addNativeFunction("atan2_DD", &runtime_atan2_DD);
 }
@@ -0,0 +1,609 @@
+//========================================================================
+//
+// runtime_process.cpp
+//
+// Part of the Haxonite project, under the MIT License.
+// Copyright 2025 Derek Noonburg
+//
+//========================================================================
+
+#include "runtime_process.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "runtime_File.h"
+#include "runtime_String.h"
+#include "runtime_Vector.h"
+
+extern char **environ;
+
+//------------------------------------------------------------------------
+
+// for SpawnOptions.stdin/stdout/stderr
+#define redirectInherit 0
+#define redirectPipe    1
+#define redirectDiscard 2
+
+// Number of bytes to read from (or write to) a pipe at a time.
+#define processPipeChunkSize 65536
+
+//------------------------------------------------------------------------
+
+struct SpawnOptions {
+  uint64_t hdr;
+  Cell stdinRedirect;         // Int (Redirect)
+  Cell stdoutRedirect;        // Int (Redirect)
+  Cell stderrRedirect;        // Int (Redirect)
+  Cell input;                 // String
+};
+
+// The parent's ends of the pipes are non-blocking, and are serviced
+// (with poll) whenever the program checks on the process, so a child
+// never blocks on a full pipe for longer than that. Captured output
+// is accumulated here, outside the GC heap.
+struct ProcessResource {
+  ResourceObject resObj;
+  pid_t pid;
+  bool exited;
+  int status;                 // exit status, or -1 if killed by a signal
+  int inFD;                   // write end of the stdin pipe, or -1
+  int outFD;                  // read end of the stdout pipe, or -1
+  int errFD;                  // read end of the stderr pipe, or -1
+  std::string input;
+  size_t inputPos;
+  std::string output;
+  std::string errorOutput;
+};
+
+struct Process {
+  uint64_t hdr;
+  Cell processResource;       // resource pointer -> ProcessResource
+};
+
+#define processNCells (sizeof(Process) / sizeof(Cell) - 1)
+
+// Live Processes, by pid. runAll reaps any child, so if it reaps one
+// of these, it records the status here.
+static std::unordered_map<pid_t, ProcessResource*> liveProcesses;
+
+// Children of Processes that were finalized before the child exited.
+// These are reaped (without blocking) whenever the program spawns or
+// checks on a process, so they don't stay around as zombies.
+static std::vector<pid_t> orphanProcesses;
+
+//------------------------------------------------------------------------
+
+static bool commandArgs(Cell &commandCell, std::vector<std::string> &args);
+static pid_t spawnArgs(const std::vector<std::string> &args, posix_spawn_file_actions_t *actions);
+static bool makePipe(int fds[2], int parentIdx);
+static void closeFD(int &fd);
+static void finalizeProcess(ResourceObject *resObj);
+static ProcessResource *processResourceOf(Cell &pCell, BytecodeEngine &engine);
+static void servicePipes(ProcessResource *pr, int timeout);
+static void writeInput(ProcessResource *pr);
+static void readPipe(int &fd, std::string &out);
+static void reapProcess(ProcessResource *pr, bool block);
+static void forgetProcess(ProcessResource *pr);
+static void reapOrphans();
+static int exitStatus(int status);
+
+//------------------------------------------------------------------------
+
+// spawn(command: Vector[String], opts: SpawnOptions) -> Result[Process]
+static NativeFuncDefn(runtime_spawn_VS12SpawnOptions) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsHeapPtr(engine.arg(0)) ||
+      !cellIsHeapPtr(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &commandCell = engine.arg(0);
+  Cell &optsCell = engine.arg(1);
+
+  reapOrphans();
+
+  std::vector<std::string> args;
+  if (!commandArgs(commandCell, args)) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+  SpawnOptions *opts = (SpawnOptions *)cellHeapPtr(optsCell);
+  engine.failOnNilPtr(opts);
+  int64_t redirects[3] = {
+    cellInt(opts->stdinRedirect),
+    cellInt(opts->stdoutRedirect),
+    cellInt(opts->stderrRedirect)
+  };
+
+  //--- set up the pipes and file actions
+  int pipes[3][2] = {{-1, -1}, {-1, -1}, {-1, -1}};
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  bool ok = true;
+  for (int fd = 0; fd < 3 && ok; ++fd) {
+    if (redirects[fd] == redirectPipe) {
+      // the parent writes to stdin, and reads from stdout/stderr
+      int parentIdx = (fd == 0) ? 1 : 0;
+      ok = makePipe(pipes[fd], parentIdx) &&
+	   posix_spawn_file_actions_adddup2(&actions, pipes[fd][1 - parentIdx], fd) == 0;
+    } else if (redirects[fd] == redirectDiscard) {
+      ok = posix_spawn_file_actions_addopen(&actions, fd, "/dev/null",
+					    (fd == 0) ? O_RDONLY : O_WRONLY, 0) == 0;
+    } else if (redirects[fd] != redirectInherit) {
+      BytecodeEngine::fatalError("Invalid argument");
+    }
+  }
+
+  //--- start the child
+  pid_t pid = ok ? spawnArgs(args, &actions) : -1;
+  posix_spawn_file_actions_destroy(&actions);
+  closeFD(pipes[0][0]);
+  closeFD(pipes[1][1]);
+  closeFD(pipes[2][1]);
+  if (pid < 0) {
+    closeFD(pipes[0][1]);
+    closeFD(pipes[1][0]);
+    closeFD(pipes[2][0]);
+    engine.push(cellMakeError());
+    return;
+  }
+
+  ProcessResource *pr;
+  try {
+    pr = new ProcessResource();
+  } catch (std::bad_alloc) {
+    BytecodeEngine::fatalError("Out of memory");
+  }
+  pr->resObj.finalizer = &finalizeProcess;
+  pr->pid = pid;
+  pr->exited = false;
+  pr->status = -1;
+  pr->inFD = pipes[0][1];
+  pr->outFD = pipes[1][0];
+  pr->errFD = pipes[2][0];
+  if (pr->inFD >= 0) {
+    pr->input = stringToStdString(opts->input);
+  }
+  pr->inputPos = 0;
+  liveProcesses[pid] = pr;
+
+  // NB: this may trigger GC
+  Process *p = (Process *)engine.heapAllocTuple(processNCells, 0);
+  p->processResource = cellMakeResourcePtr(pr);
+  engine.addResourceObject(&pr->resObj);
+  engine.push(cellMakeHeapPtr(p));
+}
+
+// isDone(p: Process) -> Bool
+// Services the Process's pipes without blocking, and returns true if
+// the process has exited and its output pipes are closed.
+static NativeFuncDefn(runtime_isDone_7Process) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsHeapPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &pCell = engine.arg(0);
+
+  reapOrphans();
+
+  ProcessResource *pr = processResourceOf(pCell, engine);
+  servicePipes(pr, 0);
+  if (pr->outFD < 0 && pr->errFD < 0) {
+    reapProcess(pr, false);
+  }
+  engine.push(cellMakeBool(pr->exited && pr->outFD < 0 && pr->errFD < 0));
+}
+
+// wait(p: Process) -> Result[Int]
+// Feeds the input, collects the output, and waits for the process to
+// exit. Returns its exit status.
+static NativeFuncDefn(runtime_wait_7Process) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsHeapPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &pCell = engine.arg(0);
+
+  reapOrphans();
+
+  ProcessResource *pr = processResourceOf(pCell, engine);
+  while (pr->inFD >= 0 || pr->outFD >= 0 || pr->errFD >= 0) {
+    servicePipes(pr, -1);
+  }
+  reapProcess(pr, true);
+  if (pr->status < 0) {
+    engine.push(cellMakeError());
+  } else {
+    engine.push(cellMakeInt(pr->status));
+  }
+}
+
+// output(p: Process) -> String
+// Returns the stdout collected so far (if stdout is a pipe).
+static NativeFuncDefn(runtime_output_7Process) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsHeapPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &pCell = engine.arg(0);
+
+  ProcessResource *pr = processResourceOf(pCell, engine);
+  // NB: this may trigger GC
+  Cell sCell = stringMake((const uint8_t *)pr->output.data(), pr->output.size(), engine);
+  engine.push(sCell);
+}
+
+// errorOutput(p: Process) -> String
+// Returns the stderr collected so far (if stderr is a pipe).
+static NativeFuncDefn(runtime_errorOutput_7Process) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsHeapPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &pCell = engine.arg(0);
+
+  ProcessResource *pr = processResourceOf(pCell, engine);
+  // NB: this may trigger GC
+  Cell sCell = stringMake((const uint8_t *)pr->errorOutput.data(), pr->errorOutput.size(),
+			  engine);
+  engine.push(sCell);
+}
+
+// runAll(commands: Vector[Vector[String]], parallelism: Int) -> Vector[Int]
+// Runs the commands, with up to [parallelism] of them at a time,
+// sharing the caller's stdin/stdout/stderr. Returns the exit status
+// of each command, or -1 for a command that couldn't be started or
+// was killed by a signal.
+static NativeFuncDefn(runtime_runAll_VVSI) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsHeapPtr(engine.arg(0)) ||
+      !cellIsInt(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &commandsCell = engine.arg(0);
+  Cell &parallelismCell = engine.arg(1);
+
+  reapOrphans();
+
+  int64_t parallelism = cellInt(parallelismCell);
+  if (parallelism < 1) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+
+  // copy all of the args first -- nothing after this touches the heap
+  // until the results are built
+  int64_t n = vectorLength(commandsCell);
+  std::vector<std::vector<std::string>> commands(n);
+  for (int64_t i = 0; i < n; ++i) {
+    Cell commandCell = vectorGet(commandsCell, i);
+    if (!commandArgs(commandCell, commands[i])) {
+      BytecodeEngine::fatalError("Invalid argument");
+    }
+  }
+
+  std::vector<int64_t> results(n, -1);
+  std::unordered_map<pid_t, int64_t> running;
+  int64_t next = 0;
+  while (next < n || !running.empty()) {
+    while (next < n && (int64_t)running.size() < parallelism) {
+      pid_t pid = spawnArgs(commands[next], nullptr);
+      if (pid >= 0) {
+	running[pid] = next;
+      }
+      ++next;
+    }
+    if (running.empty()) {
+      continue;
+    }
+    int status;
+    pid_t pid = waitpid(-1, &status, 0);
+    if (pid < 0) {
+      if (errno == EINTR) {
+	continue;
+      }
+      break;
+    }
+    auto iter = running.find(pid);
+    if (iter != running.end()) {
+      results[iter->second] = exitStatus(status);
+      running.erase(iter);
+    } else {
+      // one of the program's own Processes, or an orphan
+      auto liveIter = liveProcesses.find(pid);
+      if (liveIter != liveProcesses.end()) {
+	liveIter->second->exited = true;
+	liveIter->second->status = exitStatus(status);
+	liveProcesses.erase(liveIter);
+      }
+      orphanProcesses.erase(std::remove(orphanProcesses.begin(), orphanProcesses.end(), pid),
+			    orphanProcesses.end());
+    }
+  }
+
+  // NB: this may trigger GC
+  engine.push(vectorMakeInt(results.data(), n, engine));
+}
+
+void runtime_process_init(BytecodeEngine &engine) {
+  engine.addNativeFunction("spawn_VS12SpawnOptions", &runtime_spawn_VS12SpawnOptions);
+  engine.addNativeFunction("isDone_7Process", &runtime_isDone_7Process);
+  engine.addNativeFunction("wait_7Process", &runtime_wait_7Process);
+  engine.addNativeFunction("output_7Process", &runtime_output_7Process);
+  engine.addNativeFunction("errorOutput_7Process", &runtime_errorOutput_7Process);
+  engine.addNativeFunction("runAll_VVSI", &runtime_runAll_VVSI);
+}
+
+//------------------------------------------------------------------------
+// support functions
+//------------------------------------------------------------------------
+
+pid_t spawnCommand(Cell &commandCell) {
+  std::vector<std::string> args;
+  if (!commandArgs(commandCell, args)) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+  return spawnArgs(args, nullptr);
+}
+
+int waitCommand(pid_t pid) {
+  int status;
+  while (waitpid(pid, &status, 0) < 0) {
+    if (errno != EINTR) {
+      return -1;
+    }
+  }
+  return exitStatus(status);
+}
+
+//------------------------------------------------------------------------
+
+// Copy the Vector[String] in [commandCell] to [args]. Returns false
+// if the command is empty.
+static bool commandArgs(Cell &commandCell, std::vector<std::string> &args) {
+  int64_t argc = vectorLength(commandCell);
+  if (argc < 1) {
+    return false;
+  }
+  args.resize(argc);
+  for (int64_t i = 0; i < argc; ++i) {
+    Cell argCell = vectorGet(commandCell, i);
+    args[i] = stringToStdString(argCell);
+  }
+  return true;
+}
+
+// Start a child process running [args], with posix_spawnp (which
+// uses vfork or clone, so starting a child doesn't copy the parent's
+// page tables, which can be large with a big heap). Returns the pid,
+// or -1 on error.
+static pid_t spawnArgs(const std::vector<std::string> &args, posix_spawn_file_actions_t *actions) {
+  std::vector<char*> argv(args.size() + 1);
+  for (size_t i = 0; i < args.size(); ++i) {
+    argv[i] = (char *)args[i].c_str();
+  }
+  argv[args.size()] = nullptr;
+  // the child's output shouldn't land ahead of output buffered earlier
+  flushStdout();
+  pid_t pid;
+  if (posix_spawnp(&pid, argv[0], actions, nullptr, argv.data(), environ) != 0) {
+    return -1;
+  }
+  return pid;
+}
+
+// Create a pipe. The end used by the parent ([parentIdx]) is
+// non-blocking. Both ends are close-on-exec (the child's end is
+// dup'ed onto a stdio fd, which clears that flag).
+static bool makePipe(int fds[2], int parentIdx) {
+  if (pipe(fds) != 0) {
+    fds[0] = fds[1] = -1;
+    return false;
+  }
+  fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+  fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+  fcntl(fds[parentIdx], F_SETFL, fcntl(fds[parentIdx], F_GETFL) | O_NONBLOCK);
+  return true;
+}
+
+static void closeFD(int &fd) {
+  if (fd >= 0) {
+    close(fd);
+    fd = -1;
+  }
+}
+
+// The child is left running, but the pipes are closed, so it will
+// see EOF on stdin, and EPIPE on stdout/stderr. If it hasn't exited
+// yet, it's added to the orphan list, to be reaped later.
+static void finalizeProcess(ResourceObject *resObj) {
+  ProcessResource *pr = (ProcessResource *)resObj;
+  closeFD(pr->inFD);
+  closeFD(pr->outFD);
+  closeFD(pr->errFD);
+  reapProcess(pr, false);
+  if (!pr->exited) {
+    orphanProcesses.push_back(pr->pid);
+  }
+  forgetProcess(pr);
+  delete pr;
+}
+
+static ProcessResource *processResourceOf(Cell &pCell, BytecodeEngine &engine) {
+  Process *p = (Process *)cellHeapPtr(pCell);
+  engine.failOnNilPtr(p);
+  return (ProcessResource *)cellResourcePtr(p->processResource);
+}
+
+// Write pending input to, and read available output from, the
+// Process's pipes, waiting up to [timeout] milliseconds (-1 = no
+// limit) for at least one of them to be ready.
+static void servicePipes(ProcessResource *pr, int timeout) {
+  struct pollfd fds[3];
+  int nFDs = 0;
+  if (pr->inFD >= 0) {
+    if (pr->inputPos == pr->input.size()) {
+      closeFD(pr->inFD);
+    } else {
+      fds[nFDs].fd = pr->inFD;
+      fds[nFDs].events = POLLOUT;
+      ++nFDs;
+    }
+  }
+  if (pr->outFD >= 0) {
+    fds[nFDs].fd = pr->outFD;
+    fds[nFDs].events = POLLIN;
+    ++nFDs;
+  }
+  if (pr->errFD >= 0) {
+    fds[nFDs].fd = pr->errFD;
+    fds[nFDs].events = POLLIN;
+    ++nFDs;
+  }
+  if (nFDs == 0) {
+    return;
+  }
+  for (int i = 0; i < nFDs; ++i) {
+    fds[i].revents = 0;
+  }
+  if (poll(fds, nFDs, timeout) <= 0) {
+    return;
+  }
+  for (int i = 0; i < nFDs; ++i) {
+    if (!fds[i].revents) {
+      continue;
+    }
+    if (fds[i].fd == pr->inFD) {
+      writeInput(pr);
+    } else if (fds[i].fd == pr->outFD) {
+      readPipe(pr->outFD, pr->output);
+    } else {
+      readPipe(pr->errFD, pr->errorOutput);
+    }
+  }
+}
+
+// Write as much of the remaining input as the stdin pipe will take.
+// If the child has closed its end, the rest of the input is dropped.
+static void writeInput(ProcessResource *pr) {
+  // block SIGPIPE while writing, so a child that exits without
+  // reading all of its input doesn't kill the program
+  sigset_t pipeSet, oldSet;
+  sigemptyset(&pipeSet);
+  sigaddset(&pipeSet, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &pipeSet, &oldSet);
+
+  bool failed = false;
+  while (pr->inputPos < pr->input.size()) {
+    size_t n = std::min(pr->input.size() - pr->inputPos, (size_t)processPipeChunkSize);
+    ssize_t k = write(pr->inFD, pr->input.data() + pr->inputPos, n);
+    if (k < 0) {
+      if (errno == EINTR) {
+	continue;
+      }
+      failed = errno != EAGAIN;
+      break;
+    }
+    pr->inputPos += (size_t)k;
+  }
+
+  // discard the SIGPIPE (if any) before unblocking it
+  if (failed) {
+    struct timespec zero = {0, 0};
+    while (sigtimedwait(&pipeSet, nullptr, &zero) == SIGPIPE) ;
+  }
+  pthread_sigmask(SIG_SETMASK, &oldSet, nullptr);
+
+  if (failed || pr->inputPos == pr->input.size()) {
+    closeFD(pr->inFD);
+  }
+}
+
+// Read everything available from the pipe [fd], appending it to
+// [out]. Closes the pipe at EOF (or on error).
+static void readPipe(int &fd, std::string &out) {
+  char buf[processPipeChunkSize];
+  while (true) {
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n > 0) {
+      out.append(buf, (size_t)n);
+    } else if (n < 0 && errno == EINTR) {
+      continue;
+    } else if (n < 0 && errno == EAGAIN) {
+      return;
+    } else {
+      closeFD(fd);
+      return;
+    }
+  }
+}
+
+// Collect the Process's exit status, if it has exited. If [block] is
+// true, waits for it to exit.
+static void reapProcess(ProcessResource *pr, bool block) {
+  if (pr->exited) {
+    return;
+  }
+  int status;
+  pid_t pid;
+  do {
+    pid = waitpid(pr->pid, &status, block ? 0 : WNOHANG);
+  } while (pid < 0 && errno == EINTR);
+  if (pid == pr->pid) {
+    pr->exited = true;
+    pr->status = exitStatus(status);
+    forgetProcess(pr);
+  } else if (pid < 0) {
+    // already reaped elsewhere
+    pr->exited = true;
+    forgetProcess(pr);
+  }
+}
+
+// Remove [pr] from the live process table.
+static void forgetProcess(ProcessResource *pr) {
+  auto iter = liveProcesses.find(pr->pid);
+  if (iter != liveProcesses.end() && iter->second == pr) {
+    liveProcesses.erase(iter);
+  }
+}
+
+// Reap any orphans that have exited.
+static void reapOrphans() {
+  size_t j = 0;
+  for (size_t i = 0; i < orphanProcesses.size(); ++i) {
+    pid_t pid;
+    do {
+      pid = waitpid(orphanProcesses[i], nullptr, WNOHANG);
+    } while (pid < 0 && errno == EINTR);
+    if (pid == 0) {
+      orphanProcesses[j++] = orphanProcesses[i];
+    }
+  }
+  orphanProcesses.resize(j);
+}
+
+// Convert a waitpid status to an exit status, or -1 if the process
+// was killed by a signal.
+static int exitStatus(int status) {
+  return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
@@ -0,0 +1,29 @@
+//========================================================================
+//
+// runtime_process.h
+//
+// Runtime library: subprocess functions.
+//
+// Part of the Haxonite project, under the MIT License.
+// Copyright 2025 Derek Noonburg
+//
+//========================================================================
+
+#ifndef runtime_process_h
+#define runtime_process_h
+
+#include <sys/types.h>
+#include "BytecodeEngine.h"
+
+extern void runtime_process_init(BytecodeEngine &engine);
+
+// Start the command in [commandCell] (a Vector[String]), sharing the
+// caller's stdin/stdout/stderr. Returns the child's pid, or -1 if the
+// command couldn't be started.
+extern pid_t spawnCommand(Cell &commandCell);
+
+// Wait for the child process [pid] to exit. Returns its exit status,
+// or -1 if it was killed by a signal (or can't be waited for).
+extern int waitCommand(pid_t pid);
+
+#endif // runtime_process_h
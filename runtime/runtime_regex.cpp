@@ -10,25 +10,237 @@
 #include "runtime_regex.h"
 #define PCRE2_CODE_UNIT_WIDTH 8
 #include <pcre2.h>
+#include <string.h>
+#include <algorithm>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "runtime_File.h"
 #include "runtime_String.h"
+#include "runtime_StringBuf.h"
 #include "runtime_Vector.h"
 
 //------------------------------------------------------------------------
 
-static pcre2_code *makeRE(Cell &reCell, BytecodeEngine &engine) {
-  uint8_t *reData = stringData(reCell);
-  int64_t reLength = stringByteLength(reCell);
-  if (reLength > PCRE2_SIZE_MAX) {
+// Max number of patterns in the compiled-regex cache.
+#define regexCacheSize 64
+
+// Initial and max size of the JIT stack.
+#define regexJITStackInitialSize (32 * 1024)
+#define regexJITStackMaxSize (4 * 1024 * 1024)
+
+// Returned by reNext when a match might continue past the end of the
+// StringBuf.
+#define reNeedMoreData -2
+
+// Number of bytes read from the file at a time by reFindAll.
+#define reFindAllChunkSize 65536
+
+// Number of bytes kept before the search position when reFindAll
+// discards old data, so that lookbehind assertions, \b, etc. still
+// see the preceding text.
+#define reFindAllContextSize 256
+
+//------------------------------------------------------------------------
+
+// A compiled pattern, along with match data sized for it. The match
+// data is reused by every match with this pattern -- this is safe
+// because the regex natives never call back into bytecode. The
+// streaming functions (reNext, reMatchStart, etc.) read the results
+// of the most recent match from [md]; [lastResult] is the return
+// value from that match.
+struct CompiledRegex {
+  pcre2_code *code;
+  pcre2_match_data *md;
+  int lastResult;
+};
+
+// The regex functions that take the pattern as a String look it up
+// in this cache, which holds the most recently used patterns, in
+// most-recently-used-first order.
+struct RegexCacheEntry {
+  std::string pattern;
+  CompiledRegex re;
+};
+
+struct RegexResource {
+  ResourceObject resObj;
+  CompiledRegex re;
+};
+
+struct Regex {
+  uint64_t hdr;
+  Cell regexResource;   // resource pointer -> RegexResource
+};
+
+#define regexNCells (sizeof(Regex) / sizeof(Cell) - 1)
+
+//------------------------------------------------------------------------
+
+static std::list<RegexCacheEntry> regexCache;
+static std::unordered_map<std::string, std::list<RegexCacheEntry>::iterator> regexCacheIndex;
+
+// Patterns are JIT-compiled if PCRE2 was built with JIT support,
+// unless it's disabled in the config file, with:
+//
+//     -runtime
+//     regexJIT off
+//
+// The JIT stack and the match context that points to it are created
+// by runtime_regex_init. There is one BytecodeEngine per process, and
+// the regex natives only run on its thread, so a single stack serves
+// the engine.
+static bool regexUseJIT = true;
+static pcre2_jit_stack *regexJITStack = nullptr;
+static pcre2_match_context *regexMatchContext = nullptr;
+
+//------------------------------------------------------------------------
+
+static bool compileRE(const uint8_t *data, int64_t length, CompiledRegex &re);
+static void freeRE(CompiledRegex &re);
+static int regexExec(CompiledRegex *re, const uint8_t *sData, int64_t sLength,
+		     int64_t pos, uint32_t options);
+static CompiledRegex *getCachedRE(Cell &reCell);
+static CompiledRegex *getRegexObjectRE(Cell &regexCell, BytecodeEngine &engine);
+static void finalizeRegex(ResourceObject *resObj);
+static bool regexTest(CompiledRegex *re, Cell &sCell);
+static Cell regexMatch(CompiledRegex *re, Cell &sCell, BytecodeEngine &engine);
+static Cell regexSplit(CompiledRegex *re, Cell &sCell, BytecodeEngine &engine);
+static Cell regexReplace(CompiledRegex *re, Cell &sCell, Cell &subCell,
+			 BytecodeEngine &engine);
+static int64_t utf8CompletePrefixLength(const uint8_t *s, int64_t length);
+static int64_t regexNext(CompiledRegex *re, const uint8_t *sData, int64_t sLength,
+			 int64_t pos, bool more);
+static bool regexGroupRange(CompiledRegex *re, int64_t group,
+			    int64_t &start, int64_t &end);
+
+//------------------------------------------------------------------------
+
+// Compile a pattern. Returns false if the pattern is invalid.
+static bool compileRE(const uint8_t *data, int64_t length, CompiledRegex &re) {
+  if (length > PCRE2_SIZE_MAX) {
     BytecodeEngine::fatalError("Integer overflow");
   }
   int errorCode;
   PCRE2_SIZE errorOffset;
-  return pcre2_compile((PCRE2_SPTR)reData, (PCRE2_SIZE)reLength,
-		       PCRE2_UTF, &errorCode, &errorOffset, nullptr);
+  re.code = pcre2_compile((PCRE2_SPTR)data, (PCRE2_SIZE)length,
+			  PCRE2_UTF, &errorCode, &errorOffset, nullptr);
+  if (!re.code) {
+    re.md = nullptr;
+    return false;
+  }
+  re.md = pcre2_match_data_create_from_pattern(re.code, nullptr);
+  if (!re.md) {
+    BytecodeEngine::fatalError("Out of memory");
+  }
+  re.lastResult = 0;
+
+  // the streaming functions (reNext with more data coming, and
+  // reFindAll) match with PCRE2_PARTIAL_HARD, which needs its own JIT
+  // code; if JIT compilation fails (e.g., not supported on this CPU),
+  // the pattern is still usable with the interpreter
+  if (regexUseJIT) {
+    pcre2_jit_compile(re.code, PCRE2_JIT_COMPLETE | PCRE2_JIT_PARTIAL_HARD);
+  }
+  return true;
+}
+
+static void freeRE(CompiledRegex &re) {
+  pcre2_match_data_free(re.md);
+  pcre2_code_free(re.code);
+}
+
+// Run a match, starting at byte [pos] of [sData]. PCRE2 uses the JIT
+// code if the pattern was JIT-compiled for this kind of match
+// (complete, or PCRE2_PARTIAL_HARD), and the interpreter otherwise.
+// If the JIT stack overflows, the match is rerun with the
+// interpreter.
+static int regexExec(CompiledRegex *re, const uint8_t *sData, int64_t sLength,
+		     int64_t pos, uint32_t options) {
+  int n = pcre2_match(re->code, (PCRE2_SPTR)sData, (PCRE2_SIZE)sLength, (PCRE2_SIZE)pos,
+		      options, re->md, regexMatchContext);
+  if (n == PCRE2_ERROR_JIT_STACKLIMIT) {
+    n = pcre2_match(re->code, (PCRE2_SPTR)sData, (PCRE2_SIZE)sLength, (PCRE2_SIZE)pos,
+		    options | PCRE2_NO_JIT, re->md, regexMatchContext);
+  }
+  re->lastResult = n;
+  return n;
+}
+
+// Look up the pattern [reCell] in the cache, compiling it (and
+// evicting the least recently used pattern) if needed. Returns null
+// if the pattern is invalid. Invalid patterns are not cached.
+static CompiledRegex *getCachedRE(Cell &reCell) {
+  std::string pattern((char *)stringData(reCell), stringByteLength(reCell));
+  auto idx = regexCacheIndex.find(pattern);
+  if (idx != regexCacheIndex.end()) {
+    if (idx->second != regexCache.begin()) {
+      regexCache.splice(regexCache.begin(), regexCache, idx->second);
+    }
+    return &regexCache.front().re;
+  }
+
+  CompiledRegex re;
+  if (!compileRE((const uint8_t *)pattern.data(), (int64_t)pattern.size(), re)) {
+    return nullptr;
+  }
+  if (regexCache.size() >= regexCacheSize) {
+    regexCacheIndex.erase(regexCache.back().pattern);
+    freeRE(regexCache.back().re);
+    regexCache.pop_back();
+  }
+  regexCache.push_front(RegexCacheEntry{pattern, re});
+  regexCacheIndex[pattern] = regexCache.begin();
+  return &regexCache.front().re;
+}
+
+static CompiledRegex *getRegexObjectRE(Cell &regexCell, BytecodeEngine &engine) {
+  Regex *regex = (Regex *)cellHeapPtr(regexCell);
+  engine.failOnNilPtr(regex);
+  RegexResource *regexResource = (RegexResource *)cellResourcePtr(regex->regexResource);
+  return &regexResource->re;
+}
+
+//------------------------------------------------------------------------
+
+// compileRegex(pattern: String) -> Result[Regex]
+static NativeFuncDefn(runtime_compileRegex_S) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &reCell = engine.arg(0);
+
+  CompiledRegex re;
+  if (!compileRE(stringData(reCell), stringByteLength(reCell), re)) {
+    engine.push(cellMakeError());
+    return;
+  }
+
+  RegexResource *regexResource;
+  try {
+    regexResource = new RegexResource();
+  } catch (std::bad_alloc) {
+    BytecodeEngine::fatalError("Out of memory");
+  }
+  regexResource->resObj.finalizer = &finalizeRegex;
+  regexResource->re = re;
+
+  // NB: this may trigger GC
+  Regex *regex = (Regex *)engine.heapAllocTuple(regexNCells, 0);
+  regex->regexResource = cellMakeResourcePtr(regexResource);
+  engine.addResourceObject(&regexResource->resObj);
+
+  engine.push(cellMakeHeapPtr(regex));
 }
 
-static void freeRE(pcre2_code *re) {
-  pcre2_code_free(re);
+static void finalizeRegex(ResourceObject *resObj) {
+  RegexResource *regexResource = (RegexResource *)resObj;
+  freeRE(regexResource->re);
+  delete regexResource;
 }
 
 // reTest(re: String, s: String) -> Result[Bool]
@@ -43,26 +255,40 @@ static NativeFuncDefn(runtime_reTest_SS) {
   Cell &reCell = engine.arg(0);
   Cell &sCell = engine.arg(1);
 
-  pcre2_code *re = makeRE(reCell, engine);
+  CompiledRegex *re = getCachedRE(reCell);
   if (re) {
-    uint8_t *sData = stringData(sCell);
-    int64_t sLength = stringByteLength(sCell);
-    if (sLength > PCRE2_SIZE_MAX) {
-      BytecodeEngine::fatalError("Integer overflow");
-    }
-    pcre2_match_data *md = pcre2_match_data_create_from_pattern(re, nullptr);
-    if (!md) {
-      BytecodeEngine::fatalError("Out of memory");
-    }
-    int n = pcre2_match(re, (PCRE2_SPTR)sData, (PCRE2_SIZE)sLength, 0, 0, md, nullptr);
-    pcre2_match_data_free(md);
-    freeRE(re);
-    engine.push(cellMakeBool(n > 0));
+    engine.push(cellMakeBool(regexTest(re, sCell)));
   } else {
     engine.push(cellMakeError());
   }
 }
 
+// reTest(re: Regex, s: String) -> Bool
+static NativeFuncDefn(runtime_reTest_5RegexS) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsPtr(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &regexCell = engine.arg(0);
+  Cell &sCell = engine.arg(1);
+
+  CompiledRegex *re = getRegexObjectRE(regexCell, engine);
+  engine.push(cellMakeBool(regexTest(re, sCell)));
+}
+
+static bool regexTest(CompiledRegex *re, Cell &sCell) {
+  uint8_t *sData = stringData(sCell);
+  int64_t sLength = stringByteLength(sCell);
+  if (sLength > PCRE2_SIZE_MAX) {
+    BytecodeEngine::fatalError("Integer overflow");
+  }
+  int n = regexExec(re, sData, sLength, 0, 0);
+  return n > 0;
+}
+
 // reMatch(re: String, s: String) -> Result[Vector[String]]
 static NativeFuncDefn(runtime_reMatch_SS) {
 #if CHECK_RUNTIME_FUNC_ARGS
@@ -75,39 +301,56 @@ static NativeFuncDefn(runtime_reMatch_SS) {
   Cell &reCell = engine.arg(0);
   Cell &sCell = engine.arg(1);
 
-  pcre2_code *re = makeRE(reCell, engine);
+  CompiledRegex *re = getCachedRE(reCell);
   if (re) {
-    uint8_t *sData = stringData(sCell);
-    int64_t sLength = stringByteLength(sCell);
-    if (sLength > PCRE2_SIZE_MAX) {
-      BytecodeEngine::fatalError("Integer overflow");
-    }
-    pcre2_match_data *md = pcre2_match_data_create_from_pattern(re, nullptr);
-    if (!md) {
-      BytecodeEngine::fatalError("Out of memory");
-    }
-    PCRE2_SIZE *ov = pcre2_get_ovector_pointer(md);
-    int n = pcre2_match(re, (PCRE2_SPTR)sData, (PCRE2_SIZE)sLength, 0, 0, md, nullptr);
-    Cell vCell = vectorMake(engine);
-    engine.pushGCRoot(vCell);
-    for (int i = 0; i < n; ++i) {
-      Cell mCell;
-      if (ov[2*i] == PCRE2_UNSET || ov[2*i + 1] == PCRE2_UNSET) {
-	mCell = stringMake((const uint8_t *)"", 0, engine);
-      } else {
-	mCell = stringMake(sCell, ov[2*i], ov[2*i + 1] - ov[2*i], engine);
-      }
-      vectorAppend(vCell, mCell, engine);
-    }
-    pcre2_match_data_free(md);
-    freeRE(re);
-    engine.push(vCell);
-    engine.popGCRoot(vCell);
+    // NB: this may trigger GC
+    engine.push(regexMatch(re, sCell, engine));
   } else {
     engine.push(cellMakeError());
   }
 }
 
+// reMatch(re: Regex, s: String) -> Vector[String]
+static NativeFuncDefn(runtime_reMatch_5RegexS) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsPtr(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &regexCell = engine.arg(0);
+  Cell &sCell = engine.arg(1);
+
+  CompiledRegex *re = getRegexObjectRE(regexCell, engine);
+  // NB: this may trigger GC
+  engine.push(regexMatch(re, sCell, engine));
+}
+
+// NB: this may trigger GC
+static Cell regexMatch(CompiledRegex *re, Cell &sCell, BytecodeEngine &engine) {
+  uint8_t *sData = stringData(sCell);
+  int64_t sLength = stringByteLength(sCell);
+  if (sLength > PCRE2_SIZE_MAX) {
+    BytecodeEngine::fatalError("Integer overflow");
+  }
+  PCRE2_SIZE *ov = pcre2_get_ovector_pointer(re->md);
+  int n = regexExec(re, sData, sLength, 0, 0);
+  Cell vCell = vectorMake(engine);
+  engine.pushGCRoot(vCell);
+  for (int i = 0; i < n; ++i) {
+    Cell mCell;
+    if (ov[2*i] == PCRE2_UNSET || ov[2*i + 1] == PCRE2_UNSET) {
+      mCell = stringMake((const uint8_t *)"", 0, engine);
+    } else {
+      mCell = stringMake(sCell, ov[2*i], ov[2*i + 1] - ov[2*i], engine);
+    }
+    vectorAppend(vCell, mCell, engine);
+  }
+  engine.popGCRoot(vCell);
+  return vCell;
+}
+
 // reSplit(re: String, s: String) -> Result[Vector[String]]
 static NativeFuncDefn(runtime_reSplit_SS) {
 #if CHECK_RUNTIME_FUNC_ARGS
@@ -120,49 +363,91 @@ static NativeFuncDefn(runtime_reSplit_SS) {
   Cell &reCell = engine.arg(0);
   Cell &sCell = engine.arg(1);
 
+  CompiledRegex *re = getCachedRE(reCell);
+  if (re) {
+    // NB: this may trigger GC
+    engine.push(regexSplit(re, sCell, engine));
+  } else {
+    engine.push(cellMakeError());
+  }
+}
+
+// reSplit(re: Regex, s: String) -> Vector[String]
+static NativeFuncDefn(runtime_reSplit_5RegexS) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsPtr(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &regexCell = engine.arg(0);
+  Cell &sCell = engine.arg(1);
+
+  CompiledRegex *re = getRegexObjectRE(regexCell, engine);
+  // NB: this may trigger GC
+  engine.push(regexSplit(re, sCell, engine));
+}
+
+// NB: this may trigger GC
+static Cell regexSplit(CompiledRegex *re, Cell &sCell, BytecodeEngine &engine) {
   int64_t sLength = stringByteLength(sCell);
   if (sLength > PCRE2_SIZE_MAX) {
     BytecodeEngine::fatalError("Integer overflow");
   }
+  PCRE2_SIZE *ov = pcre2_get_ovector_pointer(re->md);
 
-  pcre2_code *re = makeRE(reCell, engine);
-  if (re) {
-    pcre2_match_data *md = pcre2_match_data_create_from_pattern(re, nullptr);
-    if (!md) {
-      BytecodeEngine::fatalError("Out of memory");
-    }
-    PCRE2_SIZE *ov = pcre2_get_ovector_pointer(md);
-
-    Cell vCell = vectorMake(engine);
-    engine.pushGCRoot(vCell);
-
-    int64_t pos = 0;
-    while (true) {
-      uint8_t *sData = stringData(sCell);
-      int n = pcre2_match(re, (PCRE2_SPTR)sData, (PCRE2_SIZE)sLength, (PCRE2_SIZE)pos,
-			  0, md, nullptr);
-      if (n <= 0 || (int64_t)ov[1] <= pos) {
-	Cell mCell = stringMake(sData + pos, sLength - pos, engine);
-	vectorAppend(vCell, mCell, engine);
-	break;
-      }
-      Cell mCell = stringMake(sCell, pos, (int64_t)ov[0] - pos, engine);
+  Cell vCell = vectorMake(engine);
+  engine.pushGCRoot(vCell);
+
+  // PCRE2 checks that the whole subject is valid UTF-8 on every
+  // match call, so only the first call does that check
+  uint32_t options = 0;
+  int64_t pos = 0;
+  while (true) {
+    // the string data may be moved by GC in the previous iteration
+    uint8_t *sData = stringData(sCell);
+    int n = regexExec(re, sData, sLength, pos, options);
+    options = PCRE2_NO_UTF_CHECK;
+    if (n <= 0 || (int64_t)ov[1] <= pos) {
+      Cell mCell = stringMake(sCell, pos, sLength - pos, engine);
       vectorAppend(vCell, mCell, engine);
-      pos = (int64_t)ov[1];
+      break;
     }
+    Cell mCell = stringMake(sCell, pos, (int64_t)ov[0] - pos, engine);
+    vectorAppend(vCell, mCell, engine);
+    pos = (int64_t)ov[1];
+  }
+
+  engine.popGCRoot(vCell);
+  return vCell;
+}
 
-    pcre2_match_data_free(md);
-    freeRE(re);
-    engine.push(vCell);
-    engine.popGCRoot(vCell);
+// reReplace(re: String, s: String, sub: String) -> Result[String]
+static NativeFuncDefn(runtime_reReplace_SSS) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 3 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsPtr(engine.arg(1)) ||
+      !cellIsPtr(engine.arg(2))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &reCell = engine.arg(0);
+  Cell &sCell = engine.arg(1);
+  Cell &subCell = engine.arg(2);
 
+  CompiledRegex *re = getCachedRE(reCell);
+  if (re) {
+    // NB: this may trigger GC
+    engine.push(regexReplace(re, sCell, subCell, engine));
   } else {
     engine.push(cellMakeError());
   }
 }
 
-// reReplace(re: String, s: String, sub: String) -> Result[String]
-static NativeFuncDefn(runtime_reReplace_SSS) {
+// reReplace(re: Regex, s: String, sub: String) -> String
+static NativeFuncDefn(runtime_reReplace_5RegexSS) {
 #if CHECK_RUNTIME_FUNC_ARGS
   if (engine.nArgs() != 3 ||
       !cellIsPtr(engine.arg(0)) ||
@@ -171,10 +456,18 @@ static NativeFuncDefn(runtime_reReplace_SSS) {
     BytecodeEngine::fatalError("Invalid argument");
   }
 #endif
-  Cell &reCell = engine.arg(0);
+  Cell &regexCell = engine.arg(0);
   Cell &sCell = engine.arg(1);
   Cell &subCell = engine.arg(2);
 
+  CompiledRegex *re = getRegexObjectRE(regexCell, engine);
+  // NB: this may trigger GC
+  engine.push(regexReplace(re, sCell, subCell, engine));
+}
+
+// NB: this may trigger GC
+static Cell regexReplace(CompiledRegex *re, Cell &sCell, Cell &subCell,
+			 BytecodeEngine &engine) {
   uint8_t *sData = stringData(sCell);
   int64_t sLength = stringByteLength(sCell);
   if (sLength > PCRE2_SIZE_MAX) {
@@ -184,43 +477,376 @@ static NativeFuncDefn(runtime_reReplace_SSS) {
   uint8_t *subData = stringData(subCell);
   int64_t subLength = stringByteLength(subCell);
 
-  pcre2_code *re = makeRE(reCell, engine);
-  if (re) {
-    pcre2_match_data *md = pcre2_match_data_create_from_pattern(re, nullptr);
-    if (!md) {
-      BytecodeEngine::fatalError("Out of memory");
+  PCRE2_SIZE *ov = pcre2_get_ovector_pointer(re->md);
+
+  std::string out;
+
+  // only the first match call checks that the subject is valid UTF-8
+  uint32_t options = 0;
+  int64_t pos = 0;
+  while (true) {
+    int n = regexExec(re, sData, sLength, pos, options);
+    options = PCRE2_NO_UTF_CHECK;
+    if (n <= 0 || (int64_t)ov[1] <= pos) {
+      out.append((char *)sData + pos, sLength - pos);
+      break;
+    }
+    out.append((char *)sData + pos, (int64_t)ov[0] - pos);
+    out.append((char *)subData, subLength);
+    pos = (int64_t)ov[1];
+  }
+
+  return stringMake((uint8_t *)out.c_str(), (int64_t)out.size(), engine);
+}
+
+//------------------------------------------------------------------------
+// streaming
+//------------------------------------------------------------------------
+
+// These functions report match offsets instead of allocating Strings:
+// reNext finds the next match, and reMatchStart/reMatchEnd return the
+// offsets of the match and its capture groups. reCapture allocates a
+// String for one group, only when the caller needs it.
+
+// Return the length of the longest prefix of [s] that doesn't end in
+// the middle of a UTF-8 sequence. This is used when more data may be
+// appended to [s], so PCRE2 doesn't see a truncated codepoint.
+static int64_t utf8CompletePrefixLength(const uint8_t *s, int64_t length) {
+  int64_t nCont = 0;
+  while (nCont < 3 && nCont < length && (s[length - 1 - nCont] & 0xc0) == 0x80) {
+    ++nCont;
+  }
+  int64_t lead = length - 1 - nCont;
+  if (lead < 0) {
+    return length;
+  }
+  uint8_t c = s[lead];
+  int64_t seqLength = c >= 0xf0 ? 4 : c >= 0xe0 ? 3 : c >= 0xc0 ? 2 : 1;
+  return seqLength > nCont + 1 ? lead : length;
+}
+
+// Search [sData][0 .. sLength-1] for a match starting at or after
+// [pos]. Returns the start of the match, or -1 if there is no match.
+// If [more] is true, more data may be appended later, so a match
+// that runs into the end of the data returns reNeedMoreData.
+static int64_t regexNext(CompiledRegex *re, const uint8_t *sData, int64_t sLength,
+			 int64_t pos, bool more) {
+  if (pos < 0 || pos > sLength) {
+    BytecodeEngine::fatalError("Index out of bounds");
+  }
+  if (sLength > PCRE2_SIZE_MAX) {
+    BytecodeEngine::fatalError("Integer overflow");
+  }
+  uint32_t options = 0;
+  if (more) {
+    sLength = utf8CompletePrefixLength(sData, sLength);
+    if (pos > sLength) {
+      re->lastResult = 0;
+      return reNeedMoreData;
     }
-    PCRE2_SIZE *ov = pcre2_get_ovector_pointer(md);
+    options |= PCRE2_PARTIAL_HARD;
+  }
+  int n = regexExec(re, sData, sLength, pos, options);
+  if (n == PCRE2_ERROR_PARTIAL) {
+    return reNeedMoreData;
+  }
+  if (n <= 0) {
+    return -1;
+  }
+  return (int64_t)pcre2_get_ovector_pointer(re->md)[0];
+}
+
+// Get the offsets of capture group [group] from the most recent
+// match. Returns false if there was no match, or if the group didn't
+// participate in the match.
+static bool regexGroupRange(CompiledRegex *re, int64_t group,
+			    int64_t &start, int64_t &end) {
+  if (group < 0 || group >= (int64_t)pcre2_get_ovector_count(re->md)) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+  if (re->lastResult <= 0 || group >= re->lastResult) {
+    return false;
+  }
+  PCRE2_SIZE *ov = pcre2_get_ovector_pointer(re->md);
+  if (ov[2*group] == PCRE2_UNSET || ov[2*group + 1] == PCRE2_UNSET) {
+    return false;
+  }
+  start = (int64_t)ov[2*group];
+  end = (int64_t)ov[2*group + 1];
+  return true;
+}
+
+// reNext(re: Regex, s: String, pos: Int) -> Int
+static NativeFuncDefn(runtime_reNext_5RegexSI) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 3 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsPtr(engine.arg(1)) ||
+      !cellIsInt(engine.arg(2))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &regexCell = engine.arg(0);
+  Cell &sCell = engine.arg(1);
+  Cell &posCell = engine.arg(2);
+
+  CompiledRegex *re = getRegexObjectRE(regexCell, engine);
+  int64_t idx = regexNext(re, stringData(sCell), stringByteLength(sCell),
+			  cellInt(posCell), false);
+  engine.push(cellMakeInt(idx));
+}
+
+// reNext(re: Regex, sb: StringBuf, pos: Int, more: Bool) -> Int
+static NativeFuncDefn(runtime_reNext_5RegexTIB) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 4 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsPtr(engine.arg(1)) ||
+      !cellIsInt(engine.arg(2)) ||
+      !cellIsBool(engine.arg(3))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &regexCell = engine.arg(0);
+  Cell &sbCell = engine.arg(1);
+  Cell &posCell = engine.arg(2);
+  Cell &moreCell = engine.arg(3);
+
+  CompiledRegex *re = getRegexObjectRE(regexCell, engine);
+  int64_t sbLength = stringBufLength(sbCell);
+  const uint8_t *sbData = sbLength > 0 ? stringBufData(sbCell) : (const uint8_t *)"";
+  int64_t idx = regexNext(re, sbData, sbLength, cellInt(posCell), cellBool(moreCell));
+  engine.push(cellMakeInt(idx));
+}
+
+// reMatchStart(re: Regex, group: Int) -> Int
+static NativeFuncDefn(runtime_reMatchStart_5RegexI) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsInt(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &regexCell = engine.arg(0);
+  Cell &groupCell = engine.arg(1);
+
+  CompiledRegex *re = getRegexObjectRE(regexCell, engine);
+  int64_t start, end;
+  if (!regexGroupRange(re, cellInt(groupCell), start, end)) {
+    start = -1;
+  }
+  engine.push(cellMakeInt(start));
+}
+
+// reMatchEnd(re: Regex, group: Int) -> Int
+static NativeFuncDefn(runtime_reMatchEnd_5RegexI) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsInt(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &regexCell = engine.arg(0);
+  Cell &groupCell = engine.arg(1);
+
+  CompiledRegex *re = getRegexObjectRE(regexCell, engine);
+  int64_t start, end;
+  if (!regexGroupRange(re, cellInt(groupCell), start, end)) {
+    end = -1;
+  }
+  engine.push(cellMakeInt(end));
+}
+
+// reCapture(re: Regex, s: String, group: Int) -> String
+static NativeFuncDefn(runtime_reCapture_5RegexSI) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 3 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsPtr(engine.arg(1)) ||
+      !cellIsInt(engine.arg(2))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &regexCell = engine.arg(0);
+  Cell &sCell = engine.arg(1);
+  Cell &groupCell = engine.arg(2);
+
+  CompiledRegex *re = getRegexObjectRE(regexCell, engine);
+  int64_t start, end;
+  if (!regexGroupRange(re, cellInt(groupCell), start, end)) {
+    start = end = 0;
+  }
+  if (end > stringByteLength(sCell)) {
+    BytecodeEngine::fatalError("Index out of bounds");
+  }
+  // NB: this may trigger GC
+  engine.push(stringMake(sCell, start, end - start, engine));
+}
+
+// reCapture(re: Regex, sb: StringBuf, group: Int) -> String
+static NativeFuncDefn(runtime_reCapture_5RegexTI) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 3 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsPtr(engine.arg(1)) ||
+      !cellIsInt(engine.arg(2))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &regexCell = engine.arg(0);
+  Cell &sbCell = engine.arg(1);
+  Cell &groupCell = engine.arg(2);
+
+  CompiledRegex *re = getRegexObjectRE(regexCell, engine);
+  int64_t start, end;
+  if (!regexGroupRange(re, cellInt(groupCell), start, end)) {
+    start = end = 0;
+  }
+  if (end > stringBufLength(sbCell)) {
+    BytecodeEngine::fatalError("Index out of bounds");
+  }
+
+  // NB: this may trigger GC
+  engine.push(stringBufSlice(sbCell, start, end - start, engine));
+}
+
+// reFindAll(re: Regex, f: File) -> Result[Vector[Int]]
+// Scans [f] from its current position to the end, and returns the
+// start and end offsets of each match, as pairs of elements, relative
+// to the starting position. The file is read in chunks, so memory use
+// depends on the match lengths, not the file size.
+static NativeFuncDefn(runtime_reFindAll_5Regex4File) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsPtr(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &regexCell = engine.arg(0);
+  Cell &fCell = engine.arg(1);
 
-    std::string out;
+  CompiledRegex *re = getRegexObjectRE(regexCell, engine);
+  PCRE2_SIZE *ov = pcre2_get_ovector_pointer(re->md);
 
-    int64_t pos = 0;
-    while (true) {
-      int n = pcre2_match(re, (PCRE2_SPTR)sData, (PCRE2_SIZE)sLength, (PCRE2_SIZE)pos,
-			  0, md, nullptr);
-      if (n <= 0 || (int64_t)ov[1] <= pos) {
-	out.append((char *)sData + pos, sLength - pos);
-	break;
+  // [buf] holds the file data starting at offset [bufOffset]; the
+  // next search starts at [buf][pos]
+  std::vector<uint8_t> buf;
+  int64_t bufOffset = 0;
+  int64_t pos = 0;
+  // PCRE2 checks that the subject (from the start position to the
+  // end) is valid UTF-8 on every match call, which would rescan the
+  // rest of the buffer after every match -- [checked] is the length
+  // of the data that has already been checked
+  int64_t checked = 0;
+  bool eof = false;
+  uint32_t notEmpty = 0;
+  std::vector<int64_t> matches;
+  while (true) {
+    int64_t limit = eof ? (int64_t)buf.size()
+                        : utf8CompletePrefixLength(buf.data(), (int64_t)buf.size());
+    // if there's no complete data to search yet, just read more
+    bool searched = eof || (limit > 0 && pos <= limit);
+    int n = PCRE2_ERROR_PARTIAL;
+    if (searched) {
+      n = regexExec(re, buf.data(), limit, pos,
+		    (eof ? 0 : PCRE2_PARTIAL_HARD) | notEmpty |
+		      (limit <= checked ? PCRE2_NO_UTF_CHECK : 0));
+      if (n > 0 || n == PCRE2_ERROR_NOMATCH || n == PCRE2_ERROR_PARTIAL) {
+	checked = std::max(checked, limit);
       }
-      out.append((char *)sData + pos, (int64_t)ov[0] - pos);
-      out.append((char *)subData, subLength);
-      pos = (int64_t)ov[1];
     }
 
-    pcre2_match_data_free(md);
-    freeRE(re);
-    engine.push(stringMake((uint8_t *)out.c_str(), (int64_t)out.size(), engine));
+    if (n > 0) {
+      int64_t start = (int64_t)ov[0];
+      int64_t end = (int64_t)ov[1];
+      matches.push_back(bufOffset + start);
+      matches.push_back(bufOffset + end);
+      // after an empty match, the next match can't be empty at the
+      // same position
+      notEmpty = end == start ? PCRE2_NOTEMPTY_ATSTART : 0;
+      pos = end;
+      continue;
+    }
+    if (n == PCRE2_ERROR_NOMATCH && eof) {
+      break;
+    }
+    if (n != PCRE2_ERROR_NOMATCH && n != PCRE2_ERROR_PARTIAL) {
+      // e.g., invalid UTF-8
+      engine.push(cellMakeError());
+      return;
+    }
 
-  } else {
-    engine.push(cellMakeError());
+    // no match can start before [nextPos], so discard the data
+    // before that (except for some context), and read more
+    int64_t nextPos = pos;
+    if (searched) {
+      nextPos = n == PCRE2_ERROR_PARTIAL ? (int64_t)ov[0] : limit;
+    }
+    if (nextPos != pos) {
+      notEmpty = 0;
+    }
+    int64_t discard = std::max((int64_t)0, nextPos - reFindAllContextSize);
+    buf.erase(buf.begin(), buf.begin() + discard);
+    bufOffset += discard;
+    pos = nextPos - discard;
+    checked -= discard;
+
+    size_t oldSize = buf.size();
+    buf.resize(oldSize + reFindAllChunkSize);
+    int64_t nRead = fileReadBytes(fCell, buf.data() + oldSize, reFindAllChunkSize, engine);
+    if (nRead < 0) {
+      engine.push(cellMakeError());
+      return;
+    }
+    buf.resize(oldSize + nRead);
+    if (nRead == 0) {
+      eof = true;
+    }
   }
+
+  // NB: this may trigger GC
+  engine.push(vectorMakeInt(matches.data(), (int64_t)matches.size(), engine));
 }
 
 //------------------------------------------------------------------------
 
 void runtime_regex_init(BytecodeEngine &engine) {
+  uint32_t jitAvailable = 0;
+  pcre2_config(PCRE2_CONFIG_JIT, &jitAvailable);
+  regexUseJIT = jitAvailable != 0;
+  ConfigFile::Item *cfgItem;
+  if ((cfgItem = engine.configItem("runtime", "regexJIT")) &&
+      cfgItem->args.size() == 1 &&
+      cfgItem->args[0] == "off") {
+    regexUseJIT = false;
+  }
+  if (regexUseJIT) {
+    regexJITStack = pcre2_jit_stack_create(regexJITStackInitialSize,
+					   regexJITStackMaxSize, nullptr);
+    regexMatchContext = pcre2_match_context_create(nullptr);
+    if (!regexJITStack || !regexMatchContext) {
+      BytecodeEngine::fatalError("Out of memory");
+    }
+    pcre2_jit_stack_assign(regexMatchContext, nullptr, regexJITStack);
+  }
+
+  engine.addNativeFunction("compileRegex_S", &runtime_compileRegex_S);
   engine.addNativeFunction("reTest_SS", &runtime_reTest_SS);
+  engine.addNativeFunction("reTest_5RegexS", &runtime_reTest_5RegexS);
   engine.addNativeFunction("reMatch_SS", &runtime_reMatch_SS);
+  engine.addNativeFunction("reMatch_5RegexS", &runtime_reMatch_5RegexS);
   engine.addNativeFunction("reSplit_SS", &runtime_reSplit_SS);
+  engine.addNativeFunction("reSplit_5RegexS", &runtime_reSplit_5RegexS);
   engine.addNativeFunction("reReplace_SSS", &runtime_reReplace_SSS);
+  engine.addNativeFunction("reReplace_5RegexSS", &runtime_reReplace_5RegexSS);
+  engine.addNativeFunction("reNext_5RegexSI", &runtime_reNext_5RegexSI);
+  engine.addNativeFunction("reNext_5RegexTIB", &runtime_reNext_5RegexTIB);
+  engine.addNativeFunction("reMatchStart_5RegexI", &runtime_reMatchStart_5RegexI);
+  engine.addNativeFunction("reMatchEnd_5RegexI", &runtime_reMatchEnd_5RegexI);
+  engine.addNativeFunction("reCapture_5RegexSI", &runtime_reCapture_5RegexSI);
+  engine.addNativeFunction("reCapture_5RegexTI", &runtime_reCapture_5RegexTI);
+  engine.addNativeFunction("reFindAll_5Regex4File", &runtime_reFindAll_5Regex4File);
 }
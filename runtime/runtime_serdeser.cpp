@@ -9,9 +9,17 @@
 
 #include "runtime_serdeser.h"
 #include <string.h>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include "BytecodeDefs.h"
+#include "runtime_Map.h"
+#include "runtime_Set.h"
 #include "runtime_String.h"
 #include "runtime_StringBuf.h"
+#include "runtime_Vector.h"
 
 //------------------------------------------------------------------------
 
@@ -59,6 +67,24 @@ static NativeFuncDefn(runtime_ser_FT) {
   engine.push(cellMakeInt(0));
 }
 
+// ser(val: Double, out: StringBuf)
+static NativeFuncDefn(runtime_ser_DT) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsDouble(engine.arg(0)) ||
+      !cellIsHeapPtr(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &valCell = engine.arg(0);
+  Cell &outCell = engine.arg(1);
+
+  double val = cellDouble(valCell);
+  stringBufAppend(outCell, (uint8_t *)&val, 8, engine);
+
+  engine.push(cellMakeInt(0));
+}
+
 // ser(val: Bool, out: StringBuf)
 static NativeFuncDefn(runtime_ser_BT) {
 #if CHECK_RUNTIME_FUNC_ARGS
@@ -165,6 +191,30 @@ static NativeFuncDefn(runtime_deserFloat_8DeserBuf) {
   }
 }
 
+// deserDouble(in: DeserBuf) -> Result[Double]
+static NativeFuncDefn(runtime_deserDouble_8DeserBuf) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 1 ||
+      !cellIsHeapPtr(engine.arg(0))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &inCell = engine.arg(0);
+
+  DeserBuf *in = (DeserBuf *)cellHeapPtr(inCell);
+  engine.failOnNilPtr(in);
+  int64_t pos = cellInt(in->pos);
+  if (pos <= stringBufLength(in->data) - 8) {
+    double val;
+    memcpy(&val, stringBufData(in->data) + pos, 8);
+    in->pos = cellMakeInt(pos + 8);
+    // NB: this may trigger GC
+    engine.push(engine.heapAllocDouble(val));
+  } else {
+    engine.push(cellMakeError());
+  }
+}
+
 // deserBool(in: DeserBuf) -> Result[Bool]
 static NativeFuncDefn(runtime_deserBool_8DeserBuf) {
 #if CHECK_RUNTIME_FUNC_ARGS
@@ -233,6 +283,18 @@ static NativeFuncDefn(runtime_deserString_8DeserBuf) {
   }
 }
 
+// If the data at [in]'s position matches the [n]-byte header [hdr],
+// skip it and return true; otherwise return false.
+static bool deserHeaderBytes(DeserBuf *in, const uint8_t *hdr, int64_t n) {
+  int64_t pos = cellInt(in->pos);
+  int64_t length = stringBufLength(in->data);
+  if (pos > length - n || memcmp(stringBufData(in->data) + pos, hdr, n) != 0) {
+    return false;
+  }
+  in->pos = cellMakeInt(pos + n);
+  return true;
+}
+
 // deserHeader(hdr: String, in: DeserBuf) -> Result[]
 static NativeFuncDefn(runtime_deserHeader_S8DeserBuf) {
 #if CHECK_RUNTIME_FUNC_ARGS
@@ -247,17 +309,8 @@ static NativeFuncDefn(runtime_deserHeader_S8DeserBuf) {
 
   DeserBuf *in = (DeserBuf *)cellHeapPtr(inCell);
   engine.failOnNilPtr(in);
-  int64_t pos = cellInt(in->pos);
-  int64_t length = stringBufLength(in->data);
-  int64_t n = stringByteLength(hdrCell);
-
-  if (pos <= length - n) {
-    if (memcmp(stringBufData(in->data) + pos, stringData(hdrCell), n) == 0) {
-      engine.push(cellMakeInt(0));
-      in->pos = cellMakeInt(pos + n);
-    } else {
-      engine.push(cellMakeError());
-    }
+  if (deserHeaderBytes(in, stringData(hdrCell), stringByteLength(hdrCell))) {
+    engine.push(cellMakeInt(0));
   } else {
     engine.push(cellMakeError());
   }
@@ -283,18 +336,786 @@ static NativeFuncDefn(runtime_deserEnd_8DeserBuf) {
   }
 }
 
+//------------------------------------------------------------------------
+// generic ser/deser
+//------------------------------------------------------------------------
+
+// The compiler generates calls to _ser and _deser for structs,
+// varstructs, and containers that don't have a user-defined ser()
+// function. The type is passed as a schema string:
+//
+//   i                  Int
+//   e                  enum
+//   f                  Float
+//   d                  Double
+//   b                  Bool
+//   s                  String
+//   v<T>               Vector[T]
+//   z<K>               Set[K]
+//   m<K><T>            Map[K:T]
+//   r<n>:<T>...        struct with n fields, in field order
+//   u<n>:<k>:<T>...    varstruct with n substructs; each substruct
+//                      has k fields (the varstruct's fields, followed
+//                      by the substruct's own fields)
+//   @<k>:              the k-th struct/varstruct in the schema (for
+//                      recursive types)
+//
+// The encoding is:
+// - a 9-byte header: the format version (serFormatVersion), followed
+//   by a 64-bit hash of the schema string, little-endian -- every
+//   _ser call writes a complete, self-contained value, so each one
+//   carries its own header, which _deser checks the same way
+//   deserHeader does;
+// - Int and enum values as zigzag varints;
+// - Float, Double, and Bool values as 4, 8, and 1 raw bytes;
+// - Strings as varint(length + 1), followed by the bytes;
+// - containers as varint(length + 1), followed by the elements (or
+//   key/value pairs); Vector[Float] and Vector[Bool] are copied in
+//   bulk;
+// - structs as a 1 byte, followed by the fields;
+// - varstructs as varint(substruct ID + 1), followed by the fields.
+// A nil String, container, struct, or varstruct is written as a 0
+// byte.
+
+// Version of the _ser/_deser encoding.
+#define serFormatVersion 1
+
+struct SerNode {
+  char kind;
+  int elem;			// 'v', 'z': element; 'm': key
+  int val;			// 'm': value
+  std::vector<std::vector<int>> fields;	// 'r': fields[0]; 'u': fields[id]
+};
+
+struct SerSchema {
+  std::vector<SerNode> nodes;	// nodes[0] is the root
+  std::string header;		// format version + schema hash
+};
+
+// parsed schemas, indexed by schema string
+static std::unordered_map<std::string, std::unique_ptr<SerSchema>> serSchemaCache;
+
+//------------------------------------------------------------------------
+
+static bool parseSerNumber(const std::string &s, size_t &pos, int &n) {
+  n = 0;
+  size_t start = pos;
+  while (pos < s.size() && s[pos] >= '0' && s[pos] <= '9') {
+    n = n * 10 + (s[pos] - '0');
+    if (n > 1000000) {
+      return false;
+    }
+    ++pos;
+  }
+  if (pos == start || pos >= s.size() || s[pos] != ':') {
+    return false;
+  }
+  ++pos;
+  return true;
+}
+
+// Parse the node at [pos] in [s], and return its index, or -1 if the
+// schema is invalid.
+static int parseSerNode(const std::string &s, size_t &pos, SerSchema &schema,
+			std::vector<int> &structNodes) {
+  if (pos >= s.size()) {
+    return -1;
+  }
+  char kind = s[pos++];
+  int idx = (int)schema.nodes.size();
+  int n;
+  switch (kind) {
+  case 'i': case 'e': case 'f': case 'd': case 'b': case 's':
+    schema.nodes.push_back({kind, -1, -1, {}});
+    return idx;
+  case 'v': case 'z': {
+    schema.nodes.push_back({kind, -1, -1, {}});
+    int elem = parseSerNode(s, pos, schema, structNodes);
+    schema.nodes[idx].elem = elem;
+    return elem < 0 ? -1 : idx;
+  }
+  case 'm': {
+    schema.nodes.push_back({kind, -1, -1, {}});
+    int key = parseSerNode(s, pos, schema, structNodes);
+    if (key < 0) {
+      return -1;
+    }
+    int val = parseSerNode(s, pos, schema, structNodes);
+    schema.nodes[idx].elem = key;
+    schema.nodes[idx].val = val;
+    return val < 0 ? -1 : idx;
+  }
+  case 'r': case 'u': {
+    if (!parseSerNumber(s, pos, n)) {
+      return -1;
+    }
+    schema.nodes.push_back({kind, -1, -1, {}});
+    structNodes.push_back(idx);
+    int nSubStructs = (kind == 'r') ? 1 : n;
+    for (int i = 0; i < nSubStructs; ++i) {
+      int nFields = n;
+      if (kind == 'u' && !parseSerNumber(s, pos, nFields)) {
+	return -1;
+      }
+      std::vector<int> fields;
+      for (int j = 0; j < nFields; ++j) {
+	int field = parseSerNode(s, pos, schema, structNodes);
+	if (field < 0) {
+	  return -1;
+	}
+	fields.push_back(field);
+      }
+      schema.nodes[idx].fields.push_back(std::move(fields));
+    }
+    return idx;
+  }
+  case '@':
+    if (!parseSerNumber(s, pos, n) || n >= (int)structNodes.size()) {
+      return -1;
+    }
+    return structNodes[n];
+  default:
+    return -1;
+  }
+}
+
+// Return the parsed schema for [schemaCell]. Schemas are generated by
+// the compiler, so an invalid schema is a fatal error.
+static SerSchema *getSerSchema(Cell &schemaCell) {
+  std::string s = stringToStdString(schemaCell);
+  auto iter = serSchemaCache.find(s);
+  if (iter != serSchemaCache.end()) {
+    return iter->second.get();
+  }
+  std::unique_ptr<SerSchema> schema = std::make_unique<SerSchema>();
+  size_t pos = 0;
+  std::vector<int> structNodes;
+  if (parseSerNode(s, pos, *schema, structNodes) != 0 || pos != s.size()) {
+    BytecodeEngine::fatalError("Invalid serialization schema");
+  }
+  // 64-bit FNV-1a
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (char c : s) {
+    hash = (hash ^ (uint8_t)c) * 0x100000001b3ULL;
+  }
+  schema->header.push_back((char)serFormatVersion);
+  for (int i = 0; i < 8; ++i) {
+    schema->header.push_back((char)(hash >> (8 * i)));
+  }
+  SerSchema *schemaPtr = schema.get();
+  serSchemaCache[s] = std::move(schema);
+  return schemaPtr;
+}
+
+//------------------------------------------------------------------------
+
+static void serVarint(uint64_t x, std::string &buf) {
+  while (x >= 0x80) {
+    buf.push_back((char)(x | 0x80));
+    x >>= 7;
+  }
+  buf.push_back((char)x);
+}
+
+static void serZigzag(int64_t x, std::string &buf) {
+  serVarint(((uint64_t)x << 1) ^ (uint64_t)(x >> 63), buf);
+}
+
+static void serRaw(const void *data, size_t n, std::string &buf) {
+  buf.append((const char *)data, n);
+}
+
+// Serialize [cell], described by node [nodeIdx], into [buf]. Nested
+// values are walked with an explicit stack rather than by recursion,
+// so a long chain of a recursive type (e.g., a linked list) can't
+// overflow the C stack. This doesn't allocate on the heap, so it
+// never triggers GC.
+static void serValue(SerSchema &schema, int nodeIdx, Cell cell, std::string &buf) {
+  // values still to be written, last one first
+  std::vector<std::pair<int, Cell>> todo;
+  // children of the current value, in order
+  std::vector<std::pair<int, Cell>> children;
+  todo.emplace_back(nodeIdx, cell);
+  while (!todo.empty()) {
+    SerNode &node = schema.nodes[todo.back().first];
+    Cell cell = todo.back().second;
+    todo.pop_back();
+    children.clear();
+    switch (node.kind) {
+    case 'i':
+    case 'e':
+      serZigzag(cellInt(cell), buf);
+      break;
+    case 'f': {
+      float x = cellFloat(cell);
+      serRaw(&x, 4, buf);
+      break;
+    }
+    case 'd': {
+      double x = cellDouble(cell);
+      serRaw(&x, 8, buf);
+      break;
+    }
+    case 'b':
+      buf.push_back(cellBool(cell) ? 1 : 0);
+      break;
+    case 's': {
+      if (cellIsNilPtr(cell)) {
+	buf.push_back(0);
+	break;
+      }
+      int64_t n = stringByteLength(cell);
+      serVarint((uint64_t)n + 1, buf);
+      serRaw(stringData(cell), (size_t)n, buf);
+      break;
+    }
+    case 'v': {
+      if (cellIsNilPtr(cell)) {
+	buf.push_back(0);
+	break;
+      }
+      int64_t n = vectorLength(cell);
+      serVarint((uint64_t)n + 1, buf);
+      if (n == 0) {
+	break;
+      }
+      switch (schema.nodes[node.elem].kind) {
+      case 'i': {
+	const int64_t *elems = vectorIntElems(cell);
+	for (int64_t i = 0; i < n; ++i) {
+	  serZigzag(elems[i], buf);
+	}
+	break;
+      }
+      case 'f':
+	serRaw(vectorFloatElems(cell), (size_t)n * sizeof(float), buf);
+	break;
+      case 'b':
+	serRaw(vectorBoolElems(cell), (size_t)n, buf);
+	break;
+      default:
+	for (int64_t i = 0; i < n; ++i) {
+	  children.emplace_back(node.elem, vectorGet(cell, i));
+	}
+	break;
+      }
+      break;
+    }
+    case 'z': {
+      if (cellIsNilPtr(cell)) {
+	buf.push_back(0);
+	break;
+      }
+      // the size field in the handle is the set's length
+      int64_t n = heapObjSize(cellPtr(cell));
+      serVarint((uint64_t)n + 1, buf);
+      setForEach(cell, [&node, &children](Cell elemCell) {
+	children.emplace_back(node.elem, elemCell);
+      });
+      break;
+    }
+    case 'm': {
+      if (cellIsNilPtr(cell)) {
+	buf.push_back(0);
+	break;
+      }
+      // the size field in the handle is the map's length
+      int64_t n = heapObjSize(cellPtr(cell));
+      serVarint((uint64_t)n + 1, buf);
+      mapForEach(cell, [&node, &children](Cell keyCell, Cell valueCell) {
+	children.emplace_back(node.elem, keyCell);
+	children.emplace_back(node.val, valueCell);
+      });
+      break;
+    }
+    case 'r': {
+      if (cellIsNilPtr(cell)) {
+	buf.push_back(0);
+	break;
+      }
+      buf.push_back(1);
+      Cell *fields = (Cell *)cellPtr(cell) + 1;
+      std::vector<int> &fieldNodes = node.fields[0];
+      for (size_t i = 0; i < fieldNodes.size(); ++i) {
+	children.emplace_back(fieldNodes[i], fields[i]);
+      }
+      break;
+    }
+    case 'u': {
+      if (cellIsNilPtr(cell)) {
+	buf.push_back(0);
+	break;
+      }
+      Cell *fields = (Cell *)cellPtr(cell) + 1;
+      int64_t id = cellInt(fields[0]);
+      if (id < 0 || id >= (int64_t)node.fields.size()) {
+	BytecodeEngine::fatalError("Invalid substruct ID");
+      }
+      serVarint((uint64_t)id + 1, buf);
+      std::vector<int> &fieldNodes = node.fields[id];
+      for (size_t i = 0; i < fieldNodes.size(); ++i) {
+	children.emplace_back(fieldNodes[i], fields[1 + i]);
+      }
+      break;
+    }
+    }
+    todo.insert(todo.end(), children.rbegin(), children.rend());
+  }
+}
+
+//------------------------------------------------------------------------
+
+// Reads from a DeserBuf. The StringBuf's data can move during GC, so
+// this holds on to the DeserBuf cell (which must be visible to the
+// GC), and looks up the data pointer on each access.
+struct DeserReader {
+  Cell &inCell;
+  int64_t pos;
+  int64_t end;
+
+  DeserReader(Cell &aInCell): inCell(aInCell) {
+    DeserBuf *in = (DeserBuf *)cellHeapPtr(inCell);
+    pos = cellInt(in->pos);
+    end = stringBufLength(in->data);
+  }
+
+  const uint8_t *data() {
+    DeserBuf *in = (DeserBuf *)cellHeapPtr(inCell);
+    return stringBufData(in->data) + pos;
+  }
+
+  bool readRaw(void *dest, int64_t n) {
+    if (pos > end - n) {
+      return false;
+    }
+    memcpy(dest, data(), n);
+    pos += n;
+    return true;
+  }
+
+  bool readVarint(uint64_t &x) {
+    const uint8_t *p = data();
+    x = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      if (pos >= end) {
+	return false;
+      }
+      uint8_t byte = *p++;
+      ++pos;
+      x |= (uint64_t)(byte & 0x7f) << shift;
+      if (!(byte & 0x80)) {
+	return true;
+      }
+    }
+    return false;
+  }
+
+  bool readZigzag(int64_t &x) {
+    uint64_t u;
+    if (!readVarint(u)) {
+      return false;
+    }
+    x = (int64_t)(u >> 1) ^ -(int64_t)(u & 1);
+    return x >= bytecodeMinInt && x <= bytecodeMaxInt;
+  }
+
+  // Read a length, encoded as varint(length + 1), with zero meaning
+  // nil. Every element takes at least one byte, so a length longer
+  // than the remaining data is an error.
+  bool readLength(int64_t &n, bool &nil) {
+    uint64_t u;
+    if (!readVarint(u)) {
+      return false;
+    }
+    nil = u == 0;
+    n = nil ? 0 : (int64_t)(u - 1);
+    return u <= (uint64_t)(end - pos) + 1;
+  }
+};
+
+// A container, struct, or varstruct that's partly deserialized.
+struct DeserFrame {
+  int nodeIdx;
+  Cell value;			// the container or tuple
+  Cell key;			// 'm': the key read for the current entry
+  bool haveKey;			// 'm': true if [key] has been read
+  int64_t id;			// 'r', 'u': substruct ID
+  int64_t n;			// number of elements, or fields
+  int64_t i;			// number of elements or fields done
+};
+
+// Start deserializing a value, described by node [nodeIdx]. A value
+// with no nested values (including scalars, nil values, and empty
+// containers) is stored in [result], and the return value is
+// [deserDone]. Otherwise, a frame for the value is pushed on
+// [frames], and the return value is [deserMore]. Returns [deserError]
+// on error.
+// NB: this may trigger GC
+enum DeserStep { deserDone, deserMore, deserError };
+static DeserStep deserBegin(SerSchema &schema, int nodeIdx, DeserReader &in,
+			    std::deque<DeserFrame> &frames, Cell &result,
+			    BytecodeEngine &engine) {
+  SerNode &node = schema.nodes[nodeIdx];
+  switch (node.kind) {
+  case 'i':
+  case 'e': {
+    int64_t x;
+    if (!in.readZigzag(x)) {
+      return deserError;
+    }
+    result = cellMakeInt(x);
+    return deserDone;
+  }
+  case 'f': {
+    float x;
+    if (!in.readRaw(&x, 4)) {
+      return deserError;
+    }
+    result = cellMakeFloat(x);
+    return deserDone;
+  }
+  case 'd': {
+    double x;
+    if (!in.readRaw(&x, 8)) {
+      return deserError;
+    }
+    // NB: this may trigger GC
+    result = engine.heapAllocDouble(x);
+    return deserDone;
+  }
+  case 'b': {
+    uint8_t x;
+    if (!in.readRaw(&x, 1) || x > 1) {
+      return deserError;
+    }
+    result = cellMakeBool(x != 0);
+    return deserDone;
+  }
+  case 's': {
+    int64_t n;
+    bool nil;
+    if (!in.readLength(n, nil)) {
+      return deserError;
+    }
+    if (nil) {
+      result = cellMakeNilHeapPtr();
+      return deserDone;
+    }
+    // NB: this may trigger GC
+    result = stringAlloc(n, engine);
+    return in.readRaw(stringData(result), n) ? deserDone : deserError;
+  }
+  case 'v':
+  case 'z':
+  case 'm': {
+    int64_t n;
+    bool nil;
+    if (!in.readLength(n, nil)) {
+      return deserError;
+    }
+    if (nil) {
+      result = cellMakeNilHeapPtr();
+      return deserDone;
+    }
+    if (node.kind == 'v') {
+      switch (schema.nodes[node.elem].kind) {
+      case 'i': {
+	std::vector<int64_t> elems(n);
+	for (int64_t i = 0; i < n; ++i) {
+	  if (!in.readZigzag(elems[i])) {
+	    return deserError;
+	  }
+	}
+	// NB: this may trigger GC
+	result = vectorMakeInt(elems.data(), n, engine);
+	return deserDone;
+      }
+      case 'f': {
+	std::vector<float> elems(n);
+	if (!in.readRaw(elems.data(), n * (int64_t)sizeof(float))) {
+	  return deserError;
+	}
+	// NB: this may trigger GC
+	result = vectorMakeFloat(elems.data(), n, engine);
+	return deserDone;
+      }
+      case 'b': {
+	std::vector<uint8_t> elems(n);
+	if (!in.readRaw(elems.data(), n)) {
+	  return deserError;
+	}
+	for (int64_t i = 0; i < n; ++i) {
+	  if (elems[i] > 1) {
+	    return deserError;
+	  }
+	}
+	// NB: this may trigger GC
+	result = vectorMakeBool(elems.data(), n, engine);
+	return deserDone;
+      }
+      default:
+	// NB: this may trigger GC
+	result = vectorMake(engine);
+	break;
+      }
+    } else if (node.kind == 'z') {
+      // NB: this may trigger GC
+      result = setMake(n, engine);
+    } else {
+      // NB: this may trigger GC
+      result = mapMake(n, engine);
+    }
+    if (n == 0) {
+      return deserDone;
+    }
+    frames.push_back({nodeIdx, result, cellMakeNilHeapPtr(), false, 0, n, 0});
+    engine.pushGCRoot(frames.back().value);
+    engine.pushGCRoot(frames.back().key);
+    return deserMore;
+  }
+  case 'r':
+  case 'u': {
+    uint64_t tag;
+    if (!in.readVarint(tag)) {
+      return deserError;
+    }
+    if (tag == 0) {
+      result = cellMakeNilHeapPtr();
+      return deserDone;
+    }
+    int64_t id = (int64_t)tag - 1;
+    if (id >= (int64_t)node.fields.size()) {
+      return deserError;
+    }
+    int64_t nFields = (int64_t)node.fields[id].size();
+    int64_t firstField = (node.kind == 'u') ? 1 : 0;
+    int64_t nCells = firstField + nFields;
+    // NB: this may trigger GC
+    Cell *tuple = (Cell *)engine.heapAllocTuple((uint64_t)nCells, 0);
+    for (int64_t i = 0; i < nCells; ++i) {
+      tuple[1 + i] = cellMakeInt(0);
+    }
+    if (node.kind == 'u') {
+      tuple[1] = cellMakeInt(id);
+    }
+    result = cellMakeHeapPtr(tuple);
+    if (nFields == 0) {
+      return deserDone;
+    }
+    frames.push_back({nodeIdx, result, cellMakeNilHeapPtr(), false, id, nFields, 0});
+    engine.pushGCRoot(frames.back().value);
+    engine.pushGCRoot(frames.back().key);
+    return deserMore;
+  }
+  default:
+    return deserError;
+  }
+}
+
+// Add the deserialized value [child] to the top frame. Returns false
+// on error.
+// NB: this may trigger GC
+static bool deserAddChild(SerSchema &schema, DeserFrame &frame, Cell &child,
+			  BytecodeEngine &engine) {
+  SerNode &node = schema.nodes[frame.nodeIdx];
+  switch (node.kind) {
+  case 'v':
+    // NB: this may trigger GC
+    vectorAppend(frame.value, child, engine);
+    ++frame.i;
+    return true;
+  case 'z': {
+    bool stringElems = schema.nodes[node.elem].kind == 's';
+    if (stringElems && cellIsNilPtr(child)) {
+      return false;
+    }
+    // NB: this may trigger GC
+    setInsert(frame.value, child, stringElems, engine);
+    ++frame.i;
+    return true;
+  }
+  case 'm': {
+    bool stringKeys = schema.nodes[node.elem].kind == 's';
+    if (!frame.haveKey) {
+      if (stringKeys && cellIsNilPtr(child)) {
+	return false;
+      }
+      frame.key = child;
+      frame.haveKey = true;
+      return true;
+    }
+    // NB: this may trigger GC
+    mapSet(frame.value, frame.key, child, stringKeys, engine);
+    frame.key = cellMakeNilHeapPtr();
+    frame.haveKey = false;
+    ++frame.i;
+    return true;
+  }
+  default: {
+    int64_t firstField = (node.kind == 'u') ? 1 : 0;
+    Cell *tuple = (Cell *)cellPtr(frame.value);
+    tuple[1 + firstField + frame.i] = child;
+    ++frame.i;
+    return true;
+  }
+  }
+}
+
+// Return the node for the next value to read in [frame].
+static int deserNextNode(SerSchema &schema, DeserFrame &frame) {
+  SerNode &node = schema.nodes[frame.nodeIdx];
+  switch (node.kind) {
+  case 'v':
+  case 'z':
+    return node.elem;
+  case 'm':
+    return frame.haveKey ? node.val : node.elem;
+  default:
+    return node.fields[frame.id][frame.i];
+  }
+}
+
+// Deserialize a value, described by node [nodeIdx], into [result].
+// [result] must be visible to the GC. Nested values are handled with
+// an explicit stack of frames rather than by recursion, so a long
+// chain of a recursive type (e.g., a linked list) can't overflow the
+// C stack. Returns false on error.
+// NB: this may trigger GC
+static bool deserValue(SerSchema &schema, int nodeIdx, DeserReader &in, Cell &result,
+		       BytecodeEngine &engine) {
+  // frames are only added and removed at the end, so the Cells in
+  // them don't move, and can be GC roots
+  std::deque<DeserFrame> frames;
+  Cell child = cellMakeNilHeapPtr();
+  engine.pushGCRoot(child);
+  bool ok = true;
+  while (ok) {
+    // NB: this may trigger GC
+    DeserStep step = deserBegin(schema, nodeIdx, in, frames, child, engine);
+    if (step == deserError) {
+      ok = false;
+      break;
+    }
+    if (step == deserMore) {
+      nodeIdx = deserNextNode(schema, frames.back());
+      continue;
+    }
+
+    // pass the finished value up to its parent, and pop any frames
+    // that are now complete
+    while (!frames.empty()) {
+      // NB: this may trigger GC
+      if (!deserAddChild(schema, frames.back(), child, engine)) {
+	ok = false;
+	break;
+      }
+      if (frames.back().i < frames.back().n) {
+	break;
+      }
+      child = frames.back().value;
+      engine.popGCRoot(frames.back().key);
+      engine.popGCRoot(frames.back().value);
+      frames.pop_back();
+    }
+    if (!ok || frames.empty()) {
+      break;
+    }
+    nodeIdx = deserNextNode(schema, frames.back());
+  }
+
+  while (!frames.empty()) {
+    engine.popGCRoot(frames.back().key);
+    engine.popGCRoot(frames.back().value);
+    frames.pop_back();
+  }
+  engine.popGCRoot(child);
+  if (ok) {
+    result = child;
+  }
+  return ok;
+}
+
+//------------------------------------------------------------------------
+
+// _ser(val: $T, out: StringBuf, schema: String)
+static NativeFuncDefn(runtime_ser) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 3 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsHeapPtr(engine.arg(1)) ||
+      !cellIsPtr(engine.arg(2))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &valCell = engine.arg(0);
+  Cell &outCell = engine.arg(1);
+  Cell &schemaCell = engine.arg(2);
+
+  SerSchema *schema = getSerSchema(schemaCell);
+  std::string buf = schema->header;
+  serValue(*schema, 0, valCell, buf);
+  // NB: this may trigger GC
+  stringBufAppend(outCell, (uint8_t *)buf.data(), (int64_t)buf.size(), engine);
+
+  engine.push(cellMakeInt(0));
+}
+
+// _deser(in: DeserBuf, type: $T, schema: String) -> Result[$T]
+static NativeFuncDefn(runtime_deser) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 3 ||
+      !cellIsHeapPtr(engine.arg(0)) ||
+      !cellIsPtr(engine.arg(2))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &inCell = engine.arg(0);
+  Cell &schemaCell = engine.arg(2);
+
+  DeserBuf *deserBuf = (DeserBuf *)cellHeapPtr(inCell);
+  engine.failOnNilPtr(deserBuf);
+  SerSchema *schema = getSerSchema(schemaCell);
+  int64_t startPos = cellInt(deserBuf->pos);
+  if (!deserHeaderBytes(deserBuf, (const uint8_t *)schema->header.data(),
+			(int64_t)schema->header.size())) {
+    engine.push(cellMakeError());
+    return;
+  }
+  DeserReader in(inCell);
+
+  Cell result = cellMakeNilHeapPtr();
+  engine.pushGCRoot(result);
+  // NB: this may trigger GC
+  bool ok = deserValue(*schema, 0, in, result, engine);
+  engine.popGCRoot(result);
+
+  // the DeserBuf may have been moved by GC
+  deserBuf = (DeserBuf *)cellHeapPtr(inCell);
+  if (ok) {
+    deserBuf->pos = cellMakeInt(in.pos);
+    engine.push(result);
+  } else {
+    deserBuf->pos = cellMakeInt(startPos);
+    engine.push(cellMakeError());
+  }
+}
+
 //------------------------------------------------------------------------
 
 void runtime_serdeser_init(BytecodeEngine &engine) {
   engine.addNativeFunction("ser_IT", &runtime_ser_IT);
   engine.addNativeFunction("ser_FT", &runtime_ser_FT);
+  engine.addNativeFunction("ser_DT", &runtime_ser_DT);
   engine.addNativeFunction("ser_BT", &runtime_ser_BT);
   engine.addNativeFunction("ser_ST", &runtime_ser_ST);
   engine.addNativeFunction("serHeader_ST", &runtime_serHeader_ST);
   engine.addNativeFunction("deserInt_8DeserBuf", &runtime_deserInt_8DeserBuf);
   engine.addNativeFunction("deserFloat_8DeserBuf", &runtime_deserFloat_8DeserBuf);
+  engine.addNativeFunction("deserDouble_8DeserBuf", &runtime_deserDouble_8DeserBuf);
   engine.addNativeFunction("deserBool_8DeserBuf", &runtime_deserBool_8DeserBuf);
   engine.addNativeFunction("deserString_8DeserBuf", &runtime_deserString_8DeserBuf);
   engine.addNativeFunction("deserHeader_S8DeserBuf", &runtime_deserHeader_S8DeserBuf);
   engine.addNativeFunction("deserEnd_8DeserBuf", &runtime_deserEnd_8DeserBuf);
+  engine.addNativeFunction("_ser", &runtime_ser);
+  engine.addNativeFunction("_deser", &runtime_deser);
 }
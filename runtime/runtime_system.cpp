@@ -12,24 +12,95 @@
 #include <string.h>
 #include <unistd.h>
 #include <dirent.h>
+#include <fcntl.h>
+#include <fnmatch.h>
 #include <signal.h>
 #include <pwd.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <algorithm>
 #include <string>
+#include <vector>
 #include "aconf.h"
+#include "SysIO.h"
+#include "ThreadPool.h"
 #include "runtime_datetime.h"
+#include "runtime_process.h"
 #include "runtime_String.h"
 #include "runtime_StringBuf.h"
 #include "runtime_Vector.h"
 
 //------------------------------------------------------------------------
 
+// for DirEntry.type
+#define dirEntryFile    0
+#define dirEntryDir     1
+#define dirEntrySymLink 2
+#define dirEntryOther   3
+
+// Minimum number of entries in the root directory for walkDir to
+// walk the subtrees in parallel.
+#define walkDirParallelMin 4
+
+//------------------------------------------------------------------------
+
+struct WalkOptions {
+  uint64_t hdr;
+  Cell pattern;               // String
+  Cell followSymLinks;        // Bool
+  Cell maxDepth;              // Int
+  Cell parallel;              // Bool
+};
+
+struct DirEntry {
+  uint64_t hdr;
+  Cell path;                  // String
+  Cell type;                  // Int (DirEntryType)
+  Cell size;                  // Int
+  Cell modTime;               // heap pointer -> Timestamp
+};
+
+#define dirEntryNCells (sizeof(DirEntry) / sizeof(Cell) - 1)
+
+// walkDir collects entries here (outside the GC heap, so the
+// traversal can run on the thread pool), and then converts them to
+// DirEntry objects.
+struct WalkEntry {
+  std::string path;
+  int64_t type;
+  int64_t size;
+  int64_t seconds;
+  int64_t nanoseconds;
+};
+
+struct WalkParams {
+  std::string pattern;
+  bool followSymLinks;
+  int64_t maxDepth;
+};
+
+// A directory being walked, as a (device, inode) pair -- used to
+// detect symlink loops.
+typedef std::pair<dev_t, ino_t> WalkDirID;
+
+//------------------------------------------------------------------------
+
 static Cell commandLineArgsVector = cellNilHeapPtrInit;
 
 //------------------------------------------------------------------------
 
+static void readDirNames(int dirFD, std::vector<std::pair<std::string, unsigned char>> &names);
+static void walkEntry(int dirFD, const std::string &dirPath, const std::string &name,
+		      unsigned char dType, int64_t depth, const WalkParams &params,
+		      std::vector<WalkDirID> &ancestors, std::vector<WalkEntry> &out);
+static void walkSubdir(int dirFD, const std::string &name, const std::string &path,
+		       int64_t depth, const WalkParams &params,
+		       std::vector<WalkDirID> &ancestors, std::vector<WalkEntry> &out);
+static int64_t statModTimeNS(const struct stat &st);
+
+//------------------------------------------------------------------------
+
 static void splitPath(const std::string &path, size_t start, std::vector<std::string> &elements) {
   size_t i = start;
   while (i < path.size()) {
@@ -381,6 +452,23 @@ static NativeFuncDefn(runtime_readFile_S) {
 
   FILE *f = fopen(path.c_str(), "rb");
   if (f) {
+    // for a regular file, read directly into a string of the right
+    // size -- if the size turns out to be wrong (e.g., the file is
+    // being modified), fall back to reading in chunks
+    struct stat st;
+    if (fstat(fileno(f), &st) == 0 && S_ISREG(st.st_mode) &&
+	st.st_size > 0 && st.st_size <= bytecodeMaxInt) {
+      // NB: this may trigger GC
+      Cell sCell = stringAlloc((int64_t)st.st_size, engine);
+      size_t n = fread(stringData(sCell), 1, (size_t)st.st_size, f);
+      if (n == (size_t)st.st_size && fgetc(f) == EOF) {
+	fclose(f);
+	engine.push(sCell);
+	return;
+      }
+      rewind(f);
+    }
+
     char buf[4096];
     std::string sBuf;
     size_t n;
@@ -436,15 +524,8 @@ static NativeFuncDefn(runtime_writeFile_SS) {
 
   std::string path = stringToStdString(pathCell);
 
-  FILE *f = fopen(path.c_str(), "wb");
-  if (f) {
-    int64_t n = stringByteLength(sCell);
-    if (fwrite(stringData(sCell), 1, n, f) == n) {
-      engine.push(cellMakeInt(0));
-    } else {
-      engine.push(cellMakeError());
-    }
-    fclose(f);
+  if (writeFile(path, stringData(sCell), (size_t)stringByteLength(sCell))) {
+    engine.push(cellMakeInt(0));
   } else {
     engine.push(cellMakeError());
   }
@@ -464,15 +545,8 @@ static NativeFuncDefn(runtime_writeFile_ST) {
 
   std::string path = stringToStdString(pathCell);
 
-  FILE *f = fopen(path.c_str(), "wb");
-  if (f) {
-    int64_t n = stringBufLength(sbCell);
-    if (fwrite(stringBufData(sbCell), 1, n, f) == n) {
-      engine.push(cellMakeInt(0));
-    } else {
-      engine.push(cellMakeError());
-    }
-    fclose(f);
+  if (writeFile(path, stringBufData(sbCell), (size_t)stringBufLength(sbCell))) {
+    engine.push(cellMakeInt(0));
   } else {
     engine.push(cellMakeError());
   }
@@ -507,6 +581,102 @@ static NativeFuncDefn(runtime_readDir_S) {
   }
 }
 
+// walkDir(root: String, opts: WalkOptions) -> Result[Vector[DirEntry]]
+// Returns the entries in the tree under [root] (not including [root]
+// itself), in pre-order, with the names in each directory sorted.
+// Directories are always descended into (up to opts.maxDepth, where
+// -1 means no limit), but only entries whose names match
+// opts.pattern (a glob; "" matches everything) are returned. Entries
+// that can't be read are skipped. The type comes from the directory
+// listing, so entries that aren't returned are never stat'ed.
+static NativeFuncDefn(runtime_walkDir_S11WalkOptions) {
+#if CHECK_RUNTIME_FUNC_ARGS
+  if (engine.nArgs() != 2 ||
+      !cellIsPtr(engine.arg(0)) ||
+      !cellIsHeapPtr(engine.arg(1))) {
+    BytecodeEngine::fatalError("Invalid argument");
+  }
+#endif
+  Cell &rootCell = engine.arg(0);
+  Cell &optsCell = engine.arg(1);
+
+  WalkOptions *opts = (WalkOptions *)cellHeapPtr(optsCell);
+  engine.failOnNilPtr(opts);
+  WalkParams params;
+  params.pattern = stringToStdString(opts->pattern);
+  params.followSymLinks = cellBool(opts->followSymLinks);
+  params.maxDepth = cellInt(opts->maxDepth);
+  bool parallel = cellBool(opts->parallel);
+  std::string root = stringToStdString(rootCell);
+  std::string rootPath = root;
+  while (rootPath.size() > 1 && rootPath.back() == '/') {
+    rootPath.pop_back();
+  }
+
+  //--- list the root directory
+  int rootFD = open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (rootFD < 0) {
+    engine.push(cellMakeError());
+    return;
+  }
+  std::vector<WalkDirID> rootAncestors;
+  struct stat st;
+  if (fstat(rootFD, &st) == 0) {
+    rootAncestors.push_back(WalkDirID(st.st_dev, st.st_ino));
+  }
+  std::vector<std::pair<std::string, unsigned char>> names;
+  readDirNames(rootFD, names);
+
+  //--- walk the subtrees -- each root entry (and everything under it)
+  // is collected separately, so the result doesn't depend on the
+  // number of threads
+  int64_t nNames = (int64_t)names.size();
+  std::vector<std::vector<WalkEntry>> results(nNames);
+  auto walkChunk = [rootFD, &rootPath, &names, &params, &rootAncestors, &results]
+                   (int64_t first, int64_t last) {
+    for (int64_t i = first; i < last; ++i) {
+      std::vector<WalkDirID> ancestors = rootAncestors;
+      walkEntry(rootFD, rootPath, names[i].first, names[i].second, 0, params,
+		ancestors, results[i]);
+    }
+  };
+  if (parallel && nNames >= walkDirParallelMin) {
+    parallelFor(nNames, 1, walkChunk);
+  } else {
+    walkChunk(0, nNames);
+  }
+  close(rootFD);
+
+  //--- convert to DirEntry objects
+  // NB: this may trigger GC
+  Cell vCell = vectorMake(engine);
+  engine.pushGCRoot(vCell);
+  for (std::vector<WalkEntry> &result : results) {
+    for (WalkEntry &entry : result) {
+      // NB: this may trigger GC
+      Cell pathCell = stringMake((const uint8_t *)entry.path.c_str(), (int64_t)entry.path.size(),
+				 engine);
+      engine.pushGCRoot(pathCell);
+      // NB: this may trigger GC
+      Cell modTimeCell = timestampMake(entry.seconds, entry.nanoseconds, engine);
+      engine.pushGCRoot(modTimeCell);
+      // NB: this may trigger GC
+      DirEntry *dirEntry = (DirEntry *)engine.heapAllocTuple(dirEntryNCells, 0);
+      dirEntry->path = pathCell;
+      dirEntry->type = cellMakeInt(entry.type);
+      dirEntry->size = cellMakeInt(entry.size);
+      dirEntry->modTime = modTimeCell;
+      Cell entryCell = cellMakeHeapPtr(dirEntry);
+      // NB: this may trigger GC
+      vectorAppend(vCell, entryCell, engine);
+      engine.popGCRoot(modTimeCell);
+      engine.popGCRoot(pathCell);
+    }
+  }
+  engine.push(vCell);
+  engine.popGCRoot(vCell);
+}
+
 // copyFile(src: String, dest: String) -> Result[]
 static NativeFuncDefn(runtime_copyFile_SS) {
 #if CHECK_RUNTIME_FUNC_ARGS
@@ -522,34 +692,11 @@ static NativeFuncDefn(runtime_copyFile_SS) {
   std::string srcPath = stringToStdString(srcCell);
   std::string destPath = stringToStdString(destCell);
 
-  FILE *src = fopen(srcPath.c_str(), "rb");
-  if (!src) {
-    engine.push(cellMakeError());
-    return;
-  }
-
-  FILE *dest = fopen(destPath.c_str(), "wb");
-  if (!dest) {
-    fclose(src);
+  if (copyFile(srcPath, destPath)) {
+    engine.push(cellMakeInt(0));
+  } else {
     engine.push(cellMakeError());
-    return;
-  }
-
-  char buf[4096];
-  size_t n;
-  while ((n = fread(buf, 1, sizeof(buf), src)) > 0) {
-    if (fwrite(buf, 1, n, dest) != n) {
-      fclose(dest);
-      fclose(src);
-      engine.push(cellMakeError());
-      return;
-    }
   }
-
-  fclose(dest);
-  fclose(src);
-
-  engine.push(cellMakeInt(0));
 }
 
 // run(command: Vector[String]) -> Result[Int]
@@ -562,46 +709,17 @@ static NativeFuncDefn(runtime_run_VS) {
 #endif
   Cell &commandCell = engine.arg(0);
 
-  //--- fork
-  pid_t child = fork();
+  pid_t child = spawnCommand(commandCell);
   if (child < 0) {
     engine.push(cellMakeError());
     return;
   }
-
-  //--- child process
-  if (child == 0) {
-
-    //--- construct argv
-    int64_t argc = vectorLength(commandCell);
-    if (argc < 1) {
-      BytecodeEngine::fatalError("Invalid argument");
-    }
-    if (argc > INT64_MAX - 1) {
-      BytecodeEngine::fatalError("Integer overflow");
-    }
-    char **argv = new char*[argc + 1];
-    for (int64_t i = 0; i < argc; ++i) {
-      Cell argCell = vectorGet(commandCell, i);
-      std::string argString = stringToStdString(argCell);
-      argv[i] = new char[argString.size() + 1];
-      memcpy(argv[i], argString.c_str(), argString.size() + 1);
-    }
-    argv[argc] = nullptr;
-
-    //--- exec
-    execvp(argv[0], argv);
-    kill(getpid(), SIGABRT);  // just in case execvp fails
-  }
-
-  //--- parent process
-  int status;
-  if (waitpid(child, &status, 0) < 0 ||
-      !WIFEXITED(status)) {
+  int status = waitCommand(child);
+  if (status < 0) {
     engine.push(cellMakeError());
     return;
   }
-  engine.push(cellMakeInt(WEXITSTATUS(status)));
+  engine.push(cellMakeInt(status));
 }
 
 // sleep(useconds: Int)
@@ -653,12 +771,127 @@ void runtime_system_init(BytecodeEngine &engine) {
   engine.addNativeFunction("writeFile_SS", &runtime_writeFile_SS);
   engine.addNativeFunction("writeFile_ST", &runtime_writeFile_ST);
   engine.addNativeFunction("readDir_S", &runtime_readDir_S);
+  engine.addNativeFunction("walkDir_S11WalkOptions", &runtime_walkDir_S11WalkOptions);
   engine.addNativeFunction("copyFile_SS", &runtime_copyFile_SS);
   engine.addNativeFunction("run_VS", &runtime_run_VS);
   engine.addNativeFunction("sleep_I", &runtime_sleep_I);
   engine.addNativeFunction("heapSize", &runtime_heapSize);
 }
 
+//------------------------------------------------------------------------
+// walkDir
+//------------------------------------------------------------------------
+
+// Read the names (and d_type values) in the directory [dirFD], sorted
+// by name, skipping "." and "..". Doesn't close [dirFD].
+static void readDirNames(int dirFD, std::vector<std::pair<std::string, unsigned char>> &names) {
+  // fdopendir takes ownership of its fd, so give it a copy
+  int fd = dup(dirFD);
+  if (fd < 0) {
+    return;
+  }
+  DIR *dir = fdopendir(fd);
+  if (!dir) {
+    close(fd);
+    return;
+  }
+  struct dirent *de;
+  while ((de = readdir(dir))) {
+    if (de->d_name[0] == '.' &&
+	(de->d_name[1] == '\0' || (de->d_name[1] == '.' && de->d_name[2] == '\0'))) {
+      continue;
+    }
+    names.push_back(std::make_pair(std::string(de->d_name), (unsigned char)de->d_type));
+  }
+  closedir(dir);
+  std::sort(names.begin(), names.end());
+}
+
+// Handle the entry [name] (with d_type [dType]) in the directory
+// [dirFD] (whose path is [dirPath]): add it to [out] if it matches
+// the pattern, and walk it if it's a directory. [depth] is the depth
+// of [dirPath] below the root. This runs on the thread pool, so it
+// must not touch the engine.
+static void walkEntry(int dirFD, const std::string &dirPath, const std::string &name,
+		      unsigned char dType, int64_t depth, const WalkParams &params,
+		      std::vector<WalkDirID> &ancestors, std::vector<WalkEntry> &out) {
+  std::string path = (dirPath == "/") ? "/" + name : dirPath + "/" + name;
+  bool match = params.pattern.empty() ||
+               fnmatch(params.pattern.c_str(), name.c_str(), 0) == 0;
+
+  // stat only if the entry is returned, or if d_type doesn't say
+  // whether it's a directory
+  bool isDir;
+  if (match || dType == DT_UNKNOWN || (dType == DT_LNK && params.followSymLinks)) {
+    struct stat st;
+    if (fstatat(dirFD, name.c_str(), &st, params.followSymLinks ? 0 : AT_SYMLINK_NOFOLLOW)) {
+      return;
+    }
+    isDir = S_ISDIR(st.st_mode);
+    if (match) {
+      WalkEntry entry;
+      entry.path = path;
+      entry.type = S_ISREG(st.st_mode) ? dirEntryFile
+	           : S_ISDIR(st.st_mode) ? dirEntryDir
+	           : S_ISLNK(st.st_mode) ? dirEntrySymLink
+	           : dirEntryOther;
+      entry.size = (int64_t)st.st_size;
+      entry.seconds = (int64_t)st.st_mtime;
+      entry.nanoseconds = statModTimeNS(st);
+      out.push_back(std::move(entry));
+    }
+  } else {
+    isDir = dType == DT_DIR;
+  }
+
+  if (isDir && (params.maxDepth < 0 || depth < params.maxDepth)) {
+    walkSubdir(dirFD, name, path, depth + 1, params, ancestors, out);
+  }
+}
+
+// Walk the subdirectory [name] of [dirFD].
+static void walkSubdir(int dirFD, const std::string &name, const std::string &path,
+		       int64_t depth, const WalkParams &params,
+		       std::vector<WalkDirID> &ancestors, std::vector<WalkEntry> &out) {
+  int fd = openat(dirFD, name.c_str(),
+		  O_RDONLY | O_DIRECTORY | O_CLOEXEC | (params.followSymLinks ? 0 : O_NOFOLLOW));
+  if (fd < 0) {
+    return;
+  }
+
+  // a followed symlink can point back up the tree
+  struct stat st;
+  if (fstat(fd, &st)) {
+    close(fd);
+    return;
+  }
+  WalkDirID id(st.st_dev, st.st_ino);
+  if (std::find(ancestors.begin(), ancestors.end(), id) != ancestors.end()) {
+    close(fd);
+    return;
+  }
+  ancestors.push_back(id);
+
+  std::vector<std::pair<std::string, unsigned char>> names;
+  readDirNames(fd, names);
+  for (auto &entry : names) {
+    walkEntry(fd, path, entry.first, entry.second, depth, params, ancestors, out);
+  }
+
+  ancestors.pop_back();
+  close(fd);
+}
+
+static int64_t statModTimeNS(const struct stat &st) {
+#if HAVE_STAT_ST_MTIM
+  return (int64_t)st.st_mtim.tv_nsec;
+#elif HAVE_STAT_ST_MTIMESPEC
+  return (int64_t)st.st_mtimespec.tv_nsec;
+#else
+  return 0;
+#endif
+}
+
 //------------------------------------------------------------------------
 // support functions
 //------------------------------------------------------------------------
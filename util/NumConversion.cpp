@@ -16,6 +16,9 @@ using namespace double_conversion;
 
 //------------------------------------------------------------------------
 
+static bool scanDecimal(const char *s, size_t length,
+			bool &neg, uint64_t &mant, int &nSigDigits, int &exp10);
+static std::string numToString(double val, bool single, uint8_t format, int precision);
 static void trimTrailingZeros(char *buf);
 
 //------------------------------------------------------------------------
@@ -41,13 +44,45 @@ static int charToDigit[256] = {
 
 static char digitToChar[17] = "0123456789abcdef";
 
+// "00" .. "99", for converting two decimal digits at a time.
+static const char digitPairs[201] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+// Powers of ten that are exactly representable as floats/doubles,
+// for the fast paths in stringToFloatChecked() and
+// stringToDoubleChecked().
+static const float floatPow10[11] = {
+  1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+static const double doublePow10[23] = {
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Fallback for numbers that don't take the fast paths.
+static const StringToDoubleConverter stringToDoubleCvt(StringToDoubleConverter::NO_FLAGS,
+						       0.0, 0.0, "inf", "nan");
+
 //------------------------------------------------------------------------
 
 bool stringToInt56(const std::string &s, int radix, int64_t &out) {
+  return stringToInt56(s.c_str(), s.size(), radix, out);
+}
+
+bool stringToInt56(const char *s, size_t length, int radix, int64_t &out) {
   size_t i = 0;
   bool neg;
   uint64_t maxVal;
-  if (s[i] == '-') {
+  if (i < length && s[i] == '-') {
     neg = true;
     ++i;
   } else {
@@ -61,7 +96,15 @@ bool stringToInt56(const std::string &s, int radix, int64_t &out) {
     maxVal = UINT64_C(0x007fffffffffffff);
   }
   uint64_t x = 0;
-  for (; i < s.size(); ++i) {
+  if (radix == 10) {
+    // 16 decimal digits can't overflow 56 bits, so only the digits
+    // past that need the bounds check
+    size_t safeEnd = std::min(length, i + 16);
+    for (; i < safeEnd; ++i) {
+      x = x * 10 + (uint64_t)(s[i] - '0');
+    }
+  }
+  for (; i < length; ++i) {
     int digit = charToDigit[s[i] & 0xff];
     if (x > (maxVal - digit) / radix) {
       return false;
@@ -73,102 +116,242 @@ bool stringToInt56(const std::string &s, int radix, int64_t &out) {
 }
 
 bool stringToInt56Checked(const std::string &s, int radix, int64_t &out) {
+  return stringToInt56Checked(s.c_str(), s.size(), radix, out);
+}
+
+bool stringToInt56Checked(const char *s, size_t length, int radix, int64_t &out) {
   if (radix < 2 || radix > 16) {
     return false;
   }
   size_t i = 0;
-  if (s[i] == '-') {
+  if (i < length && s[i] == '-') {
     ++i;
   }
-  for (; i < s.size(); ++i) {
+  for (; i < length; ++i) {
     int digit = charToDigit[s[i] & 0xff];
     if (digit < 0 || digit >= radix) {
       return false;
     }
   }
-  return stringToInt56(s, radix, out);
+  return stringToInt56(s, length, radix, out);
 }
 
 void stringToFloat(const std::string &s, float &out) {
-  out = std::stof(s);
+  stringToFloat(s.c_str(), s.size(), out);
+}
+
+void stringToFloat(const char *s, size_t length, float &out) {
+  if (!stringToFloatChecked(s, length, out)) {
+    out = 0;
+  }
 }
 
 bool stringToFloatChecked(const std::string &s, float &out) {
+  return stringToFloatChecked(s.c_str(), s.size(), out);
+}
+
+bool stringToFloatChecked(const char *s, size_t length, float &out) {
+  bool neg;
+  uint64_t mant;
+  int nSigDigits, exp10;
+  if (!scanDecimal(s, length, neg, mant, nSigDigits, exp10)) {
+    return false;
+  }
+  // if there are at most 7 significant digits (so the mantissa is
+  // exact in a float), and the power of ten is exact in a float, a
+  // single float multiply or divide gives the correctly rounded
+  // result
+  if (mant == 0) {
+    out = neg ? -0.0f : 0.0f;
+  } else if (nSigDigits <= 7 && exp10 >= -10 && exp10 <= 10) {
+    float x = (float)mant;
+    if (exp10 < 0) {
+      x /= floatPow10[-exp10];
+    } else {
+      x *= floatPow10[exp10];
+    }
+    out = neg ? -x : x;
+  } else {
+    int nProcessed;
+    out = stringToDoubleCvt.StringToFloat(s, (int)length, &nProcessed);
+  }
+  return true;
+}
+
+void stringToDouble(const std::string &s, double &out) {
+  if (!stringToDoubleChecked(s.c_str(), s.size(), out)) {
+    out = 0;
+  }
+}
+
+bool stringToDoubleChecked(const std::string &s, double &out) {
+  return stringToDoubleChecked(s.c_str(), s.size(), out);
+}
+
+bool stringToDoubleChecked(const char *s, size_t length, double &out) {
+  bool neg;
+  uint64_t mant;
+  int nSigDigits, exp10;
+  if (!scanDecimal(s, length, neg, mant, nSigDigits, exp10)) {
+    return false;
+  }
+  // same as the float fast path, with 15 digits and 10^22
+  if (mant == 0) {
+    out = neg ? -0.0 : 0.0;
+  } else if (nSigDigits <= 15 && exp10 >= -22 && exp10 <= 22) {
+    double x = (double)mant;
+    if (exp10 < 0) {
+      x /= doublePow10[-exp10];
+    } else {
+      x *= doublePow10[exp10];
+    }
+    out = neg ? -x : x;
+  } else {
+    int nProcessed;
+    out = stringToDoubleCvt.StringToDouble(s, (int)length, &nProcessed);
+  }
+  return true;
+}
+
+// Check the syntax of a decimal floating point number, and accumulate
+// up to 19 significant digits in [mant], with the corresponding power
+// of ten in [exp10]. [nSigDigits] is the total number of significant
+// digits, including any that didn't fit in [mant]. Returns false if
+// [s] is not a valid number.
+static bool scanDecimal(const char *s, size_t length,
+			bool &neg, uint64_t &mant, int &nSigDigits, int &exp10) {
   // -? [0-9]* .? [0-9]* ([Ee][+-]?[0-9]+)?
   // (there must be at least one digit before the E)
   size_t i = 0;
-  if (s[i] == '-') {
+  neg = false;
+  if (i < length && s[i] == '-') {
+    neg = true;
     ++i;
   }
+  mant = 0;
+  nSigDigits = 0;
+  exp10 = 0;
   size_t nDigits = 0;
-  while (s[i] >= '0' && s[i] <= '9') {
+  while (i < length && s[i] >= '0' && s[i] <= '9') {
+    if (mant || s[i] != '0') {
+      if (nSigDigits < 19) {
+	mant = mant * 10 + (uint64_t)(s[i] - '0');
+      } else {
+	++exp10;
+      }
+      ++nSigDigits;
+    }
     ++nDigits;
     ++i;
   }
-  if (s[i] == '.') {
+  if (i < length && s[i] == '.') {
     ++i;
   }
-  while (s[i] >= '0' && s[i] <= '9') {
+  while (i < length && s[i] >= '0' && s[i] <= '9') {
+    if (mant || s[i] != '0') {
+      if (nSigDigits < 19) {
+	mant = mant * 10 + (uint64_t)(s[i] - '0');
+	--exp10;
+      }
+      ++nSigDigits;
+    } else {
+      --exp10;
+    }
     ++nDigits;
     ++i;
   }
   if (nDigits == 0) {
     return false;
   }
-  if (s[i] == 'E' || s[i] == 'e') {
+  if (i < length && (s[i] == 'E' || s[i] == 'e')) {
     ++i;
-    if (s[i] == '+' || s[i] == '-') {
+    bool expNeg = false;
+    if (i < length && (s[i] == '+' || s[i] == '-')) {
+      expNeg = s[i] == '-';
       ++i;
     }
     nDigits = 0;
-    while (s[i] >= '0' && s[i] <= '9') {
+    int e = 0;
+    while (i < length && s[i] >= '0' && s[i] <= '9') {
+      // clamp the exponent -- anything this large is handled by
+      // double-conversion anyway
+      if (e < 100000) {
+	e = e * 10 + (s[i] - '0');
+      }
       ++nDigits;
       ++i;
     }
     if (nDigits == 0) {
       return false;
     }
+    exp10 += expNeg ? -e : e;
   }
-  if (i != s.size()) {
-    return false;
-  }
-  stringToFloat(s, out);
-  return true;
+  return i == length;
 }
 
 std::string int56ToString(int64_t val, int radix, int precision) {
-  bool neg;
-  uint64_t x;
-  int minLength;
-  if (radix == 10 && val < 0) {
-    neg = true;
-    x = (uint64_t)-val;
-    minLength = std::max(1, precision - 1);
-  } else {
-    neg = false;
-    x = (uint64_t)val;
-    minLength = std::max(1, precision);
+  char buf[int56MaxChars];
+  int length = int56ToChars(val, radix, buf);
+
+  // the zero padding goes between the minus sign and the digits
+  int signLength = (buf[0] == '-') ? 1 : 0;
+  int nDigits = length - signLength;
+  int minDigits = std::max(1, precision - signLength);
+  if (nDigits >= minDigits) {
+    return std::string(buf, length);
   }
-
   std::string out;
-  do {
-    int digit = x % radix;
-    out.push_back(digitToChar[digit]);
-    x /= radix;
-  } while (x > 0);
-
-  int length = (int)out.size();
-  if (length < minLength) {
-    out.insert(out.size(), minLength - length, '0');
-  }
+  out.reserve(signLength + minDigits);
+  out.append(buf, signLength);
+  out.append(minDigits - nDigits, '0');
+  out.append(buf + signLength, nDigits);
+  return out;
+}
 
-  if (neg) {
-    out.push_back('-');
+int int56ToChars(int64_t val, int radix, char *buf) {
+  // the digits are written backward from the end of [tmp]
+  char tmp[int56MaxChars];
+  char *p = tmp + int56MaxChars;
+  if (radix == 10) {
+    bool neg = val < 0;
+    uint64_t x = neg ? (uint64_t)-val : (uint64_t)val;
+    while (x >= 100) {
+      int pair = (int)(x % 100) * 2;
+      x /= 100;
+      p -= 2;
+      p[0] = digitPairs[pair];
+      p[1] = digitPairs[pair + 1];
+    }
+    if (x >= 10) {
+      int pair = (int)x * 2;
+      p -= 2;
+      p[0] = digitPairs[pair];
+      p[1] = digitPairs[pair + 1];
+    } else {
+      *--p = (char)('0' + x);
+    }
+    if (neg) {
+      *--p = '-';
+    }
+  } else if ((radix & (radix - 1)) == 0) {
+    // power-of-two radix: shift and mask instead of dividing
+    int shift = __builtin_ctz(radix);
+    uint64_t mask = (uint64_t)radix - 1;
+    uint64_t x = (uint64_t)val;
+    do {
+      *--p = digitToChar[x & mask];
+      x >>= shift;
+    } while (x > 0);
+  } else {
+    uint64_t x = (uint64_t)val;
+    do {
+      *--p = digitToChar[x % radix];
+      x /= radix;
+    } while (x > 0);
   }
-
-  std::reverse(out.begin(), out.end());
-
-  return out;
+  int length = (int)(tmp + int56MaxChars - p);
+  memcpy(buf, p, length);
+  return length;
 }
 
 static_assert(DoubleToStringConverter::kMaxFixedDigitsBeforePoint == 60,
@@ -180,10 +363,54 @@ static_assert(DoubleToStringConverter::kMaxExponentialDigits == 120,
 static_assert(DoubleToStringConverter::kMaxPrecisionDigits == 120,
 	      "unexpected value for DoubleToStringConverter::kMaxPrecisionDigits");
 
+// The converters are immutable, so they're constructed once and
+// shared (including across threads).
+static const DoubleToStringConverter shortestFixedCvt(
+    0, "inf", "nan", 'e', -400, 400, 0, 0);
+static const DoubleToStringConverter shortestExpCvt(
+    0, "inf", "nan", 'e', 1, 0, 0, 0);
+static const DoubleToStringConverter shortestFlexCvt(
+    0, "inf", "nan", 'e', -4, 6, 0, 0);
+static const DoubleToStringConverter fixedExpCvt(
+    0, "inf", "nan", 'e', 0, 0, 0, 0);
+
+// The flexible-with-precision converters depend on the precision,
+// via max(0, 5 - precision), so there are six of each.
+#define nPrecisionCvts 6
+static const DoubleToStringConverter precisionCvts[nPrecisionCvts] = {
+  { 0, "inf", "nan", 'e', 0, 0, 4, 5 },
+  { 0, "inf", "nan", 'e', 0, 0, 4, 4 },
+  { 0, "inf", "nan", 'e', 0, 0, 4, 3 },
+  { 0, "inf", "nan", 'e', 0, 0, 4, 2 },
+  { 0, "inf", "nan", 'e', 0, 0, 4, 1 },
+  { 0, "inf", "nan", 'e', 0, 0, 4, 0 }
+};
+static const DoubleToStringConverter precisionNoTrailingZeroCvts[nPrecisionCvts] = {
+  { DoubleToStringConverter::NO_TRAILING_ZERO, "inf", "nan", 'e', 0, 0, 4, 5 },
+  { DoubleToStringConverter::NO_TRAILING_ZERO, "inf", "nan", 'e', 0, 0, 4, 4 },
+  { DoubleToStringConverter::NO_TRAILING_ZERO, "inf", "nan", 'e', 0, 0, 4, 3 },
+  { DoubleToStringConverter::NO_TRAILING_ZERO, "inf", "nan", 'e', 0, 0, 4, 2 },
+  { DoubleToStringConverter::NO_TRAILING_ZERO, "inf", "nan", 'e', 0, 0, 4, 1 },
+  { DoubleToStringConverter::NO_TRAILING_ZERO, "inf", "nan", 'e', 0, 0, 4, 0 }
+};
+
 std::string floatToString(float val, uint8_t format, int precision) {
+  return numToString(val, true, format, precision);
+}
+
+std::string doubleToString(double val, uint8_t format, int precision) {
+  return numToString(val, false, format, precision);
+}
+
+// Shared code for floatToString() and doubleToString(). If [single]
+// is true, [val] is a float (widened to double), and the shortest
+// representation is computed for a float.
+static std::string numToString(double val, bool single, uint8_t format, int precision) {
   // given the assertions above, the max string size should be 129
-  // (kMaxExponentialDigits + 8 + the null byte)
-  char buf[150];
+  // (kMaxExponentialDigits + 8 + the null byte), except for shortest
+  // fixed-point doubles, which can be up to 17 digits + 324 leading
+  // zeros + sign + decimal point + the null byte
+  char buf[400];
   StringBuilder sb(buf, sizeof(buf));
 
   bool ok;
@@ -191,85 +418,61 @@ std::string floatToString(float val, uint8_t format, int precision) {
     switch (format) {
 
     case 'f':
-    case 'F': {
-      double_conversion::DoubleToStringConverter cvt(
-	  0,
-	  "inf", "nan", 'e', -400, 400, 0, 0);
-      ok = cvt.ToShortestSingle(val, &sb);
+    case 'F':
+      ok = single ? shortestFixedCvt.ToShortestSingle((float)val, &sb)
+		  : shortestFixedCvt.ToShortest(val, &sb);
       sb.Finalize();
       break;
-    }
 
     case 'e':
-    case 'E': {
-      double_conversion::DoubleToStringConverter cvt(
-	  0,
-	  "inf", "nan", 'e', 1, 0, 0, 0);
-      ok = cvt.ToShortestSingle(val, &sb);
+    case 'E':
+      ok = single ? shortestExpCvt.ToShortestSingle((float)val, &sb)
+		  : shortestExpCvt.ToShortest(val, &sb);
       sb.Finalize();
       break;
-    }
 
     case 'g':
     case 'G':
-    default: {
-      double_conversion::DoubleToStringConverter cvt(
-	  0,
-	  "inf", "nan", 'e', -4, 6, 0, 0);
-      ok = cvt.ToShortestSingle(val, &sb);
+    default:
+      ok = single ? shortestFlexCvt.ToShortestSingle((float)val, &sb)
+		  : shortestFlexCvt.ToShortest(val, &sb);
       sb.Finalize();
       break;
-    }
 
     }
 
   } else {
+    int cvtIdx = std::min(precision, nPrecisionCvts - 1);
     switch (format) {
 
     case 'f':
-    case 'F': {
-      double_conversion::DoubleToStringConverter cvt(
-	  0,
-	  "inf", "nan", 'e', 0, 0, 0, 0);
-      ok = cvt.ToFixed(val, precision, &sb);
+    case 'F':
+      ok = fixedExpCvt.ToFixed(val, precision, &sb);
       sb.Finalize();
       if (format == 'F') {
 	trimTrailingZeros(buf);
       }
       break;
-    }
 
     case 'e':
-    case 'E': {
-      double_conversion::DoubleToStringConverter cvt(
-	  0,
-	  "inf", "nan", 'e', 0, 0, 0, 0);
-      ok = cvt.ToExponential(val, precision, &sb);
+    case 'E':
+      ok = fixedExpCvt.ToExponential(val, precision, &sb);
       sb.Finalize();
       if (format == 'E') {
 	trimTrailingZeros(buf);
       }
       break;
-    }
 
-    case 'g': {
-      double_conversion::DoubleToStringConverter cvt(
-	  0,
-	  "inf", "nan", 'e', 0, 0, 4, std::max(0, 5 - precision));
-      ok = cvt.ToPrecision(val, precision, &sb);
+    case 'g':
+      ok = precisionCvts[cvtIdx].ToPrecision(val, precision, &sb);
       sb.Finalize();
       break;
-    }
 
     case 'G':
-    default: {
-      double_conversion::DoubleToStringConverter cvt(
-	  DoubleToStringConverter::NO_TRAILING_ZERO,
-	  "inf", "nan", 'e', 0, 0, 4, std::max(0, 5 - precision));
-      ok = cvt.ToPrecision(val, precision, &sb);
+    default:
+      ok = precisionNoTrailingZeroCvts[cvtIdx].ToPrecision(val, precision, &sb);
       sb.Finalize();
       break;
-    }
 
     }
   }
@@ -35,6 +35,31 @@ extern void stringToFloat(const std::string &s, float &out);
 // syntax, returning false if [s] is not a valid float.
 extern bool stringToFloatChecked(const std::string &s, float &out);
 
+// Versions of the above functions that take a pointer and length,
+// for strings that aren't NUL-terminated (e.g., runtime Strings).
+extern bool stringToInt56(const char *s, size_t length, int radix, int64_t &out);
+extern bool stringToInt56Checked(const char *s, size_t length, int radix, int64_t &out);
+extern void stringToFloat(const char *s, size_t length, float &out);
+extern bool stringToFloatChecked(const char *s, size_t length, float &out);
+
+// Convert a string to a 64-bit double, with the same syntax as
+// stringToFloat().
+extern void stringToDouble(const std::string &s, double &out);
+
+// Same as stringToDouble() but also checks for valid floating point
+// syntax, returning false if [s] is not a valid double.
+extern bool stringToDoubleChecked(const std::string &s, double &out);
+extern bool stringToDoubleChecked(const char *s, size_t length, double &out);
+
+// Max number of chars written by int56ToChars(): 64 binary digits
+// (a negative value in radix 2) plus a minus sign.
+#define int56MaxChars 65
+
+// Convert a 56-bit integer to chars in [buf], with no precision and
+// no terminating null. [radix] is as for int56ToString(). Returns the
+// number of chars written, which is at most int56MaxChars.
+extern int int56ToChars(int64_t val, int radix, char *buf);
+
 // Convert a 56-bit integer to a string. [precision] is treated as per
 // the interpolated string spec. [radix] must be in [2, 16]. Radixes
 // other than 10 are treated as unsigned.
@@ -57,4 +82,8 @@ extern std::string int56ToString(int64_t val, int radix, int precision);
 // equivalent to [FEG].
 extern std::string floatToString(float val, uint8_t format, int precision);
 
+// Convert a 64-bit double to a string. [format] and [precision] are
+// as for floatToString().
+extern std::string doubleToString(double val, uint8_t format, int precision);
+
 #endif // NumConversion_h
@@ -8,7 +8,9 @@
 //========================================================================
 
 #include "SysIO.h"
+#include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <pwd.h>
 #include <signal.h>
 #include <stdlib.h>
@@ -17,6 +19,15 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include "aconf.h"
+#if HAVE_SENDFILE
+#include <sys/sendfile.h>
+#endif
+
+//------------------------------------------------------------------------
+
+// Max number of bytes to pass to a single write/copy call. (Linux
+// transfers at most about 2 GB per call anyway.)
+#define maxIOChunk ((size_t)1 << 30)
 
 //------------------------------------------------------------------------
 
@@ -89,6 +100,153 @@ bool readFile(const std::string &path, std::string &contents) {
   return true;
 }
 
+bool writeFile(const std::string &path, const void *data, size_t n) {
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0) {
+    return false;
+  }
+  bool ok = writeFD(fd, data, n);
+  if (close(fd) != 0) {
+    ok = false;
+  }
+  return ok;
+}
+
+// Copy [srcFD] to [destFD] with read/write calls.
+static bool copyFDReadWrite(int srcFD, int destFD) {
+  char buf[65536];
+  while (1) {
+    ssize_t n = read(srcFD, buf, sizeof(buf));
+    if (n == 0) {
+      return true;
+    }
+    if (n < 0) {
+      if (errno == EINTR) {
+	continue;
+      }
+      return false;
+    }
+    if (!writeFD(destFD, buf, (size_t)n)) {
+      return false;
+    }
+  }
+}
+
+bool copyFile(const std::string &srcPath, const std::string &destPath) {
+  int srcFD = open(srcPath.c_str(), O_RDONLY);
+  if (srcFD < 0) {
+    return false;
+  }
+  int destFD = open(destPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (destFD < 0) {
+    close(srcFD);
+    return false;
+  }
+
+  // the in-kernel copies are only used for non-empty regular files
+  // (special files like those in /proc report a size of zero, and
+  // copy_file_range treats them as empty); they can fail with nothing
+  // copied if they aren't supported for these files (e.g.,
+  // copy_file_range across file systems on older kernels) -- in that
+  // case, fall back to the next method; a failure after some bytes
+  // have been copied is a real error
+  bool done = false;
+  bool ok = false;
+#if HAVE_COPY_FILE_RANGE || HAVE_SENDFILE
+  struct stat st;
+  bool kernelCopy = fstat(srcFD, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0;
+#endif
+#if HAVE_COPY_FILE_RANGE
+  if (kernelCopy && !done) {
+    bool copied = false;
+    while (1) {
+      ssize_t n = copy_file_range(srcFD, nullptr, destFD, nullptr, maxIOChunk, 0);
+      if (n > 0) {
+	copied = true;
+      } else if (n == 0) {
+	done = ok = true;
+	break;
+      } else if (errno != EINTR) {
+	done = copied;
+	break;
+      }
+    }
+  }
+#endif
+#if HAVE_SENDFILE
+  if (kernelCopy && !done) {
+    bool copied = false;
+    while (1) {
+      ssize_t n = sendfile(destFD, srcFD, nullptr, maxIOChunk);
+      if (n > 0) {
+	copied = true;
+      } else if (n == 0) {
+	done = ok = true;
+	break;
+      } else if (errno != EINTR) {
+	done = copied;
+	break;
+      }
+    }
+  }
+#endif
+  if (!done) {
+    ok = copyFDReadWrite(srcFD, destFD);
+  }
+
+  close(srcFD);
+  if (close(destFD) != 0) {
+    ok = false;
+  }
+  return ok;
+}
+
+bool writeFD(int fd, const void *data, size_t n) {
+  const char *p = (const char *)data;
+  while (n > 0) {
+    ssize_t k = write(fd, p, n < maxIOChunk ? n : maxIOChunk);
+    if (k < 0) {
+      if (errno == EINTR) {
+	continue;
+      }
+      return false;
+    }
+    p += k;
+    n -= (size_t)k;
+  }
+  return true;
+}
+
+bool writevFD(int fd, struct iovec *iov, int iovCnt) {
+  while (iovCnt > 0) {
+    // skip empty buffers (including the fully written ones left by a
+    // partial write)
+    if (iov->iov_len == 0) {
+      ++iov;
+      --iovCnt;
+      continue;
+    }
+    ssize_t k = writev(fd, iov, iovCnt < IOV_MAX ? iovCnt : IOV_MAX);
+    if (k < 0) {
+      if (errno == EINTR) {
+	continue;
+      }
+      return false;
+    }
+    size_t nWritten = (size_t)k;
+    while (iovCnt > 0 && nWritten >= iov->iov_len) {
+      nWritten -= iov->iov_len;
+      ++iov;
+      --iovCnt;
+    }
+    if (nWritten > 0) {
+      iov->iov_base = (char *)iov->iov_base + nWritten;
+      iov->iov_len -= nWritten;
+    }
+  }
+  return true;
+}
+
 bool createDir(const std::string &path) {
   return mkdir(path.c_str(), 0755) == 0;
 }
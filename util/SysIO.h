@@ -12,6 +12,7 @@
 #ifndef SysIO_h
 #define SysIO_h
 
+#include <sys/uio.h>
 #include <string>
 #include <vector>
 #include "DateTime.h"
@@ -39,6 +40,25 @@ extern DateTime pathModTime(const std::string &path);
 // Returns true on success, false on error.
 extern bool readFile(const std::string &path, std::string &contents);
 
+// Write [n] bytes at [data] to a file at [path], replacing any
+// existing file. Returns true on success, false on error.
+extern bool writeFile(const std::string &path, const void *data, size_t n);
+
+// Copy the file at [srcPath] to [destPath], replacing any existing
+// file. This uses an in-kernel copy (copy_file_range or sendfile)
+// where available. Returns true on success, false on error.
+extern bool copyFile(const std::string &srcPath, const std::string &destPath);
+
+// Write [n] bytes at [data] to [fd], retrying after partial writes.
+// Returns true on success, false on error.
+extern bool writeFD(int fd, const void *data, size_t n);
+
+// Write the [iovCnt] buffers in [iov] to [fd], using as few writev
+// calls as possible, and retrying after partial writes. This may
+// modify the entries in [iov]. Returns true on success, false on
+// error.
+extern bool writevFD(int fd, struct iovec *iov, int iovCnt);
+
 // Create a directory at [path]. Returns true on sucess, false on
 // error.
 extern bool createDir(const std::string &path);
@@ -8,6 +8,10 @@
 //========================================================================
 
 #include "UTF8.h"
+#include <string.h>
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
 
 //------------------------------------------------------------------------
 
@@ -196,3 +200,101 @@ int utf8Encode(uint32_t u, uint8_t *out) {
   }
 }
 
+
+//------------------------------------------------------------------------
+
+int64_t utf8FindNonAscii(const uint8_t *s, int64_t length, int64_t start) {
+  int64_t i = start < 0 ? 0 : start;
+#ifdef __SSE2__
+  // the sign bit of each byte is set for non-ASCII bytes
+  while (i <= length - 16) {
+    __m128i block = _mm_loadu_si128((const __m128i *)(s + i));
+    int mask = _mm_movemask_epi8(block);
+    if (mask) {
+      return i + __builtin_ctz(mask);
+    }
+    i += 16;
+  }
+#endif
+  while (i <= length - 8) {
+    uint64_t word;
+    memcpy(&word, s + i, 8);
+    if (word & 0x8080808080808080ULL) {
+      break;
+    }
+    i += 8;
+  }
+  while (i < length && s[i] < 0x80) {
+    ++i;
+  }
+  return i < length ? i : length;
+}
+
+bool utf8IsAscii(const uint8_t *s, int64_t length) {
+  return utf8FindNonAscii(s, length, 0) == length;
+}
+
+int64_t utf8CountCodepoints(const uint8_t *s, int64_t length) {
+  int64_t n = 0;
+  int64_t i = 0;
+  while (i < length) {
+    // ASCII bytes are one codepoint each
+    int64_t j = utf8FindNonAscii(s, length, i);
+    n += j - i;
+    i = j;
+
+    // decode non-ASCII codepoints until the next ASCII byte
+    while (i < length && s[i] >= 0x80) {
+      i += utf8Length(s, length, i);
+      ++n;
+    }
+  }
+  return n;
+}
+
+bool utf8IsValid(const uint8_t *s, int64_t length) {
+  int64_t i = 0;
+  while (true) {
+    i = utf8FindNonAscii(s, length, i);
+    if (i >= length) {
+      return true;
+    }
+
+    // valid ranges for the lead byte and the second byte are from
+    // RFC 3629, section 4; all remaining bytes are in 0x80 .. 0xbf
+    uint8_t c0 = s[i];
+    int n;
+    uint8_t lo = 0x80, hi = 0xbf;
+    if (c0 >= 0xc2 && c0 <= 0xdf) {
+      n = 2;
+    } else if (c0 >= 0xe0 && c0 <= 0xef) {
+      n = 3;
+      if (c0 == 0xe0) {
+	lo = 0xa0;
+      } else if (c0 == 0xed) {
+	hi = 0x9f;
+      }
+    } else if (c0 >= 0xf0 && c0 <= 0xf4) {
+      n = 4;
+      if (c0 == 0xf0) {
+	lo = 0x90;
+      } else if (c0 == 0xf4) {
+	hi = 0x8f;
+      }
+    } else {
+      return false;
+    }
+    if (i > length - n) {
+      return false;
+    }
+    if (s[i+1] < lo || s[i+1] > hi) {
+      return false;
+    }
+    for (int k = 2; k < n; ++k) {
+      if ((s[i+k] & 0xc0) != 0x80) {
+	return false;
+      }
+    }
+    i += n;
+  }
+}
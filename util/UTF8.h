@@ -51,4 +51,28 @@ extern int utf8PrevLength(const uint8_t *s, int64_t length, int64_t idx);
 // not a valid Unicode codepoint (i.e., if [i] is too large).
 extern int utf8Encode(uint32_t u, uint8_t *out);
 
+//------------------------------------------------------------------------
+
+// The following functions scan whole strings. They use SSE2 (when
+// available) to skip over runs of ASCII bytes 16 at a time, and fall
+// back to 8-byte words otherwise.
+
+// Returns the index of the first non-ASCII byte (i.e., >= 0x80) in
+// [s], starting at [start]. Returns [length] if there are no
+// non-ASCII bytes.
+extern int64_t utf8FindNonAscii(const uint8_t *s, int64_t length, int64_t start);
+
+// Returns true if [s] contains only ASCII bytes.
+extern bool utf8IsAscii(const uint8_t *s, int64_t length);
+
+// Returns the number of codepoints in [s]. This follows the same
+// rules as utf8Get, i.e., each byte of an invalid UTF-8 sequence is
+// counted as one codepoint.
+extern int64_t utf8CountCodepoints(const uint8_t *s, int64_t length);
+
+// Returns true if [s] is valid UTF-8, in the strict sense: no
+// overlong sequences, no surrogates (U+D800 .. U+DFFF), and no
+// codepoints above U+10FFFF.
+extern bool utf8IsValid(const uint8_t *s, int64_t length);
+
 #endif // UTF8_h
@@ -0,0 +1,115 @@
+//========================================================================
+//
+// utf8bench.cpp
+//
+// Micro-benchmarks for the UTF-8 functions. Each benchmark runs over
+// a few generated inputs (pure ASCII, mostly ASCII, and CJK text),
+// and reports throughput in MB/s, along with the byte-at-a-time
+// baseline (a utf8Length loop).
+//
+// Usage: utf8bench [<MB>]
+//
+// Part of the Haxonite project, under the MIT License.
+// Copyright 2025 Derek Noonburg
+//
+//========================================================================
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "UTF8.h"
+
+static std::vector<uint8_t> makeInput(int64_t length, const char *unit);
+static void bench(const char *inputName, const std::vector<uint8_t> &input,
+		  const char *funcName,
+		  int64_t (*func)(const uint8_t *s, int64_t length));
+static int64_t baselineCount(const uint8_t *s, int64_t length);
+static int64_t countCodepoints(const uint8_t *s, int64_t length);
+static int64_t isAscii(const uint8_t *s, int64_t length);
+static int64_t isValid(const uint8_t *s, int64_t length);
+
+int main(int argc, char *argv[]) {
+  int64_t mb = 64;
+  if (argc == 2) {
+    mb = atoi(argv[1]);
+  } else if (argc != 1) {
+    fprintf(stderr, "Usage: utf8bench [<MB>]\n");
+    exit(1);
+  }
+  if (mb < 1) {
+    mb = 1;
+  }
+  int64_t length = mb << 20;
+
+  struct {
+    const char *name;
+    const char *unit;
+  } inputs[] = {
+    { "ascii",  "The quick brown fox jumps over the lazy dog. " },
+    { "mostly", "Na\xc3\xafve caf\xc3\xa9 owners sell cr\xc3\xa8me br\xc3\xbbl\xc3\xa9" "e daily. " },
+    { "cjk",    "\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e\xe3\x81\xae\xe6\x96\x87\xe7\xab\xa0\xe3\x80\x82" }
+  };
+  for (auto &in : inputs) {
+    std::vector<uint8_t> input = makeInput(length, in.unit);
+    bench(in.name, input, "baseline", &baselineCount);
+    bench(in.name, input, "utf8CountCodepoints", &countCodepoints);
+    bench(in.name, input, "utf8IsAscii", &isAscii);
+    bench(in.name, input, "utf8IsValid", &isValid);
+  }
+  return 0;
+}
+
+// Repeat [unit] to fill [length] bytes, without splitting a codepoint
+// at the end.
+static std::vector<uint8_t> makeInput(int64_t length, const char *unit) {
+  std::string u(unit);
+  std::vector<uint8_t> s;
+  s.reserve(length);
+  while ((int64_t)(s.size() + u.size()) <= length) {
+    s.insert(s.end(), u.begin(), u.end());
+  }
+  return s;
+}
+
+static void bench(const char *inputName, const std::vector<uint8_t> &input,
+		  const char *funcName,
+		  int64_t (*func)(const uint8_t *s, int64_t length)) {
+  const int nReps = 5;
+  double best = 0;
+  int64_t result = 0;
+  for (int rep = 0; rep < nReps; ++rep) {
+    auto t0 = std::chrono::steady_clock::now();
+    result = (*func)(input.data(), (int64_t)input.size());
+    auto t1 = std::chrono::steady_clock::now();
+    double secs = std::chrono::duration<double>(t1 - t0).count();
+    if (rep == 0 || secs < best) {
+      best = secs;
+    }
+  }
+  double mbPerSec = best > 0 ? (double)input.size() / (1 << 20) / best : 0;
+  printf("%-8s %-22s %10.1f MB/s  (result = %" PRId64 ")\n",
+	 inputName, funcName, mbPerSec, result);
+}
+
+static int64_t baselineCount(const uint8_t *s, int64_t length) {
+  int64_t n = 0;
+  for (int64_t i = 0; i < length; i += utf8Length(s, length, i)) {
+    ++n;
+  }
+  return n;
+}
+
+static int64_t countCodepoints(const uint8_t *s, int64_t length) {
+  return utf8CountCodepoints(s, length);
+}
+
+static int64_t isAscii(const uint8_t *s, int64_t length) {
+  return utf8IsAscii(s, length);
+}
+
+static int64_t isValid(const uint8_t *s, int64_t length) {
+  return utf8IsValid(s, length);
+}